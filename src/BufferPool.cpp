@@ -0,0 +1,92 @@
+#include "BufferPool.h"
+#include "ScanThread.h"
+
+#include <string.h>
+
+static volatile int32 g_scanAllocations = 0;
+
+void* ScanAlloc(uint size) {
+	//Over-allocate and keep the pointer s3eMalloc returned just below the aligned block for ScanFree.
+	uint8* pAllocation = (uint8*)s3eMalloc(size + SCAN_ALLOC_ALIGNMENT + sizeof(void*));
+	if(pAllocation == NULL)
+		return NULL;
+	AtomicAdd(&g_scanAllocations, 1);
+	const size_t aligned = ((size_t)(pAllocation + sizeof(void*)) + SCAN_ALLOC_ALIGNMENT - 1) & ~(size_t)(SCAN_ALLOC_ALIGNMENT - 1);
+	((void**)aligned)[-1] = pAllocation;
+	return (void*)aligned;
+}
+
+void ScanFree(void* p) {
+	if(p)
+		s3eFree(((void**)p)[-1]);
+}
+
+uint32 ScanAllocationCount() {
+	return (uint32)AtomicLoad(&g_scanAllocations);
+}
+
+bool ScanReserveBuffer(uint8** ppBuffer, uint* pCapacity, uint size) {
+	if(size <= *pCapacity)
+		return true;
+	ScanFree(*ppBuffer);
+	*ppBuffer = NULL;
+	*pCapacity = 0;
+	uint8* pBuffer = (uint8*)ScanAlloc(size);
+	if(pBuffer == NULL)
+		return false;
+	*ppBuffer = pBuffer;
+	*pCapacity = size;
+	return true;
+}
+
+void BufferPoolInit(BufferPool* pPool) {
+	memset(pPool, 0, sizeof(BufferPool));
+}
+
+void BufferPoolRelease(BufferPool* pPool) {
+	for(uint i = 0; i < BUFFER_POOL_SIZE; ++i)
+		ScanFree(pPool->buffers[i].pData);
+	BufferPoolInit(pPool);
+}
+
+void* BufferPoolAcquire(BufferPool* pPool, uint width, uint height, BufferFormat format) {
+	//Look for a free buffer with the same key, and remember an empty entry or else the least recently used free one.
+	int victim = -1;
+	for(uint i = 0; i < BUFFER_POOL_SIZE; ++i) {
+		PooledBuffer* pBuffer = &pPool->buffers[i];
+		if(pBuffer->inUse)
+			continue;
+		if(pBuffer->pData && pBuffer->width == width && pBuffer->height == height && pBuffer->format == format) {
+			pBuffer->inUse = true;
+			pPool->lastUse[i] = ++pPool->useCount;
+			return pBuffer->pData;
+		}
+		if(victim < 0 || (pPool->buffers[victim].pData && (pBuffer->pData == NULL || pPool->lastUse[i] < pPool->lastUse[victim])))
+			victim = (int)i;
+	}
+	if(victim < 0)
+		return NULL; //Every entry is in use
+
+	PooledBuffer* pBuffer = &pPool->buffers[victim];
+	ScanFree(pBuffer->pData);
+	pBuffer->pData = ScanAlloc(BufferSize(width, height, format));
+	if(pBuffer->pData == NULL)
+		return NULL;
+	pBuffer->width = width;
+	pBuffer->height = height;
+	pBuffer->format = format;
+	pBuffer->inUse = true;
+	pPool->lastUse[victim] = ++pPool->useCount;
+	return pBuffer->pData;
+}
+
+void BufferPoolPut(BufferPool* pPool, void* pData) {
+	if(pData == NULL)
+		return;
+	for(uint i = 0; i < BUFFER_POOL_SIZE; ++i) {
+		if(pPool->buffers[i].pData == pData) {
+			pPool->buffers[i].inUse = false;
+			return;
+		}
+	}
+}
@@ -0,0 +1,65 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include "ScanTypes.h"
+
+//Heap functions of the scan modules and a pool of pixel buffers kept for reuse.
+//ScanAlloc returns memory aligned for SIMD loads and counts every allocation, so it can be checked that the camera to
+//decode path allocates nothing per frame once it is running (ScanAllocationCount).
+//A BufferPool keeps the buffers it hands out when they are given back, keyed by their dimensions and format. Changing
+//the frame size or orientation and then going back reuses the old buffers instead of freeing and allocating again.
+
+#define SCAN_ALLOC_ALIGNMENT 16 //Enough for the NEON and SSE2 loads and stores
+#define BUFFER_POOL_SIZE 8
+
+enum BufferFormat {
+	BUFFER_FORMAT_Y800,
+	BUFFER_FORMAT_RGB565
+};
+
+//Allocate size bytes aligned to SCAN_ALLOC_ALIGNMENT. Returns NULL if out of memory.
+void* ScanAlloc(uint size);
+
+//Free memory from ScanAlloc. NULL is ignored.
+void ScanFree(void* p);
+
+//Number of ScanAlloc calls so far, on all threads.
+uint32 ScanAllocationCount();
+
+//Grow *ppBuffer (from ScanAlloc) to hold size bytes. The contents are not kept. Returns false if out of memory.
+bool ScanReserveBuffer(uint8** ppBuffer, uint* pCapacity, uint size);
+
+struct PooledBuffer {
+	void* pData; //NULL if the entry is empty
+	uint width;
+	uint height;
+	BufferFormat format;
+	bool inUse;
+};
+
+//Not thread safe: a pool must only be used by one thread at a time.
+struct BufferPool {
+	PooledBuffer buffers[BUFFER_POOL_SIZE];
+	uint32 lastUse[BUFFER_POOL_SIZE]; //Value of useCount when the buffer was last acquired, to evict the oldest
+	uint32 useCount;
+};
+
+void BufferPoolInit(BufferPool* pPool);
+
+//Free all buffers. None may be in use.
+void BufferPoolRelease(BufferPool* pPool);
+
+//Get a buffer for width x height pixels of the given format. A free buffer with the same key is reused, otherwise a new
+//one is allocated, freeing the least recently used free buffer if the pool is full. Returns NULL if out of memory.
+void* BufferPoolAcquire(BufferPool* pPool, uint width, uint height, BufferFormat format);
+
+//Hand a buffer from BufferPoolAcquire back to the pool, which keeps it for the next BufferPoolAcquire with the same key.
+//NULL is ignored.
+void BufferPoolPut(BufferPool* pPool, void* pData);
+
+//Size in bytes of a width x height buffer of the given format.
+inline uint BufferSize(uint width, uint height, BufferFormat format) {
+	return width * height * (format == BUFFER_FORMAT_RGB565 ? 2 : 1);
+}
+
+#endif
@@ -0,0 +1,192 @@
+#include "FrameFile.h"
+#include "BufferPool.h"
+
+#include <string.h>
+
+#ifdef SCAN_HOST_BUILD
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+static inline uint64 AlignFrameData(uint64 size) {
+	return (size + FRAME_FILE_ALIGNMENT - 1) & ~(uint64)(FRAME_FILE_ALIGNMENT - 1);
+}
+
+//Check a record header read from a file. The frame size must fit in dataSize so a damaged file can't send the kernels
+//outside the frame data. The sizes are bounded first, so neither the check nor the kernels' offsets overflow.
+static bool ValidRecord(const FrameRecordHeader* pRecord) {
+	if(pRecord->rotation > FRAME_ROT270 || pRecord->pixelType > FRAME_PIXEL_NV12 || pRecord->width == 0 || pRecord->height == 0)
+		return false;
+	if(pRecord->width > FRAME_FILE_MAX_DIMENSION || pRecord->height > FRAME_FILE_MAX_DIMENSION ||
+		pRecord->pitch > 2 * FRAME_FILE_MAX_DIMENSION)
+		return false;
+	CameraFrame frame;
+	frame.width = pRecord->width;
+	frame.height = pRecord->height;
+	frame.pitch = pRecord->pitch;
+	frame.pixelType = (FramePixelType)pRecord->pixelType;
+	return (uint64)pRecord->dataSize >= FrameDataSize(&frame);
+}
+
+uint64 FrameDataSize(const CameraFrame* pFrame) {
+	const uint64 width = pFrame->width, height = pFrame->height, framePitch = pFrame->pitch;
+	if(pFrame->pixelType == FRAME_PIXEL_RGB565) {
+		const uint64 pitch = framePitch < width * 2 ? width * 2 : framePitch;
+		return pitch * height;
+	}
+	const uint64 pitch = framePitch < width ? width : framePitch;
+	return pitch * height + pitch * ((height + 1) / 2); //Luma plane and the half height chroma plane
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//RECORDING
+
+bool FrameRecorderOpen(FrameRecorder* pRecorder, const char* pPath) {
+	memset(pRecorder, 0, sizeof(FrameRecorder));
+	pRecorder->pFile = fopen(pPath, "wb");
+	if(pRecorder->pFile == NULL)
+		return false;
+
+	FrameFileHeader header;
+	header.magic = FRAME_FILE_MAGIC;
+	header.version = FRAME_FILE_VERSION;
+	header.recordHeaderSize = sizeof(FrameRecordHeader);
+	header.reserved = 0;
+	if(fwrite(&header, sizeof(header), 1, pRecorder->pFile) != 1) {
+		FrameRecorderClose(pRecorder);
+		return false;
+	}
+	pRecorder->bytes = sizeof(header);
+	return true;
+}
+
+bool FrameRecorderWrite(FrameRecorder* pRecorder, const CameraFrame* pFrame, uint64 timestamp) {
+	static const uint8 padding[FRAME_FILE_ALIGNMENT] = { 0 };
+	FrameRecordHeader record;
+	record.dataSize = (uint32)FrameDataSize(pFrame);
+	record.width = pFrame->width;
+	record.height = pFrame->height;
+	record.pitch = pFrame->pitch;
+	record.rotation = pFrame->rotation;
+	record.pixelType = pFrame->pixelType;
+	record.timestamp = timestamp;
+
+	const uint paddingSize = (uint)(AlignFrameData(record.dataSize) - record.dataSize);
+	if(fwrite(&record, sizeof(record), 1, pRecorder->pFile) != 1 ||
+		fwrite(pFrame->pData, record.dataSize, 1, pRecorder->pFile) != 1 ||
+		(paddingSize && fwrite(padding, paddingSize, 1, pRecorder->pFile) != 1))
+		return false;
+	++pRecorder->frames;
+	pRecorder->bytes += sizeof(record) + record.dataSize + paddingSize;
+	return true;
+}
+
+void FrameRecorderClose(FrameRecorder* pRecorder) {
+	if(pRecorder->pFile)
+		fclose(pRecorder->pFile);
+	pRecorder->pFile = NULL;
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//REPLAY
+
+//Map (host builds) or read the whole file into pReplay->pData.
+static bool LoadReplayFile(FrameReplay* pReplay, const char* pPath) {
+#ifdef SCAN_HOST_BUILD
+	const int fd = open(pPath, O_RDONLY);
+	if(fd < 0)
+		return false;
+	struct stat status;
+	void* pMapping = MAP_FAILED;
+	if(fstat(fd, &status) == 0 && status.st_size > 0)
+		pMapping = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); //The mapping keeps the file open
+	if(pMapping == MAP_FAILED)
+		return false;
+	pReplay->pData = (const uint8*)pMapping;
+	pReplay->size = (uint64)status.st_size;
+	return true;
+#else
+	FILE* pFile = fopen(pPath, "rb");
+	if(pFile == NULL)
+		return false;
+	fseek(pFile, 0, SEEK_END);
+	const long size = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+	uint8* pData = size > 0 ? (uint8*)ScanAlloc((uint)size) : NULL;
+	const bool ok = pData && fread(pData, (size_t)size, 1, pFile) == 1;
+	fclose(pFile);
+	if(!ok) {
+		ScanFree(pData);
+		return false;
+	}
+	pReplay->pData = pData;
+	pReplay->size = (uint64)size;
+	return true;
+#endif
+}
+
+bool FrameReplayOpen(FrameReplay* pReplay, const char* pPath) {
+	memset(pReplay, 0, sizeof(FrameReplay));
+	if(!LoadReplayFile(pReplay, pPath))
+		return false;
+
+	FrameFileHeader header;
+	if(pReplay->size < sizeof(header)) {
+		FrameReplayClose(pReplay);
+		return false;
+	}
+	memcpy(&header, pReplay->pData, sizeof(header));
+	if(header.magic != FRAME_FILE_MAGIC || header.version != FRAME_FILE_VERSION ||
+		header.recordHeaderSize < sizeof(FrameRecordHeader) || header.recordHeaderSize % FRAME_FILE_ALIGNMENT != 0) {
+		FrameReplayClose(pReplay);
+		return false;
+	}
+	pReplay->recordHeaderSize = header.recordHeaderSize;
+
+	//Count the complete frames
+	CameraFrame frame;
+	uint64 timestamp;
+	FrameReplayRewind(pReplay);
+	while(FrameReplayNext(pReplay, &frame, &timestamp))
+		++pReplay->frames;
+	FrameReplayRewind(pReplay);
+	return true;
+}
+
+bool FrameReplayNext(FrameReplay* pReplay, CameraFrame* pFrame, uint64* pTimestamp) {
+	if(pReplay->position + pReplay->recordHeaderSize > pReplay->size)
+		return false;
+	FrameRecordHeader record;
+	memcpy(&record, pReplay->pData + pReplay->position, sizeof(record));
+	const uint64 dataOffset = pReplay->position + pReplay->recordHeaderSize;
+	if(!ValidRecord(&record) || dataOffset + record.dataSize > pReplay->size)
+		return false;
+
+	pFrame->pData = pReplay->pData + dataOffset;
+	pFrame->width = record.width;
+	pFrame->height = record.height;
+	pFrame->pitch = record.pitch;
+	pFrame->rotation = (FrameRotation)record.rotation;
+	pFrame->pixelType = (FramePixelType)record.pixelType;
+	*pTimestamp = record.timestamp;
+	pReplay->position = dataOffset + AlignFrameData(record.dataSize);
+	return true;
+}
+
+void FrameReplayRewind(FrameReplay* pReplay) {
+	pReplay->position = sizeof(FrameFileHeader);
+}
+
+void FrameReplayClose(FrameReplay* pReplay) {
+	if(pReplay->pData) {
+#ifdef SCAN_HOST_BUILD
+		munmap((void*)pReplay->pData, (size_t)pReplay->size);
+#else
+		ScanFree((void*)pReplay->pData);
+#endif
+	}
+	memset(pReplay, 0, sizeof(FrameReplay));
+}
@@ -0,0 +1,84 @@
+#ifndef FRAME_FILE_H
+#define FRAME_FILE_H
+
+#include "ScanPipeline.h"
+
+#include <stdio.h>
+
+//Camera frame recording. FrameRecorder appends raw camera frames to a file, FrameReplay reads them back without copying
+//so a field session can be run through the pipeline again on any machine (see tools/scanreplay.cpp).
+//
+//File layout (little endian):
+// - FrameFileHeader
+// - per frame a FrameRecordHeader followed by dataSize bytes of frame data, padded to FRAME_FILE_ALIGNMENT bytes so the
+//   data of every frame stays aligned when the file is mapped into memory.
+
+#define FRAME_FILE_MAGIC 0x4d524642 //"BFRM"
+#define FRAME_FILE_VERSION 1
+#define FRAME_FILE_ALIGNMENT 16
+#define FRAME_FILE_MAX_DIMENSION 16384 //Largest width or height a recorded frame may have
+
+struct FrameFileHeader {
+	uint32 magic; //FRAME_FILE_MAGIC
+	uint32 version; //FRAME_FILE_VERSION
+	uint32 recordHeaderSize; //sizeof(FrameRecordHeader), lets older readers skip fields added later
+	uint32 reserved;
+};
+
+struct FrameRecordHeader {
+	uint32 dataSize; //Bytes of frame data that follow, not counting the padding
+	uint32 width; //s3eCameraFrameData::m_Width
+	uint32 height; //m_Height
+	uint32 pitch; //m_Pitch, in bytes
+	uint32 rotation; //m_Rotation as a FrameRotation
+	uint32 pixelType; //m_PixelType as a FramePixelType
+	uint64 timestamp; //ScanClockNs() time the frame was recorded
+};
+
+//Size in bytes of the data of a frame: the pixels, plus the chroma plane for YUV frames. 64 bit so that the sizes read
+//from a damaged file can't wrap around.
+uint64 FrameDataSize(const CameraFrame* pFrame);
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//RECORDING
+
+struct FrameRecorder {
+	FILE* pFile;
+	uint32 frames; //Frames written
+	uint64 bytes; //File size so far
+};
+
+//Create (or overwrite) the file at pPath and write the file header. Returns false on failure.
+bool FrameRecorderOpen(FrameRecorder* pRecorder, const char* pPath);
+
+//Append one frame. The write is synchronous, so recording is meant for capturing test sessions, not for normal use.
+//Returns false on a write error.
+bool FrameRecorderWrite(FrameRecorder* pRecorder, const CameraFrame* pFrame, uint64 timestamp);
+
+void FrameRecorderClose(FrameRecorder* pRecorder);
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//REPLAY
+
+struct FrameReplay {
+	const uint8* pData; //The whole file, memory mapped on host builds and read into memory otherwise
+	uint64 size;
+	uint64 position; //Offset of the next FrameRecordHeader
+	uint32 recordHeaderSize;
+	uint32 frames; //Number of complete frames in the file
+};
+
+//Open a recording and count its frames. A truncated last frame (e.g. the app was killed while recording) is ignored.
+//Returns false if the file can't be read or isn't a recording.
+bool FrameReplayOpen(FrameReplay* pReplay, const char* pPath);
+
+//Get the next frame. pFrame->pData points into the file and stays valid until FrameReplayClose.
+//Returns false at the end of the file.
+bool FrameReplayNext(FrameReplay* pReplay, CameraFrame* pFrame, uint64* pTimestamp);
+
+//Go back to the first frame.
+void FrameReplayRewind(FrameReplay* pReplay);
+
+void FrameReplayClose(FrameReplay* pReplay);
+
+#endif
@@ -0,0 +1,595 @@
+#include "FrameKernels.h"
+#include "FrameSimd.h"
+#include "RotateEngine.h"
+
+#include <string.h>
+
+//Both SIMD paths work on 8 RGB565 pixels per vector.
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//SIMD PRIMITIVES
+
+#if defined(FRAME_KERNELS_NEON)
+
+typedef uint16x8_t Pixels8;
+
+static inline Pixels8 LoadPixels8(const uint16* p) { return vld1q_u16(p); }
+static inline void StorePixels8(uint16* p, Pixels8 v) { vst1q_u16(p, v); }
+
+//Reverse the order of the 8 pixels in v.
+static inline Pixels8 ReversePixels8(Pixels8 v) {
+	v = vrev64q_u16(v);
+	return vcombine_u16(vget_high_u16(v), vget_low_u16(v));
+}
+
+//Same arithmetic as RGB565ToY800(). The weighted sum never exceeds 16 bits so it is done in 16 bit lanes.
+static inline Pixels8 LumaPixels8(Pixels8 p) {
+	const uint16x8_t
+		r = vshrq_n_u16(vandq_u16(p, vdupq_n_u16(0xf800)), 8),
+		g = vshrq_n_u16(vandq_u16(p, vdupq_n_u16(0x07e0)), 3),
+		b = vshlq_n_u16(vandq_u16(p, vdupq_n_u16(0x001f)), 3);
+	uint16x8_t y = vmulq_n_u16(r, 77);
+	y = vmlaq_n_u16(y, g, 150);
+	y = vmlaq_n_u16(y, b, 29);
+	return vshrq_n_u16(y, 8);
+}
+
+//Narrow two vectors of luma values to 16 bytes and store them.
+static inline void StoreGray16(uint8* p, Pixels8 y0, Pixels8 y1) {
+	vst1q_u8(p, vcombine_u8(vmovn_u16(y0), vmovn_u16(y1)));
+}
+
+//Average the 8 2x2 blocks made of 16 bytes from src0 and 16 bytes from src1 into 8 bytes. Same rounding as DownscaleRow().
+static inline void Average2x2x8(const uint8* src0, const uint8* src1, uint8* dest) {
+	const uint16x8_t sum = vpadalq_u8(vpaddlq_u8(vld1q_u8(src0)), vld1q_u8(src1));
+	vst1_u8(dest, vrshrn_n_u16(sum, 2));
+}
+
+//Add (subtract false) or subtract 16 bytes of src to or from 16 column sums.
+template<bool subtract>
+static inline void AccumulateSums16(const uint8* src, uint16* pSums) {
+	const uint8x16_t p = vld1q_u8(src);
+	const uint16x8_t s0 = vld1q_u16(pSums), s1 = vld1q_u16(pSums + 8);
+	vst1q_u16(pSums, subtract ? vsubw_u8(s0, vget_low_u8(p)) : vaddw_u8(s0, vget_low_u8(p)));
+	vst1q_u16(pSums + 8, subtract ? vsubw_u8(s1, vget_high_u8(p)) : vaddw_u8(s1, vget_high_u8(p)));
+}
+
+//Same arithmetic as StretchRow(). The difference wraps in the unsigned widening subtract and is read back as signed.
+static inline void Stretch16(uint8* pPixels, const uint8* pMeans) {
+	const uint8x16_t p = vld1q_u8(pPixels), m = vld1q_u8(pMeans);
+	const int16x8_t
+		offset = vdupq_n_s16(128),
+		d0 = vreinterpretq_s16_u16(vsubl_u8(vget_low_u8(p), vget_low_u8(m))),
+		d1 = vreinterpretq_s16_u16(vsubl_u8(vget_high_u8(p), vget_high_u8(m)));
+	vst1q_u8(pPixels, vcombine_u8(vqmovun_s16(vaddq_s16(vshlq_n_s16(d0, 2), offset)),
+		vqmovun_s16(vaddq_s16(vshlq_n_s16(d1, 2), offset))));
+}
+
+static inline void Threshold16(uint8* pPixels, const uint8* pThresholds) {
+	vst1q_u8(pPixels, vcgeq_u8(vld1q_u8(pPixels), vld1q_u8(pThresholds)));
+}
+
+//Sum of the absolute differences between 16 pixels and their rounded 8.8 accumulator values. Same as BlendRow's output.
+static inline uint32 AccumulatorDifference16(const uint8* pPixels, const uint16* pAccumulator) {
+	const uint8x16_t average = vcombine_u8(vrshrn_n_u16(vld1q_u16(pAccumulator), 8), vrshrn_n_u16(vld1q_u16(pAccumulator + 8), 8));
+	const uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(vabdq_u8(vld1q_u8(pPixels), average))));
+	return (uint32)(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+}
+
+//Same arithmetic as BlendRow(): every step stays within 16 bits.
+static inline void Blend16(uint8* pPixels, uint16* pAccumulator, uint shift) {
+	const uint8x16_t p = vld1q_u8(pPixels);
+	const int16x8_t right = vdupq_n_s16(-(int16)shift), left = vdupq_n_s16((int16)(8 - shift));
+	uint16x8_t a0 = vld1q_u16(pAccumulator), a1 = vld1q_u16(pAccumulator + 8);
+	a0 = vaddq_u16(vsubq_u16(a0, vshlq_u16(a0, right)), vshlq_u16(vmovl_u8(vget_low_u8(p)), left));
+	a1 = vaddq_u16(vsubq_u16(a1, vshlq_u16(a1, right)), vshlq_u16(vmovl_u8(vget_high_u8(p)), left));
+	vst1q_u16(pAccumulator, a0);
+	vst1q_u16(pAccumulator + 8, a1);
+	vst1q_u8(pPixels, vcombine_u8(vrshrn_n_u16(a0, 8), vrshrn_n_u16(a1, 8)));
+}
+
+static inline void Reset16(const uint8* pPixels, uint16* pAccumulator) {
+	const uint8x16_t p = vld1q_u8(pPixels);
+	vst1q_u16(pAccumulator, vshll_n_u8(vget_low_u8(p), 8));
+	vst1q_u16(pAccumulator + 8, vshll_n_u8(vget_high_u8(p), 8));
+}
+
+#elif defined(FRAME_KERNELS_SSE2)
+
+typedef __m128i Pixels8;
+
+static inline Pixels8 LoadPixels8(const uint16* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline void StorePixels8(uint16* p, Pixels8 v) { _mm_storeu_si128((__m128i*)p, v); }
+
+//Reverse the order of the 8 pixels in v.
+static inline Pixels8 ReversePixels8(Pixels8 v) {
+	v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+	v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+	return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+//Same arithmetic as RGB565ToY800(). The weighted sum never exceeds 16 bits so it is done in 16 bit lanes.
+static inline Pixels8 LumaPixels8(Pixels8 p) {
+	const __m128i
+		r = _mm_srli_epi16(_mm_and_si128(p, _mm_set1_epi16((short)0xf800)), 8),
+		g = _mm_srli_epi16(_mm_and_si128(p, _mm_set1_epi16(0x07e0)), 3),
+		b = _mm_slli_epi16(_mm_and_si128(p, _mm_set1_epi16(0x001f)), 3);
+	__m128i y = _mm_mullo_epi16(r, _mm_set1_epi16(77));
+	y = _mm_add_epi16(y, _mm_mullo_epi16(g, _mm_set1_epi16(150)));
+	y = _mm_add_epi16(y, _mm_mullo_epi16(b, _mm_set1_epi16(29)));
+	return _mm_srli_epi16(y, 8);
+}
+
+//Narrow two vectors of luma values to 16 bytes and store them. Luma is at most 250 so packus never saturates.
+static inline void StoreGray16(uint8* p, Pixels8 y0, Pixels8 y1) {
+	_mm_storeu_si128((__m128i*)p, _mm_packus_epi16(y0, y1));
+}
+
+//Average the 8 2x2 blocks made of 16 bytes from src0 and 16 bytes from src1 into 8 bytes. Same rounding as DownscaleRow().
+static inline void Average2x2x8(const uint8* src0, const uint8* src1, uint8* dest) {
+	const __m128i
+		mask = _mm_set1_epi16(0x00ff),
+		a = _mm_loadu_si128((const __m128i*)src0),
+		b = _mm_loadu_si128((const __m128i*)src1);
+	__m128i sum = _mm_add_epi16(_mm_and_si128(a, mask), _mm_srli_epi16(a, 8));
+	sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_and_si128(b, mask), _mm_srli_epi16(b, 8)));
+	sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+	_mm_storel_epi64((__m128i*)dest, _mm_packus_epi16(sum, sum));
+}
+
+//Add (subtract false) or subtract 16 bytes of src to or from 16 column sums.
+template<bool subtract>
+static inline void AccumulateSums16(const uint8* src, uint16* pSums) {
+	const __m128i
+		zero = _mm_setzero_si128(),
+		p = _mm_loadu_si128((const __m128i*)src),
+		p0 = _mm_unpacklo_epi8(p, zero), p1 = _mm_unpackhi_epi8(p, zero),
+		s0 = _mm_loadu_si128((const __m128i*)pSums), s1 = _mm_loadu_si128((const __m128i*)(pSums + 8));
+	_mm_storeu_si128((__m128i*)pSums, subtract ? _mm_sub_epi16(s0, p0) : _mm_add_epi16(s0, p0));
+	_mm_storeu_si128((__m128i*)(pSums + 8), subtract ? _mm_sub_epi16(s1, p1) : _mm_add_epi16(s1, p1));
+}
+
+//Same arithmetic as StretchRow(). 128 + 4 * (pixel - mean) is within -892..1148, so it fits 16 bit lanes and packus
+//does the saturation.
+static inline void Stretch16(uint8* pPixels, const uint8* pMeans) {
+	const __m128i
+		zero = _mm_setzero_si128(),
+		offset = _mm_set1_epi16(128),
+		p = _mm_loadu_si128((const __m128i*)pPixels),
+		m = _mm_loadu_si128((const __m128i*)pMeans),
+		d0 = _mm_sub_epi16(_mm_unpacklo_epi8(p, zero), _mm_unpacklo_epi8(m, zero)),
+		d1 = _mm_sub_epi16(_mm_unpackhi_epi8(p, zero), _mm_unpackhi_epi8(m, zero));
+	_mm_storeu_si128((__m128i*)pPixels, _mm_packus_epi16(_mm_add_epi16(_mm_slli_epi16(d0, 2), offset),
+		_mm_add_epi16(_mm_slli_epi16(d1, 2), offset)));
+}
+
+//SSE2 has no unsigned byte compare: pixel >= threshold exactly where max(pixel, threshold) == pixel.
+static inline void Threshold16(uint8* pPixels, const uint8* pThresholds) {
+	const __m128i p = _mm_loadu_si128((const __m128i*)pPixels), t = _mm_loadu_si128((const __m128i*)pThresholds);
+	_mm_storeu_si128((__m128i*)pPixels, _mm_cmpeq_epi8(_mm_max_epu8(p, t), p));
+}
+
+//Rounded 8.8 accumulator values of 16 pixels as bytes. At most 255 * 256 + 128, so the add doesn't wrap.
+static inline __m128i AccumulatorAverage16(__m128i a0, __m128i a1) {
+	const __m128i half = _mm_set1_epi16(128);
+	return _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(a0, half), 8), _mm_srli_epi16(_mm_add_epi16(a1, half), 8));
+}
+
+//Sum of the absolute differences between 16 pixels and their rounded 8.8 accumulator values. Same as BlendRow's output.
+static inline uint32 AccumulatorDifference16(const uint8* pPixels, const uint16* pAccumulator) {
+	const __m128i
+		average = AccumulatorAverage16(_mm_loadu_si128((const __m128i*)pAccumulator),
+			_mm_loadu_si128((const __m128i*)(pAccumulator + 8))),
+		sad = _mm_sad_epu8(_mm_loadu_si128((const __m128i*)pPixels), average);
+	return (uint32)(_mm_cvtsi128_si32(sad) + _mm_cvtsi128_si32(_mm_srli_si128(sad, 8)));
+}
+
+//Same arithmetic as BlendRow(): every step stays within 16 bits.
+static inline void Blend16(uint8* pPixels, uint16* pAccumulator, uint shift) {
+	const __m128i
+		zero = _mm_setzero_si128(),
+		right = _mm_cvtsi32_si128((int)shift),
+		left = _mm_cvtsi32_si128((int)(8 - shift)),
+		p = _mm_loadu_si128((const __m128i*)pPixels);
+	__m128i a0 = _mm_loadu_si128((const __m128i*)pAccumulator), a1 = _mm_loadu_si128((const __m128i*)(pAccumulator + 8));
+	a0 = _mm_add_epi16(_mm_sub_epi16(a0, _mm_srl_epi16(a0, right)), _mm_sll_epi16(_mm_unpacklo_epi8(p, zero), left));
+	a1 = _mm_add_epi16(_mm_sub_epi16(a1, _mm_srl_epi16(a1, right)), _mm_sll_epi16(_mm_unpackhi_epi8(p, zero), left));
+	_mm_storeu_si128((__m128i*)pAccumulator, a0);
+	_mm_storeu_si128((__m128i*)(pAccumulator + 8), a1);
+	_mm_storeu_si128((__m128i*)pPixels, AccumulatorAverage16(a0, a1));
+}
+
+//Pixel << 8 is the pixel unpacked as the high byte of its lane.
+static inline void Reset16(const uint8* pPixels, uint16* pAccumulator) {
+	const __m128i zero = _mm_setzero_si128(), p = _mm_loadu_si128((const __m128i*)pPixels);
+	_mm_storeu_si128((__m128i*)pAccumulator, _mm_unpacklo_epi8(zero, p));
+	_mm_storeu_si128((__m128i*)(pAccumulator + 8), _mm_unpackhi_epi8(zero, p));
+}
+
+#endif
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//ROW KERNELS
+
+//Copy n pixels from src to destPreview and their Y800 values to destGray.
+template<bool useSimd>
+static void CopyRow(const uint16* src, uint16* destPreview, uint8* destGray, uint n) {
+#ifdef FRAME_KERNELS_SIMD
+	if(useSimd) {
+		for(; n >= 16; n -= 16, src += 16, destPreview += 16, destGray += 16) {
+			const Pixels8 p0 = LoadPixels8(src), p1 = LoadPixels8(src + 8);
+			StorePixels8(destPreview, p0);
+			StorePixels8(destPreview + 8, p1);
+			StoreGray16(destGray, LumaPixels8(p0), LumaPixels8(p1));
+		}
+	}
+#endif
+	for(; n; --n) {
+		const uint16 p = *src++;
+		*destPreview++ = p;
+		*destGray++ = RGB565ToY800(p);
+	}
+}
+
+//Same as CopyRow but src points at the last pixel of the row and is read right to left.
+template<bool useSimd>
+static void CopyRowReversed(const uint16* src, uint16* destPreview, uint8* destGray, uint n) {
+#ifdef FRAME_KERNELS_SIMD
+	if(useSimd) {
+		for(; n >= 16; n -= 16, src -= 16, destPreview += 16, destGray += 16) {
+			const Pixels8
+				p0 = ReversePixels8(LoadPixels8(src - 7)),
+				p1 = ReversePixels8(LoadPixels8(src - 15));
+			StorePixels8(destPreview, p0);
+			StorePixels8(destPreview + 8, p1);
+			StoreGray16(destGray, LumaPixels8(p0), LumaPixels8(p1));
+		}
+	}
+#endif
+	for(; n; --n) {
+		const uint16 p = *src--;
+		*destPreview++ = p;
+		*destGray++ = RGB565ToY800(p);
+	}
+}
+
+//Convert n RGB565 pixels to Y800.
+template<bool useSimd>
+static void ConvertRow(const uint16* src, uint8* dest, uint n) {
+#ifdef FRAME_KERNELS_SIMD
+	if(useSimd) {
+		for(; n >= 16; n -= 16, src += 16, dest += 16)
+			StoreGray16(dest, LumaPixels8(LoadPixels8(src)), LumaPixels8(LoadPixels8(src + 8)));
+	}
+#endif
+	for(; n; --n)
+		*dest++ = RGB565ToY800(*src++);
+}
+
+//Write n pixels to dest, each the rounded average of a 2x2 block made of two pixels of src0 and the two below them in src1.
+template<bool useSimd>
+static void DownscaleRow(const uint8* src0, const uint8* src1, uint8* dest, uint n) {
+#ifdef FRAME_KERNELS_SIMD
+	if(useSimd) {
+		for(; n >= 8; n -= 8, src0 += 16, src1 += 16, dest += 8)
+			Average2x2x8(src0, src1, dest);
+	}
+#endif
+	for(; n; --n, src0 += 2, src1 += 2)
+		*dest++ = (uint8)((src0[0] + src0[1] + src1[0] + src1[1] + 2) >> 2);
+}
+
+//Add (subtract false) or subtract n pixels of src to or from n column sums.
+template<bool useSimd, bool subtract>
+static void AccumulateRow(const uint8* src, uint16* pSums, uint n) {
+#ifdef FRAME_KERNELS_SIMD
+	if(useSimd) {
+		for(; n >= 16; n -= 16, src += 16, pSums += 16)
+			AccumulateSums16<subtract>(src, pSums);
+	}
+#endif
+	for(; n; --n, ++pSums)
+		*pSums = (uint16)(subtract ? *pSums - *src++ : *pSums + *src++);
+}
+
+template<bool useSimd>
+static void StretchRow(uint8* pPixels, const uint8* pMeans, uint n) {
+#ifdef FRAME_KERNELS_SIMD
+	if(useSimd) {
+		for(; n >= 16; n -= 16, pPixels += 16, pMeans += 16)
+			Stretch16(pPixels, pMeans);
+	}
+#endif
+	for(; n; --n, ++pPixels) {
+		const int value = 128 + ((int)*pPixels - (int)*pMeans++) * 4;
+		*pPixels = (uint8)(value < 0 ? 0 : (value > 255 ? 255 : value));
+	}
+}
+
+template<bool useSimd>
+static void ThresholdRow(uint8* pPixels, const uint8* pThresholds, uint n) {
+#ifdef FRAME_KERNELS_SIMD
+	if(useSimd) {
+		for(; n >= 16; n -= 16, pPixels += 16, pThresholds += 16)
+			Threshold16(pPixels, pThresholds);
+	}
+#endif
+	for(; n; --n, ++pPixels)
+		*pPixels = *pPixels >= *pThresholds++ ? 255 : 0;
+}
+
+//Add the difference of every tile of 16 pixels (the last one may be shorter) to its entry in pTileSums.
+template<bool useSimd>
+static void DifferenceRow(const uint8* pPixels, const uint16* pAccumulator, uint n, uint32* pTileSums) {
+	for(; n; pPixels += 16, pAccumulator += 16, ++pTileSums) {
+		const uint count = n < 16 ? n : 16;
+		n -= count;
+#ifdef FRAME_KERNELS_SIMD
+		if(useSimd && count == 16) {
+			*pTileSums += AccumulatorDifference16(pPixels, pAccumulator);
+			continue;
+		}
+#endif
+		for(uint i = 0; i < count; ++i) {
+			const int d = (int)pPixels[i] - (int)((pAccumulator[i] + 128) >> 8);
+			*pTileSums += d < 0 ? -d : d;
+		}
+	}
+}
+
+//Running average of the pixels in 16 bit 8.8 fixed point: a -= a >> shift, then a += pixel << (8 - shift), so a new
+//frame weighs 1 / 2^shift and a is at most 255 << 8. The pixel is replaced with the rounded average. In a tile flagged
+//in pTileMoved the average restarts from the pixel instead, which is left as it is.
+template<bool useSimd>
+static void BlendRow(uint8* pPixels, uint16* pAccumulator, uint n, const uint8* pTileMoved, uint shift) {
+	for(; n; pPixels += 16, pAccumulator += 16, ++pTileMoved) {
+		const uint count = n < 16 ? n : 16;
+		n -= count;
+#ifdef FRAME_KERNELS_SIMD
+		if(useSimd && count == 16) {
+			if(*pTileMoved)
+				Reset16(pPixels, pAccumulator);
+			else
+				Blend16(pPixels, pAccumulator, shift);
+			continue;
+		}
+#endif
+		for(uint i = 0; i < count; ++i) {
+			if(*pTileMoved) {
+				pAccumulator[i] = (uint16)(pPixels[i] << 8);
+				continue;
+			}
+			const uint a = pAccumulator[i] - (pAccumulator[i] >> shift) + (pPixels[i] << (8 - shift));
+			pAccumulator[i] = (uint16)a;
+			pPixels[i] = (uint8)((a + 128) >> 8);
+		}
+	}
+}
+
+//Rotate a crop by 90 or 270 degrees into pPreview one band at a time and convert each band to Y800 right after it.
+template<bool useSimd, FrameRotation rotation>
+static void RotateRGB565(const uint16* pFrame, uint framePitch, uint cropX, uint cropY, uint dim,
+	uint16* pPreview, uint8* pGray) {
+	PlainSource<uint16> source(pFrame, framePitch, cropX, cropY);
+	const uint bandLines = ROTATE_BAND_BYTES / sizeof(uint16);
+	for(uint i = 0; i < dim; i += bandLines) {
+		const uint lines = dim - i < bandLines ? dim - i : bandLines;
+		RotateBand<useSimd, uint16, rotation>(source, dim, i, lines, pPreview);
+		ConvertRow<useSimd>(pPreview + i * dim, pGray + i * dim, lines * dim);
+	}
+}
+
+//The dest pointers are always written to in the way a book is read (line by line).
+//The src pointer is read from in a manner that accomplishes rotation (not necessarily like a book).
+//Rows that are contiguous in the frame (ROTNORMAL, ROT180) are converted straight from the frame. Rotated columns
+//(ROT90, ROT270) are transposed into the preview a band at a time by RotateBand and converted while the band is in L1.
+template<bool useSimd>
+static void CropRotate(const uint16* pFrame, uint framePitch, uint cropX, uint cropY, uint dim, FrameRotation rotation,
+	uint16* pPreview, uint8* pGray) {
+	const uint16* src = pFrame + cropX + cropY * framePitch; //Top left corner of the cropping square
+	const int pitch = (int)framePitch;
+
+	switch(rotation) {
+		case FRAME_ROTNORMAL: { //Perform no rotation. Just copy cropped area.
+			for(uint i = dim; i; --i, src += pitch, pPreview += dim, pGray += dim)
+				CopyRow<useSimd>(src, pPreview, pGray, dim);
+			break;
+		}
+		case FRAME_ROT90: { //Rotate 90 degrees CCW. Line i is the crop column dim-1-i read top to bottom.
+			RotateRGB565<useSimd, FRAME_ROT90>(pFrame, framePitch, cropX, cropY, dim, pPreview, pGray);
+			break;
+		}
+		case FRAME_ROT180: { //Rotate 180 degrees. Line i is the crop line dim-1-i read right to left.
+			src += (dim - 1) * pitch + dim - 1;
+			for(uint i = dim; i; --i, src -= pitch, pPreview += dim, pGray += dim)
+				CopyRowReversed<useSimd>(src, pPreview, pGray, dim);
+			break;
+		}
+		case FRAME_ROT270: { //Rotate 90 degrees CW. Line i is the crop column i read bottom to top.
+			RotateRGB565<useSimd, FRAME_ROT270>(pFrame, framePitch, cropX, cropY, dim, pPreview, pGray);
+			break;
+		}
+	}
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//PUBLIC FUNCTIONS
+
+const char* FrameKernelsVariant() {
+#if defined(FRAME_KERNELS_NEON)
+	return "NEON";
+#elif defined(FRAME_KERNELS_SSE2)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+
+void CropRotateRGB565(const uint16* pFrame, uint framePitch, uint cropX, uint cropY, uint dim, FrameRotation rotation,
+	uint16* pPreview, uint8* pGray) {
+	CropRotate<true>(pFrame, framePitch, cropX, cropY, dim, rotation, pPreview, pGray);
+}
+
+void CropRotateRGB565Scalar(const uint16* pFrame, uint framePitch, uint cropX, uint cropY, uint dim, FrameRotation rotation,
+	uint16* pPreview, uint8* pGray) {
+	CropRotate<false>(pFrame, framePitch, cropX, cropY, dim, rotation, pPreview, pGray);
+}
+
+void CropRotateY800(const uint8* pY, uint yPitch, uint cropX, uint cropY, uint dim, FrameRotation rotation, uint8* pDest) {
+	PlainSource<uint8> source(pY, yPitch, cropX, cropY);
+	CropRotatePlain<true>(source, dim, rotation, pDest);
+}
+
+void CropRotateBGRA8888(const uint32* pFrame, uint framePitch, uint cropX, uint cropY, uint dim, FrameRotation rotation,
+	uint32* pDest) {
+	PlainSource<uint32> source(pFrame, framePitch, cropX, cropY);
+	CropRotatePlain<true>(source, dim, rotation, pDest);
+}
+
+void ConvertRGB565ToY800(const uint16* src, uint8* dest, uint numPixels) {
+	ConvertRow<true>(src, dest, numPixels);
+}
+
+void ConvertRGB888ToY800(const uint8* src, uint8* dest, uint numPixels) {
+	for(; numPixels; --numPixels, src += 3)
+		*dest++ = (uint8)((77*src[0] + 150*src[1] + 29*src[2]) >> 8); //Max is (256*255) >> 8 = 255
+}
+
+//Convert one BT.601 video range YUV sample to RGB565 with 8 bit fixed point coefficients.
+static inline uint16 YUVToRGB565(int y, int u, int v) {
+	const int c = 298 * (y - 16) + 128, d = u - 128, e = v - 128;
+	int r = (c + 409*e) >> 8, g = (c - 100*d - 208*e) >> 8, b = (c + 516*d) >> 8;
+	r = r < 0 ? 0 : (r > 255 ? 255 : r);
+	g = g < 0 ? 0 : (g > 255 ? 255 : g);
+	b = b < 0 ? 0 : (b > 255 ? 255 : b);
+	return (uint16)(((r & 0xf8) << 8) | ((g & 0xfc) << 3) | (b >> 3));
+}
+
+//Rotation source that converts the blocks RotateBand asks for from YUV 4:2:0 semi-planar to RGB565. Every crop pixel is
+//converted once, from rows of the luma and chroma planes.
+struct YUV420SPSource {
+	const uint8* pY;
+	uint yPitch;
+	const uint8* pUV;
+	uint uvPitch;
+	uint cropX, cropY;
+	int uOffset, vOffset;
+	uint16 block[ROTATE_TILE * ROTATE_BAND_BYTES / sizeof(uint16)];
+
+	const uint16* Block(uint x, uint y, uint w, uint h, int* pPitch) {
+		uint16* dest = block;
+		for(uint fy = cropY + y; h; --h, ++fy) {
+			const uint8* srcY = pY + fy * yPitch;
+			const uint8* srcUV = pUV + (fy >> 1) * uvPitch;
+			for(uint fx = cropX + x, n = w; n; --n, ++fx) {
+				const uint8* uv = srcUV + (fx & ~1u);
+				*dest++ = YUVToRGB565(srcY[fx], uv[uOffset], uv[vOffset]);
+			}
+		}
+		*pPitch = (int)w;
+		return block;
+	}
+
+	uint16 Get(uint x, uint y) const {
+		const uint fx = cropX + x, fy = cropY + y;
+		const uint8* uv = pUV + (fy >> 1) * uvPitch + (fx & ~1u);
+		return YUVToRGB565(pY[fy * yPitch + fx], uv[uOffset], uv[vOffset]);
+	}
+};
+
+void CropRotateYUV420SPToRGB565(const uint8* pY, uint yPitch, const uint8* pUV, uint uvPitch, bool vuOrder,
+	uint cropX, uint cropY, uint dim, FrameRotation rotation, uint16* pPreview) {
+	const int uOffset = vuOrder ? 1 : 0, vOffset = vuOrder ? 0 : 1;
+	if(rotation == FRAME_ROT90 || rotation == FRAME_ROT270) {
+		YUV420SPSource source = { pY, yPitch, pUV, uvPitch, cropX, cropY, uOffset, vOffset };
+		const uint bandLines = ROTATE_BAND_BYTES / sizeof(uint16);
+		for(uint i = 0; i < dim; i += bandLines) {
+			const uint lines = dim - i < bandLines ? dim - i : bandLines;
+			if(rotation == FRAME_ROT90)
+				RotateBand<true, uint16, FRAME_ROT90>(source, dim, i, lines, pPreview);
+			else
+				RotateBand<true, uint16, FRAME_ROT270>(source, dim, i, lines, pPreview);
+		}
+		return;
+	}
+
+	//Each dest line walks the crop from (x, y) in steps of (dx, dy). At the end of a line (x, y) moves by (lineX, lineY).
+	int x, y, dx, lineY;
+	const int last = (int)dim - 1;
+	if(rotation == FRAME_ROT180) {
+		x = last; y = last; dx = -1; lineY = -1; //Line i is line dim-1-i, right to left
+	}
+	else {
+		x = 0; y = 0; dx = 1; lineY = 1; //Line i is line i, left to right
+	}
+
+	for(uint i = dim; i; --i, y += lineY) {
+		int sx = x;
+		for(uint j = dim; j; --j, sx += dx) {
+			const uint fx = cropX + sx, fy = cropY + y;
+			const uint8* uv = pUV + (fy >> 1) * uvPitch + (fx & ~1u);
+			*pPreview++ = YUVToRGB565(pY[fy * yPitch + fx], uv[uOffset], uv[vOffset]);
+		}
+	}
+}
+
+void ScaleCropRGB565(const uint16* pFrame, uint framePitch, uint cropX, uint cropY, uint dim, uint scaledDim,
+	FrameRotation rotation, uint16* pDest) {
+	PlainSource<uint16> source(pFrame, framePitch, cropX, cropY);
+	if(scaledDim == dim)
+		CropRotatePlain<true>(source, dim, rotation, pDest);
+	else
+		ScaleCrop(source, dim, scaledDim, rotation, pDest);
+}
+
+void ScaleCropYUV420SPToRGB565(const uint8* pY, uint yPitch, const uint8* pUV, uint uvPitch, bool vuOrder,
+	uint cropX, uint cropY, uint dim, uint scaledDim, FrameRotation rotation, uint16* pDest) {
+	if(scaledDim == dim) {
+		CropRotateYUV420SPToRGB565(pY, yPitch, pUV, uvPitch, vuOrder, cropX, cropY, dim, rotation, pDest);
+		return;
+	}
+	const YUV420SPSource source = { pY, yPitch, pUV, uvPitch, cropX, cropY, vuOrder ? 1 : 0, vuOrder ? 0 : 1 };
+	ScaleCrop(source, dim, scaledDim, rotation, pDest); //Only the sampled pixels are color converted
+}
+
+void CropRGB565ToY800(const uint16* pFrame, uint framePitch, uint cropX, uint cropY, uint dim, uint8* pGray) {
+	const uint16* src = pFrame + cropX + cropY * framePitch;
+	for(uint i = dim; i; --i, src += framePitch, pGray += dim)
+		ConvertRow<true>(src, pGray, dim);
+}
+
+void CropY800(const uint8* pY, uint yPitch, uint cropX, uint cropY, uint dim, uint8* pGray) {
+	const uint8* src = pY + cropX + cropY * yPitch;
+	for(uint i = dim; i; --i, src += yPitch, pGray += dim)
+		memcpy(pGray, src, dim);
+}
+
+void AddY800ToSums(const uint8* src, uint16* pSums, uint n) {
+	AccumulateRow<true, false>(src, pSums, n);
+}
+
+void SubtractY800FromSums(const uint8* src, uint16* pSums, uint n) {
+	AccumulateRow<true, true>(src, pSums, n);
+}
+
+void StretchY800(uint8* pPixels, const uint8* pMeans, uint n) {
+	StretchRow<true>(pPixels, pMeans, n);
+}
+
+void ThresholdY800(uint8* pPixels, const uint8* pThresholds, uint n) {
+	ThresholdRow<true>(pPixels, pThresholds, n);
+}
+
+void AddAccumulatorDifferences(const uint8* pPixels, const uint16* pAccumulator, uint n, uint32* pTileSums) {
+	DifferenceRow<true>(pPixels, pAccumulator, n, pTileSums);
+}
+
+void BlendIntoAccumulator(uint8* pPixels, uint16* pAccumulator, uint n, const uint8* pTileMoved, uint shift) {
+	BlendRow<true>(pPixels, pAccumulator, n, pTileMoved, shift);
+}
+
+void DownscaleY800By2(const uint8* src, uint srcPitch, uint width, uint height, uint8* dest) {
+	const uint destWidth = width / 2;
+	for(uint i = height / 2; i; --i, src += 2 * srcPitch, dest += destWidth)
+		DownscaleRow<true>(src, src + srcPitch, dest, destWidth);
+}
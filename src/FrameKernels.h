@@ -0,0 +1,97 @@
+#ifndef FRAME_KERNELS_H
+#define FRAME_KERNELS_H
+
+#include "ScanTypes.h"
+
+//Pixel kernels used on every camera frame. Each kernel has a NEON and an SSE2 path that is selected at compile time
+//and a scalar fallback. All paths produce bit-identical output. Rotations by 90 and 270 degrees go through the cache
+//blocked transposes in RotateEngine.h.
+
+//Name of the kernel variant compiled in ("NEON", "SSE2" or "scalar"). Used for tracing.
+const char* FrameKernelsVariant();
+
+//Convert a single RGB565 pixel to Y800 (grayscale) with the 77/150/29 luma weights.
+inline uint8 RGB565ToY800(uint16 pixel) {
+	const uint
+		r = (pixel & 0xf800) >> 8,
+		g = (pixel & 0x07e0) >> 3,
+		b = (pixel & 0x001f) << 3;
+	return (uint8)((77*r + 150*g + 29*b) >> 8); //Max is (77*248 + 150*252 + 29*248) >> 8 = 250, no clamping needed
+}
+
+//Crop a dim x dim square with its top left corner at (cropX, cropY) out of an RGB565 frame, rotate it upright and write it
+//to pPreview (RGB565) and pGray (Y800) in a single pass over pFrame. framePitch is the frame row length in pixels.
+//Both destination buffers are written line by line and must hold dim * dim pixels.
+void CropRotateRGB565(const uint16* pFrame, uint framePitch, uint cropX, uint cropY, uint dim, FrameRotation rotation,
+	uint16* pPreview, uint8* pGray);
+
+//Same as CropRotateRGB565 but always uses the scalar code. Used to verify the SIMD paths.
+void CropRotateRGB565Scalar(const uint16* pFrame, uint framePitch, uint cropX, uint cropY, uint dim, FrameRotation rotation,
+	uint16* pPreview, uint8* pGray);
+
+//Crop a dim x dim square out of a Y800 plane and rotate it upright into pDest, which is written line by line.
+void CropRotateY800(const uint8* pY, uint yPitch, uint cropX, uint cropY, uint dim, FrameRotation rotation, uint8* pDest);
+
+//Crop a dim x dim square out of a BGRA8888 frame and rotate it upright into pDest, which is written line by line.
+//framePitch is the frame row length in pixels.
+void CropRotateBGRA8888(const uint32* pFrame, uint framePitch, uint cropX, uint cropY, uint dim, FrameRotation rotation,
+	uint32* pDest);
+
+//Convert numPixels RGB565 pixels to Y800.
+void ConvertRGB565ToY800(const uint16* src, uint8* dest, uint numPixels);
+
+//Convert numPixels RGB888 pixels (R, G, B bytes, e.g. a PPM image) to Y800 with the RGB565ToY800 weights.
+void ConvertRGB888ToY800(const uint8* src, uint8* dest, uint numPixels);
+
+//Crop a dim x dim square out of a YUV 4:2:0 semi-planar frame (NV21 or NV12), rotate it upright and convert it to RGB565
+//into pPreview. pUV points at the interleaved chroma plane. vuOrder is true for NV21 (V first) and false for NV12.
+//cropX and cropY are in luma pixels.
+void CropRotateYUV420SPToRGB565(const uint8* pY, uint yPitch, const uint8* pUV, uint uvPitch, bool vuOrder,
+	uint cropX, uint cropY, uint dim, FrameRotation rotation, uint16* pPreview);
+
+//Crop a dim x dim square out of an RGB565 frame, rotate it upright and shrink it to scaledDim x scaledDim (nearest
+//neighbour, scaledDim <= dim) into pDest line by line. Used for a preview at display size. scaledDim == dim is a plain
+//crop and rotate.
+void ScaleCropRGB565(const uint16* pFrame, uint framePitch, uint cropX, uint cropY, uint dim, uint scaledDim,
+	FrameRotation rotation, uint16* pDest);
+
+//Same as ScaleCropRGB565 for a YUV 4:2:0 semi-planar frame converted to RGB565 (see CropRotateYUV420SPToRGB565).
+//Only the pixels sampled are converted.
+void ScaleCropYUV420SPToRGB565(const uint8* pY, uint yPitch, const uint8* pUV, uint uvPitch, bool vuOrder,
+	uint cropX, uint cropY, uint dim, uint scaledDim, FrameRotation rotation, uint16* pDest);
+
+//Convert a dim x dim square of an RGB565 frame to Y800 into pGray line by line, without rotating it (see CropY800).
+void CropRGB565ToY800(const uint16* pFrame, uint framePitch, uint cropX, uint cropY, uint dim, uint8* pGray);
+
+//Copy a dim x dim square out of a luma plane into pGray line by line. The square is not rotated: ZBar finds codes in any
+//orientation, so rotating the scan buffer would be wasted work.
+void CropY800(const uint8* pY, uint yPitch, uint cropX, uint cropY, uint dim, uint8* pGray);
+
+//Add the n pixels of a Y800 row to n 16 bit column sums, for box filters that slide down a frame (see ScanEnhance).
+void AddY800ToSums(const uint8* src, uint16* pSums, uint n);
+
+//Take the n pixels of a Y800 row away from n 16 bit column sums.
+void SubtractY800FromSums(const uint8* src, uint16* pSums, uint n);
+
+//Local contrast stretch of n Y800 pixels in place: each becomes 128 + 4 * (pixel - mean), saturated to 0-255, where mean
+//is the pixel's entry in pMeans.
+void StretchY800(uint8* pPixels, const uint8* pMeans, uint n);
+
+//Binarize n Y800 pixels in place: 255 where the pixel is at least its entry in pThresholds, 0 below it.
+void ThresholdY800(uint8* pPixels, const uint8* pThresholds, uint n);
+
+//Temporal denoising (see ScanDenoise.h) of n Y800 pixels against a running average kept per pixel in 8.8 fixed point,
+//in tiles of 16 pixels. Add each tile's sum of absolute differences between the pixels and their rounded averages to
+//its entry in pTileSums, the last tile may be shorter.
+void AddAccumulatorDifferences(const uint8* pPixels, const uint16* pAccumulator, uint n, uint32* pTileSums);
+
+//Blend n Y800 pixels into their running averages with a weight of 1 / 2^shift (shift 1 to 8) and replace each pixel with
+//its new rounded average. In a tile of 16 pixels flagged in pTileMoved the average restarts from the pixels, which are
+//left as they are.
+void BlendIntoAccumulator(uint8* pPixels, uint16* pAccumulator, uint n, const uint8* pTileMoved, uint shift);
+
+//Halve a width x height Y800 image with a 2x2 box filter. srcPitch is the source row length in pixels. dest is written
+//line by line and must hold (width / 2) * (height / 2) pixels. An odd last column or line is dropped.
+void DownscaleY800By2(const uint8* src, uint srcPitch, uint width, uint height, uint8* dest);
+
+#endif
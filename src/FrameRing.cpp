@@ -0,0 +1,60 @@
+#include "FrameRing.h"
+#include "ScanThread.h"
+
+#include <string.h>
+
+#define FRAME_RING_FRESH 0x4
+#define FRAME_RING_INDEX_MASK 0x3
+
+void FrameRingInit(FrameRing* pRing) {
+	memset(pRing, 0, sizeof(FrameRing));
+	pRing->back = 0;
+	pRing->shared = 1;
+	pRing->front = 2;
+	BufferPoolInit(&pRing->pool);
+}
+
+void FrameRingRelease(FrameRing* pRing) {
+	for(uint i = 0; i < 3; ++i)
+		BufferPoolPut(&pRing->pool, pRing->slots[i].pPixels);
+	BufferPoolRelease(&pRing->pool);
+	FrameRingInit(pRing);
+}
+
+FrameSlot* FrameRingBeginWrite(FrameRing* pRing, uint width, uint height) {
+	FrameSlot* pSlot = &pRing->slots[pRing->back];
+	if(pSlot->pPixels == NULL || width != pSlot->width || height != pSlot->height) {
+		//The back slot belongs to the producer, so its buffer can be swapped without telling the consumer.
+		BufferPoolPut(&pRing->pool, pSlot->pPixels);
+		pSlot->pPixels = (uint8*)BufferPoolAcquire(&pRing->pool, width, height, BUFFER_FORMAT_Y800);
+		if(pSlot->pPixels == NULL)
+			return NULL;
+	}
+	pSlot->width = width;
+	pSlot->height = height;
+	return pSlot;
+}
+
+bool FrameRingPublish(FrameRing* pRing, uint64 timestamp) {
+	FrameSlot* pSlot = &pRing->slots[pRing->back];
+	pSlot->sequence = pRing->nextSequence++;
+	pSlot->timestamp = timestamp;
+
+	//Swap the written slot into the middle and take whatever was there as the next back slot.
+	const int32 previous = AtomicExchange(&pRing->shared, pRing->back | FRAME_RING_FRESH);
+	pRing->back = previous & FRAME_RING_INDEX_MASK;
+	if(previous & FRAME_RING_FRESH) {
+		AtomicAdd(&pRing->dropped, 1);
+		return true;
+	}
+	return false;
+}
+
+FrameSlot* FrameRingAcquire(FrameRing* pRing) {
+	//Only the producer sets the fresh flag, so once seen it can't disappear before the exchange below.
+	if(!(AtomicLoad(&pRing->shared) & FRAME_RING_FRESH))
+		return NULL;
+	const int32 previous = AtomicExchange(&pRing->shared, pRing->front);
+	pRing->front = previous & FRAME_RING_INDEX_MASK;
+	return &pRing->slots[pRing->front];
+}
@@ -0,0 +1,47 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include "BufferPool.h"
+#include "ScanQuality.h"
+
+//Lock-free triple buffer of grayscale frames between one producer (the camera callback) and one consumer (the scan
+//worker). The producer always has a slot to write to and never waits. The consumer always gets the newest published
+//frame; frames published while the consumer was busy are overwritten and counted as dropped.
+//Slot buffers come from a BufferPool owned by the producer, so switching between frame sizes reuses earlier buffers.
+
+struct FrameSlot {
+	uint8* pPixels; //Y800 pixels, width * height bytes, line by line. Taken from FrameRing::pool for this size.
+	uint width;
+	uint height;
+	uint32 sequence; //Incremented by the producer for every published frame
+	uint64 timestamp; //ScanClockNs() time the frame was captured
+	FrameQuality quality; //Set by the producer with ComputeFrameQuality, for the scan worker's quality gate
+};
+
+struct FrameRing {
+	FrameSlot slots[3];
+	volatile int32 shared; //Index of the slot in the middle, ORed with FRAME_RING_FRESH when it holds an unread frame
+	int32 back; //Slot owned by the producer
+	int32 front; //Slot owned by the consumer
+	uint32 nextSequence;
+	volatile int32 dropped; //Number of published frames that were never read
+	BufferPool pool; //Used by the producer only
+};
+
+//Set up an empty ring. No pixel memory is allocated until the first FrameRingBeginWrite.
+void FrameRingInit(FrameRing* pRing);
+
+//Free all slot buffers. Neither side may be using the ring.
+void FrameRingRelease(FrameRing* pRing);
+
+//Producer: get the slot to write the next frame into, with a width x height pixel buffer. Returns NULL if out of memory.
+FrameSlot* FrameRingBeginWrite(FrameRing* pRing, uint width, uint height);
+
+//Producer: publish the slot returned by FrameRingBeginWrite. Returns true if an unread frame was dropped to make room.
+bool FrameRingPublish(FrameRing* pRing, uint64 timestamp);
+
+//Consumer: take the newest published frame. Returns NULL if nothing was published since the last call.
+//The slot stays valid until the next FrameRingAcquire.
+FrameSlot* FrameRingAcquire(FrameRing* pRing);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef FRAME_SIMD_H
+#define FRAME_SIMD_H
+
+//Pick a SIMD instruction set at compile time for the frame kernels. FRAME_KERNELS_SIMD is defined when either is available.
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+	#include <arm_neon.h>
+	#define FRAME_KERNELS_NEON
+	#define FRAME_KERNELS_SIMD
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define FRAME_KERNELS_SSE2
+	#define FRAME_KERNELS_SIMD
+#endif
+
+#endif
@@ -0,0 +1,319 @@
+#ifndef ROTATE_ENGINE_H
+#define ROTATE_ENGINE_H
+
+#include "FrameSimd.h"
+#include "ScanTypes.h"
+
+#include <string.h>
+
+//Cache blocked crop and rotate, specialized at compile time for the pixel type (uint8 Y800, uint16 RGB565, uint32
+//BGRA8888) and the rotation.
+//A 90 or 270 degree rotation turns frame columns into destination lines. Reading a column one pixel at a time touches a
+//new cache line for every pixel, so the destination is instead built in bands of ROTATE_BAND_BYTES / sizeof(Pixel) lines.
+//A band reads one cache line from each frame row, transposes it in 8x8 tiles and writes the band lines 8 pixels at a
+//time, so every byte of every cache line fetched is used. The band is small enough to still be in L1 when the caller
+//converts it further (see CropRotateRGB565).
+
+#define ROTATE_BAND_BYTES 64 //One cache line of each frame row per band
+#define ROTATE_TILE 8
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//TILE TRANSPOSES
+
+//dest[a * destPitch + b] = src[b * srcPitch + a] for a < w, b < h. Pitches are in pixels and may be negative.
+template<typename Pixel>
+static inline void TransposeBlock(const Pixel* src, int srcPitch, Pixel* dest, int destPitch, uint w, uint h) {
+	for(uint a = 0; a < w; ++a, dest += destPitch) {
+		const Pixel* s = src + a;
+		for(uint b = 0; b < h; ++b, s += srcPitch)
+			dest[b] = *s;
+	}
+}
+
+#if defined(FRAME_KERNELS_NEON)
+
+static inline void TransposeSimd8x8(const uint8* src, int srcPitch, uint8* dest, int destPitch) {
+	uint8x8_t r[8];
+	for(int i = 0; i < 8; ++i, src += srcPitch)
+		r[i] = vld1_u8(src);
+
+	//Swap bytes, then 16 bit pairs, then 32 bit quads between neighbouring lines
+	const uint8x8x2_t
+		t01 = vtrn_u8(r[0], r[1]), t23 = vtrn_u8(r[2], r[3]),
+		t45 = vtrn_u8(r[4], r[5]), t67 = vtrn_u8(r[6], r[7]);
+	const uint16x4x2_t
+		u02 = vtrn_u16(vreinterpret_u16_u8(t01.val[0]), vreinterpret_u16_u8(t23.val[0])), //Columns 0 4 and 2 6 of lines 0-3
+		u13 = vtrn_u16(vreinterpret_u16_u8(t01.val[1]), vreinterpret_u16_u8(t23.val[1])), //Columns 1 5 and 3 7 of lines 0-3
+		v02 = vtrn_u16(vreinterpret_u16_u8(t45.val[0]), vreinterpret_u16_u8(t67.val[0])),
+		v13 = vtrn_u16(vreinterpret_u16_u8(t45.val[1]), vreinterpret_u16_u8(t67.val[1]));
+	const uint32x2x2_t
+		c04 = vtrn_u32(vreinterpret_u32_u16(u02.val[0]), vreinterpret_u32_u16(v02.val[0])),
+		c26 = vtrn_u32(vreinterpret_u32_u16(u02.val[1]), vreinterpret_u32_u16(v02.val[1])),
+		c15 = vtrn_u32(vreinterpret_u32_u16(u13.val[0]), vreinterpret_u32_u16(v13.val[0])),
+		c37 = vtrn_u32(vreinterpret_u32_u16(u13.val[1]), vreinterpret_u32_u16(v13.val[1]));
+
+	vst1_u8(dest, vreinterpret_u8_u32(c04.val[0])); dest += destPitch;
+	vst1_u8(dest, vreinterpret_u8_u32(c15.val[0])); dest += destPitch;
+	vst1_u8(dest, vreinterpret_u8_u32(c26.val[0])); dest += destPitch;
+	vst1_u8(dest, vreinterpret_u8_u32(c37.val[0])); dest += destPitch;
+	vst1_u8(dest, vreinterpret_u8_u32(c04.val[1])); dest += destPitch;
+	vst1_u8(dest, vreinterpret_u8_u32(c15.val[1])); dest += destPitch;
+	vst1_u8(dest, vreinterpret_u8_u32(c26.val[1])); dest += destPitch;
+	vst1_u8(dest, vreinterpret_u8_u32(c37.val[1]));
+}
+
+static inline void TransposeSimd8x8(const uint16* src, int srcPitch, uint16* dest, int destPitch) {
+	uint16x8_t r[8];
+	for(int i = 0; i < 8; ++i, src += srcPitch)
+		r[i] = vld1q_u16(src);
+
+	//Swap 16 bit pixels, then 32 bit pairs between neighbouring lines, then combine the 64 bit halves
+	const uint16x8x2_t
+		t01 = vtrnq_u16(r[0], r[1]), t23 = vtrnq_u16(r[2], r[3]),
+		t45 = vtrnq_u16(r[4], r[5]), t67 = vtrnq_u16(r[6], r[7]);
+	const uint32x4x2_t
+		u02 = vtrnq_u32(vreinterpretq_u32_u16(t01.val[0]), vreinterpretq_u32_u16(t23.val[0])), //Columns 0 4 and 2 6 of lines 0-3
+		u13 = vtrnq_u32(vreinterpretq_u32_u16(t01.val[1]), vreinterpretq_u32_u16(t23.val[1])), //Columns 1 5 and 3 7 of lines 0-3
+		v02 = vtrnq_u32(vreinterpretq_u32_u16(t45.val[0]), vreinterpretq_u32_u16(t67.val[0])),
+		v13 = vtrnq_u32(vreinterpretq_u32_u16(t45.val[1]), vreinterpretq_u32_u16(t67.val[1]));
+
+	#define ROTATE_COMBINE(half, a, b) vcombine_u16(vreinterpret_u16_u32(vget_##half##_u32(a)), \
+		vreinterpret_u16_u32(vget_##half##_u32(b)))
+	vst1q_u16(dest, ROTATE_COMBINE(low, u02.val[0], v02.val[0])); dest += destPitch;
+	vst1q_u16(dest, ROTATE_COMBINE(low, u13.val[0], v13.val[0])); dest += destPitch;
+	vst1q_u16(dest, ROTATE_COMBINE(low, u02.val[1], v02.val[1])); dest += destPitch;
+	vst1q_u16(dest, ROTATE_COMBINE(low, u13.val[1], v13.val[1])); dest += destPitch;
+	vst1q_u16(dest, ROTATE_COMBINE(high, u02.val[0], v02.val[0])); dest += destPitch;
+	vst1q_u16(dest, ROTATE_COMBINE(high, u13.val[0], v13.val[0])); dest += destPitch;
+	vst1q_u16(dest, ROTATE_COMBINE(high, u02.val[1], v02.val[1])); dest += destPitch;
+	vst1q_u16(dest, ROTATE_COMBINE(high, u13.val[1], v13.val[1]));
+	#undef ROTATE_COMBINE
+}
+
+static inline void TransposeSimd4x4(const uint32* src, int srcPitch, uint32* dest, int destPitch) {
+	const uint32x4_t
+		r0 = vld1q_u32(src), r1 = vld1q_u32(src + srcPitch),
+		r2 = vld1q_u32(src + 2 * srcPitch), r3 = vld1q_u32(src + 3 * srcPitch);
+	const uint32x4x2_t t01 = vtrnq_u32(r0, r1), t23 = vtrnq_u32(r2, r3);
+	vst1q_u32(dest, vcombine_u32(vget_low_u32(t01.val[0]), vget_low_u32(t23.val[0])));
+	vst1q_u32(dest + destPitch, vcombine_u32(vget_low_u32(t01.val[1]), vget_low_u32(t23.val[1])));
+	vst1q_u32(dest + 2 * destPitch, vcombine_u32(vget_high_u32(t01.val[0]), vget_high_u32(t23.val[0])));
+	vst1q_u32(dest + 3 * destPitch, vcombine_u32(vget_high_u32(t01.val[1]), vget_high_u32(t23.val[1])));
+}
+
+#elif defined(FRAME_KERNELS_SSE2)
+
+static inline void TransposeSimd8x8(const uint8* src, int srcPitch, uint8* dest, int destPitch) {
+	__m128i r[8];
+	for(int i = 0; i < 8; ++i, src += srcPitch)
+		r[i] = _mm_loadl_epi64((const __m128i*)src);
+
+	//Interleave bytes, then 16 bit pairs, then 32 bit quads. Each result holds two destination lines.
+	const __m128i
+		a0 = _mm_unpacklo_epi8(r[0], r[1]), a1 = _mm_unpacklo_epi8(r[2], r[3]),
+		a2 = _mm_unpacklo_epi8(r[4], r[5]), a3 = _mm_unpacklo_epi8(r[6], r[7]),
+		b0 = _mm_unpacklo_epi16(a0, a1), b1 = _mm_unpackhi_epi16(a0, a1),
+		b2 = _mm_unpacklo_epi16(a2, a3), b3 = _mm_unpackhi_epi16(a2, a3),
+		c01 = _mm_unpacklo_epi32(b0, b2), c23 = _mm_unpackhi_epi32(b0, b2),
+		c45 = _mm_unpacklo_epi32(b1, b3), c67 = _mm_unpackhi_epi32(b1, b3);
+
+	_mm_storel_epi64((__m128i*)dest, c01); dest += destPitch;
+	_mm_storel_epi64((__m128i*)dest, _mm_srli_si128(c01, 8)); dest += destPitch;
+	_mm_storel_epi64((__m128i*)dest, c23); dest += destPitch;
+	_mm_storel_epi64((__m128i*)dest, _mm_srli_si128(c23, 8)); dest += destPitch;
+	_mm_storel_epi64((__m128i*)dest, c45); dest += destPitch;
+	_mm_storel_epi64((__m128i*)dest, _mm_srli_si128(c45, 8)); dest += destPitch;
+	_mm_storel_epi64((__m128i*)dest, c67); dest += destPitch;
+	_mm_storel_epi64((__m128i*)dest, _mm_srli_si128(c67, 8));
+}
+
+static inline void TransposeSimd8x8(const uint16* src, int srcPitch, uint16* dest, int destPitch) {
+	__m128i r[8];
+	for(int i = 0; i < 8; ++i, src += srcPitch)
+		r[i] = _mm_loadu_si128((const __m128i*)src);
+
+	//Interleave 16 bit pixels, then 32 bit pairs, then 64 bit quads
+	const __m128i
+		a0 = _mm_unpacklo_epi16(r[0], r[1]), a1 = _mm_unpackhi_epi16(r[0], r[1]),
+		a2 = _mm_unpacklo_epi16(r[2], r[3]), a3 = _mm_unpackhi_epi16(r[2], r[3]),
+		a4 = _mm_unpacklo_epi16(r[4], r[5]), a5 = _mm_unpackhi_epi16(r[4], r[5]),
+		a6 = _mm_unpacklo_epi16(r[6], r[7]), a7 = _mm_unpackhi_epi16(r[6], r[7]),
+		b0 = _mm_unpacklo_epi32(a0, a2), b1 = _mm_unpackhi_epi32(a0, a2), //Columns 0 1 and 2 3 of lines 0-3
+		b2 = _mm_unpacklo_epi32(a1, a3), b3 = _mm_unpackhi_epi32(a1, a3), //Columns 4 5 and 6 7 of lines 0-3
+		b4 = _mm_unpacklo_epi32(a4, a6), b5 = _mm_unpackhi_epi32(a4, a6),
+		b6 = _mm_unpacklo_epi32(a5, a7), b7 = _mm_unpackhi_epi32(a5, a7);
+
+	_mm_storeu_si128((__m128i*)dest, _mm_unpacklo_epi64(b0, b4)); dest += destPitch;
+	_mm_storeu_si128((__m128i*)dest, _mm_unpackhi_epi64(b0, b4)); dest += destPitch;
+	_mm_storeu_si128((__m128i*)dest, _mm_unpacklo_epi64(b1, b5)); dest += destPitch;
+	_mm_storeu_si128((__m128i*)dest, _mm_unpackhi_epi64(b1, b5)); dest += destPitch;
+	_mm_storeu_si128((__m128i*)dest, _mm_unpacklo_epi64(b2, b6)); dest += destPitch;
+	_mm_storeu_si128((__m128i*)dest, _mm_unpackhi_epi64(b2, b6)); dest += destPitch;
+	_mm_storeu_si128((__m128i*)dest, _mm_unpacklo_epi64(b3, b7)); dest += destPitch;
+	_mm_storeu_si128((__m128i*)dest, _mm_unpackhi_epi64(b3, b7));
+}
+
+static inline void TransposeSimd4x4(const uint32* src, int srcPitch, uint32* dest, int destPitch) {
+	const __m128i
+		r0 = _mm_loadu_si128((const __m128i*)src),
+		r1 = _mm_loadu_si128((const __m128i*)(src + srcPitch)),
+		r2 = _mm_loadu_si128((const __m128i*)(src + 2 * srcPitch)),
+		r3 = _mm_loadu_si128((const __m128i*)(src + 3 * srcPitch)),
+		t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpacklo_epi32(r2, r3),
+		t2 = _mm_unpackhi_epi32(r0, r1), t3 = _mm_unpackhi_epi32(r2, r3);
+	_mm_storeu_si128((__m128i*)dest, _mm_unpacklo_epi64(t0, t1));
+	_mm_storeu_si128((__m128i*)(dest + destPitch), _mm_unpackhi_epi64(t0, t1));
+	_mm_storeu_si128((__m128i*)(dest + 2 * destPitch), _mm_unpacklo_epi64(t2, t3));
+	_mm_storeu_si128((__m128i*)(dest + 3 * destPitch), _mm_unpackhi_epi64(t2, t3));
+}
+
+#endif
+
+#ifdef FRAME_KERNELS_SIMD
+//32 bit pixels fill a vector with 4, so their 8x8 tile is four 4x4 transposes.
+static inline void TransposeSimd8x8(const uint32* src, int srcPitch, uint32* dest, int destPitch) {
+	TransposeSimd4x4(src, srcPitch, dest, destPitch);
+	TransposeSimd4x4(src + 4, srcPitch, dest + 4 * destPitch, destPitch);
+	TransposeSimd4x4(src + 4 * srcPitch, srcPitch, dest + 4, destPitch);
+	TransposeSimd4x4(src + 4 * srcPitch + 4, srcPitch, dest + 4 * destPitch + 4, destPitch);
+}
+#endif
+
+//Transpose a full 8x8 tile.
+template<bool useSimd, typename Pixel>
+static inline void Transpose8x8(const Pixel* src, int srcPitch, Pixel* dest, int destPitch) {
+#ifdef FRAME_KERNELS_SIMD
+	if(useSimd) {
+		TransposeSimd8x8(src, srcPitch, dest, destPitch);
+		return;
+	}
+#endif
+	TransposeBlock(src, srcPitch, dest, destPitch, ROTATE_TILE, ROTATE_TILE);
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//SOURCES AND BANDS
+
+//Source of crop pixels that are already in the destination format: blocks point straight into the frame.
+//A source's Block(x, y, w, h, &pitch) returns the w x h block of the crop with its top left corner at (x, y) and its pitch.
+template<typename Pixel>
+struct PlainSource {
+	const Pixel* pCrop; //Top left corner of the crop in the frame
+	int pitch; //Frame row length in pixels
+
+	PlainSource(const Pixel* pFrame, uint framePitch, uint cropX, uint cropY)
+		: pCrop(pFrame + cropX + cropY * framePitch), pitch((int)framePitch) {}
+
+	inline const Pixel* Block(uint x, uint y, uint /*w*/, uint /*h*/, int* pPitch) const {
+		*pPitch = pitch;
+		return pCrop + x + (int)y * pitch;
+	}
+
+	//Crop pixel at (x, y). Used by ScaleCrop.
+	inline Pixel Get(uint x, uint y) const {
+		return pCrop[x + (int)y * pitch];
+	}
+};
+
+//Write destination lines [firstLine, firstLine + lines) of a dim x dim crop of source rotated by 90 (CCW) or 270 (CW)
+//degrees into pDest (dim pixels per line, line 0 at pDest). lines must not exceed ROTATE_BAND_BYTES / sizeof(Pixel).
+//ROT90: dest line i is crop column dim-1-i read top to bottom. ROT270: dest line i is crop column i read bottom to top.
+template<bool useSimd, typename Pixel, FrameRotation rotation, typename Source>
+static void RotateBand(Source& source, uint dim, uint firstLine, uint lines, Pixel* pDest) {
+	const int destPitch = (int)dim;
+	const uint column = rotation == FRAME_ROT90 ? dim - firstLine - lines : firstLine; //Leftmost crop column of the band
+
+	for(uint j = 0; j < dim; j += ROTATE_TILE) { //Destination columns [j, j + h) come from h crop rows
+		const uint h = dim - j < ROTATE_TILE ? dim - j : ROTATE_TILE;
+		int srcPitch;
+		const Pixel* src;
+		if(rotation == FRAME_ROT90) {
+			src = source.Block(column, j, lines, h, &srcPitch);
+		}
+		else { //Destination column j is crop row dim-1-j: walk the block bottom up
+			src = source.Block(column, dim - j - h, lines, h, &srcPitch);
+			src += (int)(h - 1) * srcPitch;
+			srcPitch = -srcPitch;
+		}
+
+		//8 crop columns at a time. ROT90 writes crop column c to line firstLine+lines-1-c, ROT270 to line firstLine+c.
+		for(uint c = 0; c < lines; c += ROTATE_TILE) {
+			const uint w = lines - c < ROTATE_TILE ? lines - c : ROTATE_TILE;
+			Pixel* dest = pDest + (rotation == FRAME_ROT90 ? firstLine + lines - 1 - c : firstLine + c) * dim + j;
+			const int step = rotation == FRAME_ROT90 ? -destPitch : destPitch;
+			if(w == ROTATE_TILE && h == ROTATE_TILE)
+				Transpose8x8<useSimd>(src + c, srcPitch, dest, step);
+			else
+				TransposeBlock(src + c, srcPitch, dest, step, w, h);
+		}
+	}
+}
+
+//Write a scaledDim x scaledDim nearest neighbour resampling of a dim x dim crop, rotated upright, to pDest line by line.
+//Each destination pixel takes the crop pixel under its centre, found by walking 16.16 fixed point positions. source must
+//have Get(x, y). Every destination pixel is a random access, which is fine when scaledDim is well below dim.
+template<FrameRotation rotation, typename Pixel, typename Source>
+static void ScaleCropRotated(const Source& source, uint dim, uint scaledDim, Pixel* pDest) {
+	const uint step = (dim << 16) / scaledDim, last = dim - 1;
+	uint lineFixed = step / 2;
+	for(uint i = scaledDim; i; --i, lineFixed += step) {
+		const uint line = lineFixed >> 16;
+		uint columnFixed = step / 2;
+		for(uint j = scaledDim; j; --j, columnFixed += step) {
+			const uint column = columnFixed >> 16;
+			switch(rotation) { //Same mappings as RotateBand and the row copies
+				case FRAME_ROTNORMAL: *pDest++ = source.Get(column, line); break;
+				case FRAME_ROT90: *pDest++ = source.Get(last - line, column); break;
+				case FRAME_ROT180: *pDest++ = source.Get(last - column, last - line); break;
+				case FRAME_ROT270: *pDest++ = source.Get(line, last - column); break;
+			}
+		}
+	}
+}
+
+template<typename Pixel, typename Source>
+static void ScaleCrop(const Source& source, uint dim, uint scaledDim, FrameRotation rotation, Pixel* pDest) {
+	switch(rotation) {
+		case FRAME_ROTNORMAL: ScaleCropRotated<FRAME_ROTNORMAL>(source, dim, scaledDim, pDest); break;
+		case FRAME_ROT90: ScaleCropRotated<FRAME_ROT90>(source, dim, scaledDim, pDest); break;
+		case FRAME_ROT180: ScaleCropRotated<FRAME_ROT180>(source, dim, scaledDim, pDest); break;
+		case FRAME_ROT270: ScaleCropRotated<FRAME_ROT270>(source, dim, scaledDim, pDest); break;
+	}
+}
+
+//Crop a dim x dim square out of source and rotate it upright into pDest, which is written line by line.
+//ROT90 and ROT270 go through RotateBand. ROTNORMAL and ROT180 are straight row copies, which are already cache friendly.
+template<bool useSimd, typename Pixel, typename Source>
+static void CropRotatePlain(Source& source, uint dim, FrameRotation rotation, Pixel* pDest) {
+	const uint bandLines = ROTATE_BAND_BYTES / sizeof(Pixel);
+	switch(rotation) {
+		case FRAME_ROTNORMAL: {
+			for(uint i = 0; i < dim; ++i, pDest += dim) {
+				int pitch;
+				memcpy(pDest, source.Block(0, i, dim, 1, &pitch), dim * sizeof(Pixel));
+			}
+			break;
+		}
+		case FRAME_ROT90: {
+			for(uint i = 0; i < dim; i += bandLines)
+				RotateBand<useSimd, Pixel, FRAME_ROT90>(source, dim, i, dim - i < bandLines ? dim - i : bandLines, pDest);
+			break;
+		}
+		case FRAME_ROT180: {
+			for(uint i = 0; i < dim; ++i) {
+				int pitch;
+				const Pixel* src = source.Block(0, dim - 1 - i, dim, 1, &pitch) + dim - 1;
+				for(uint j = dim; j; --j)
+					*pDest++ = *src--;
+			}
+			break;
+		}
+		case FRAME_ROT270: {
+			for(uint i = 0; i < dim; i += bandLines)
+				RotateBand<useSimd, Pixel, FRAME_ROT270>(source, dim, i, dim - i < bandLines ? dim - i : bandLines, pDest);
+			break;
+		}
+	}
+}
+
+#endif
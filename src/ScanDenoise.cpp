@@ -0,0 +1,65 @@
+#include "ScanDenoise.h"
+#include "BufferPool.h"
+#include "FrameKernels.h"
+
+#include <string.h>
+
+#define SCAN_DENOISE_DEFAULT_SHIFT 2 //Averages about the last 4 to 8 frames
+#define SCAN_DENOISE_DEFAULT_MOTION_THRESHOLD 24 //Gray levels, well above what the noise of a dim frame averages to
+
+void ScanDenoiserInit(ScanDenoiser* pDenoiser) {
+	memset(pDenoiser, 0, sizeof(ScanDenoiser));
+	pDenoiser->shift = SCAN_DENOISE_DEFAULT_SHIFT;
+	pDenoiser->motionThreshold = SCAN_DENOISE_DEFAULT_MOTION_THRESHOLD;
+}
+
+void ScanDenoiserRelease(ScanDenoiser* pDenoiser) {
+	ScanFree(pDenoiser->pBuffer);
+	ScanDenoiserInit(pDenoiser);
+}
+
+//The tiles are processed a row of tiles at a time: the difference sums of the row's tiles first, then every line of the
+//row is blended or restarted. A row of tiles is small enough to still be in the cache for the second pass.
+bool ScanDenoise(ScanDenoiser* pDenoiser, uint8* pPixels, uint width, uint height) {
+	if(width == 0 || height == 0)
+		return true;
+
+	const uint tilesX = (width + SCAN_DENOISE_TILE - 1) / SCAN_DENOISE_TILE;
+	const bool restart = width != pDenoiser->width || height != pDenoiser->height;
+	if(restart && !ScanReserveBuffer(&pDenoiser->pBuffer, &pDenoiser->bufferCapacity,
+		width * height * sizeof(uint16) + tilesX * (sizeof(uint32) + 1)))
+		return false;
+	uint16* pAccumulator = (uint16*)pDenoiser->pBuffer;
+	uint32* pTileSums = (uint32*)(pAccumulator + width * height); //width * height * 2 bytes keeps it 4 byte aligned
+	uint8* pTileMoved = (uint8*)(pTileSums + tilesX);
+
+	const uint shift = pDenoiser->shift < 1 ? 1 : (pDenoiser->shift > 8 ? 8 : pDenoiser->shift);
+	for(uint y0 = 0; y0 < height; y0 += SCAN_DENOISE_TILE) {
+		const uint rows = height - y0 < SCAN_DENOISE_TILE ? height - y0 : SCAN_DENOISE_TILE;
+		uint8* pRow = pPixels + y0 * width;
+		uint16* pAccumulatorRow = pAccumulator + y0 * width;
+		if(restart) {
+			memset(pTileMoved, 1, tilesX);
+			pDenoiser->tilesRestarted += tilesX;
+		}
+		else {
+			memset(pTileSums, 0, tilesX * sizeof(uint32));
+			for(uint y = 0; y < rows; ++y)
+				AddAccumulatorDifferences(pRow + y * width, pAccumulatorRow + y * width, width, pTileSums);
+			for(uint x = 0; x < tilesX; ++x) {
+				const uint tileWidth = x + 1 < tilesX ? SCAN_DENOISE_TILE : width - x * SCAN_DENOISE_TILE;
+				pTileMoved[x] = pTileSums[x] >= pDenoiser->motionThreshold * tileWidth * rows;
+				if(pTileMoved[x])
+					++pDenoiser->tilesRestarted;
+				else
+					++pDenoiser->tilesBlended;
+			}
+		}
+		for(uint y = 0; y < rows; ++y)
+			BlendIntoAccumulator(pRow + y * width, pAccumulatorRow + y * width, width, pTileMoved, shift);
+	}
+	pDenoiser->width = width;
+	pDenoiser->height = height;
+	++pDenoiser->frames;
+	return true;
+}
@@ -0,0 +1,49 @@
+#ifndef SCAN_DENOISE_H
+#define SCAN_DENOISE_H
+
+#include "ScanTypes.h"
+
+//Optional temporal denoising for low light. In a dim aisle the sensor noise in a single frame hides the module edges
+//ZBar looks for, so frame after frame fails. A code held still is the same in consecutive frames while the noise isn't,
+//so averaging frames cuts the noise without blurring the code:
+// - every pixel keeps a running average in 8.8 fixed point, which a new frame joins with a weight of 1 / 2^shift,
+// - the frame is replaced with the average before it is scanned, and
+// - the frame is cut into SCAN_DENOISE_TILE x SCAN_DENOISE_TILE tiles, and a tile that differs from its average by more
+//   than the noise would (the code or the phone moved) restarts its average from the new frame, so moving parts are
+//   scanned sharp instead of smeared.
+//The only memory is the 16 bit average per pixel and a few bytes per tile column. The blending and the tile differences
+//are SIMD kernels (see FrameKernels.h). All state belongs to the thread that scans.
+
+#define SCAN_DENOISE_TILE 16 //Tile side in pixels, the width the kernels work in
+
+struct ScanDenoiser {
+	//Settings
+	uint shift; //A new frame weighs 1 / 2^shift in the average, 1 to 8
+	uint motionThreshold; //Mean absolute difference (gray levels) between a tile and its average at which it restarts
+
+	//State
+	uint8* pBuffer; //Running averages, then the difference sums and restart flags of one row of tiles
+	uint bufferCapacity;
+	uint width, height; //Size of the frames averaged, 0 when the next frame starts over
+
+	//Counters
+	uint32 frames; //Frames averaged
+	uint32 tilesBlended; //Tiles blended into their average
+	uint32 tilesRestarted; //Tiles that moved, or were in a frame that started over
+};
+
+void ScanDenoiserInit(ScanDenoiser* pDenoiser);
+
+void ScanDenoiserRelease(ScanDenoiser* pDenoiser);
+
+//Start over with the next frame, e.g. when denoising is switched back on after a pause.
+inline void ScanDenoiserRestart(ScanDenoiser* pDenoiser) {
+	pDenoiser->width = pDenoiser->height = 0;
+}
+
+//Blend a width x height Y800 frame into the running average and replace it with the average. The first frame, and any
+//frame of a different size, starts the average over and is left as it is. Returns false, also leaving the frame as it
+//is, if the averages couldn't be allocated.
+bool ScanDenoise(ScanDenoiser* pDenoiser, uint8* pPixels, uint width, uint height);
+
+#endif
@@ -0,0 +1,212 @@
+#include "ScanEngine.h"
+
+#include <string.h>
+
+//Write a reported symbol to the engine's export ring with its location in frame pixels. A polygon with more points than
+//a record holds is written as its bounding box. Called on the worker thread only.
+static void ExportResult(ScanEngine* pEngine, const zbar_symbol_t* pSymbol, zbar_symbol_type_t type, const char* pData,
+	uint dataLength, const FrameSlot* pSlot, uint64 nowNs) {
+	int points[2 * SCAN_EXPORT_MAX_POINTS];
+	uint numPoints = zbar_symbol_get_loc_size(pSymbol);
+	if(numPoints <= SCAN_EXPORT_MAX_POINTS) {
+		for(uint i = 0; i < numPoints; ++i)
+			ScanDecoderSymbolPoint(&pEngine->decoder, pSymbol, i, &points[2 * i], &points[2 * i + 1]);
+	}
+	else {
+		int x0 = 0x7fffffff, y0 = 0x7fffffff, x1 = -0x7fffffff, y1 = -0x7fffffff;
+		for(uint i = 0; i < numPoints; ++i) {
+			int x, y;
+			ScanDecoderSymbolPoint(&pEngine->decoder, pSymbol, i, &x, &y);
+			x0 = x < x0 ? x : x0;
+			y0 = y < y0 ? y : y0;
+			x1 = x > x1 ? x : x1;
+			y1 = y > y1 ? y : y1;
+		}
+		const int box[8] = { x0, y0, x1, y0, x1, y1, x0, y1 };
+		memcpy(points, box, sizeof(box));
+		numPoints = 4;
+	}
+	ScanExportWrite(pEngine->pExport, (int32)type, pData, dataLength, points, numPoints, pSlot->width, pSlot->height,
+		pSlot->sequence, pSlot->timestamp, nowNs > pSlot->timestamp ? nowNs - pSlot->timestamp : 0);
+}
+
+//Queue a symbol for the main loop unless it was reported recently. Called on the worker thread only.
+static void PushResult(ScanEngine* pEngine, const zbar_symbol_t* pSymbol, const FrameSlot* pSlot, uint64 nowNs) {
+	if(!ScanDecoderIsVerified(&pEngine->decoder, pSymbol))
+		return;
+	const zbar_symbol_type_t type = zbar_symbol_get_type(pSymbol);
+	const char* pData = zbar_symbol_get_data(pSymbol);
+	const uint dataLength = zbar_symbol_get_data_length(pSymbol);
+	if(ScanDedupIsRepeat(&pEngine->dedup, type, pData, dataLength, nowNs)) {
+		++pEngine->stats.resultsRepeated;
+		return;
+	}
+	if(pEngine->pExport)
+		ExportResult(pEngine, pSymbol, type, pData, dataLength, pSlot, nowNs);
+	if(ScanResultQueuePush(&pEngine->results, type, pData, dataLength, pSlot->sequence))
+		++pEngine->stats.resultsQueued;
+}
+
+//Scan the newest published frame, if there is one that hasn't been scanned yet and neither the quality gate nor the
+//scheduler skips it.
+static void ScanNewestFrame(ScanEngine* pEngine) {
+	FrameSlot* pSlot = FrameRingAcquire(&pEngine->ring);
+	if(pSlot == NULL)
+		return;
+
+	const uint64 startNs = ScanClockNs();
+	if(pEngine->maxFrameAgeNs && startNs > pSlot->timestamp && startNs - pSlot->timestamp > pEngine->maxFrameAgeNs) {
+		++pEngine->stats.framesStale; //A newer frame will be along before a result from this one would be useful
+		return;
+	}
+	bool scan = true;
+	if(ScanEngineGetQualityGate(pEngine)) {
+		const ScanGateDecision decision = ScanQualityGateCheck(&pEngine->gate, &pSlot->quality, startNs);
+		++pEngine->stats.gateDecisions[decision];
+		scan = ScanGateScans(decision);
+	}
+	//The scheduler takes its signature of the frame as captured, before denoising or enhancing it in place. An average
+	//that slowly gets cleaner would otherwise look unchanged since the last failed scan and not be scanned again.
+	if(scan && !ScanSchedulerShouldScan(&pEngine->scheduler, pSlot->pPixels, pSlot->width, pSlot->height, startNs)) {
+		++pEngine->stats.framesUnchanged;
+		scan = false;
+	}
+
+	//Every frame taken joins the average, also those the gate or scheduler skip, so the average is settled by the time a
+	//frame is scanned
+	uint64 denoisedNs = ScanClockNs();
+	if(ScanEngineGetDenoise(pEngine)) {
+		const uint64 denoiseStartNs = denoisedNs;
+		ScanDenoise(&pEngine->denoiser, pSlot->pPixels, pSlot->width, pSlot->height); //Out of memory: scanned as captured
+		denoisedNs = ScanClockNs();
+		ScanStatsAddStage(&pEngine->stats, SCAN_STAGE_DENOISE, denoisedNs - denoiseStartNs);
+	}
+	else
+		ScanDenoiserRestart(&pEngine->denoiser);
+	if(!scan)
+		return;
+
+	ScanEnhanceMode enhance = ScanEngineGetEnhance(pEngine);
+	uint64 scanStartNs = denoisedNs;
+	if(enhance != SCAN_ENHANCE_OFF) {
+		if(!ScanEnhance(&pEngine->enhancer, enhance, pSlot->pPixels, pSlot->width, pSlot->height))
+			enhance = SCAN_ENHANCE_OFF; //Out of memory: scanned as captured
+		scanStartNs = ScanClockNs();
+		ScanStatsAddStage(&pEngine->stats, SCAN_STAGE_ENHANCE, scanStartNs - denoisedNs);
+	}
+
+	const int numSymbols = ScanDecoderScan(&pEngine->decoder, pSlot->pPixels, pSlot->width, pSlot->height);
+	const uint64 decodedNs = ScanClockNs();
+	ScanStatsAddStage(&pEngine->stats, SCAN_STAGE_DECODE, decodedNs - scanStartNs);
+	++pEngine->stats.framesScanned;
+	++pEngine->stats.enhanceScans[enhance];
+	if(numSymbols > 0) {
+		const zbar_symbol_t* pSymbol = ScanDecoderFirstSymbol(&pEngine->decoder);
+		for(; pSymbol; pSymbol = zbar_symbol_next(pSymbol))
+			PushResult(pEngine, pSymbol, pSlot, decodedNs);
+		ScanStatsAddStage(&pEngine->stats, SCAN_STAGE_EXTRACT, ScanClockNs() - decodedNs);
+		++pEngine->stats.framesDecoded;
+		++pEngine->stats.enhanceDecoded[enhance];
+	}
+	const uint64 endNs = ScanClockNs();
+	ScanSchedulerScanDone(&pEngine->scheduler, startNs, endNs, numSymbols > 0);
+	if(endNs > pSlot->timestamp)
+		ScanStatsAddStage(&pEngine->stats, SCAN_STAGE_LATENCY, endNs - pSlot->timestamp);
+}
+
+//Worker thread: sleep until a frame is published, wait for the CPU budget to allow a scan, then scan the newest frame.
+static void* ScanWorker(void* pArg) {
+	ScanEngine* pEngine = (ScanEngine*)pArg;
+	for(;;) {
+		ScanSemaphoreWait(pEngine->pWakeUp);
+		for(;;) {
+			if(AtomicLoad(&pEngine->quit))
+				return NULL;
+			const uint waitMs = ScanSchedulerWaitMs(&pEngine->scheduler, ScanClockNs());
+			if(waitMs == 0)
+				break;
+			ScanSemaphoreTimedWait(pEngine->pWakeUp, waitMs); //A newer frame or quit may end the wait early
+		}
+		AtomicStore(&pEngine->wakeUpPending, 0); //Frames published from here on wake the worker up again
+		ScanNewestFrame(pEngine);
+	}
+}
+
+//Create an engine without a worker thread.
+static ScanEngine* CreateEngine(float cpuBudget, ScanMode mode, const ScanProfile* pProfile, uint dedupTtlMs) {
+	ScanEngine* pEngine = new ScanEngine;
+	memset(pEngine, 0, sizeof(ScanEngine));
+	FrameRingInit(&pEngine->ring);
+	ScanSchedulerInit(&pEngine->scheduler, cpuBudget);
+	ScanQualityGateInit(&pEngine->gate);
+	ScanDedupInit(&pEngine->dedup, dedupTtlMs);
+	ScanEnhancerInit(&pEngine->enhancer);
+	ScanDenoiserInit(&pEngine->denoiser);
+	pEngine->enhanceMode = pProfile ? pProfile->enhance : SCAN_ENHANCE_OFF;
+	pEngine->qualityGate = !pProfile || pProfile->qualityGate ? 1 : 0;
+	pEngine->denoise = pProfile && pProfile->denoise ? 1 : 0;
+	if(!ScanDecoderInit(&pEngine->decoder, mode, pProfile) || !ScanResultQueueInit(&pEngine->results)) {
+		ScanEngineDestroy(pEngine);
+		return NULL;
+	}
+	return pEngine;
+}
+
+ScanEngine* ScanEngineCreate(float cpuBudget, ScanMode mode, const ScanProfile* pProfile, uint dedupTtlMs) {
+	ScanEngine* pEngine = CreateEngine(cpuBudget, mode, pProfile, dedupTtlMs);
+	if(pEngine && ScanThreadsAvailable()) {
+		pEngine->pWakeUp = ScanSemaphoreCreate(0);
+		if(pEngine->pWakeUp)
+			pEngine->pThread = ScanThreadCreate(ScanWorker, pEngine);
+	}
+	return pEngine;
+}
+
+ScanEngine* ScanEngineCreateDriven(float cpuBudget, ScanMode mode, const ScanProfile* pProfile, uint dedupTtlMs) {
+	ScanEngine* pEngine = CreateEngine(cpuBudget, mode, pProfile, dedupTtlMs);
+	if(pEngine)
+		pEngine->driven = true;
+	return pEngine;
+}
+
+void ScanEngineDestroy(ScanEngine* pEngine) {
+	if(pEngine == NULL)
+		return;
+
+	if(pEngine->pThread) {
+		AtomicStore(&pEngine->quit, 1);
+		ScanSemaphorePost(pEngine->pWakeUp);
+		ScanThreadJoin(pEngine->pThread);
+	}
+	ScanSemaphoreDestroy(pEngine->pWakeUp);
+
+	ScanDecoderRelease(&pEngine->decoder);
+	ScanResultQueueRelease(&pEngine->results);
+	ScanEnhancerRelease(&pEngine->enhancer);
+	ScanDenoiserRelease(&pEngine->denoiser);
+	FrameRingRelease(&pEngine->ring);
+	delete pEngine;
+}
+
+FrameSlot* ScanEngineBeginFrame(ScanEngine* pEngine, uint width, uint height) {
+	return FrameRingBeginWrite(&pEngine->ring, width, height);
+}
+
+void ScanEnginePublishFrame(ScanEngine* pEngine, uint64 timestamp) {
+	++pEngine->stats.framesPublished;
+	if(FrameRingPublish(&pEngine->ring, timestamp))
+		++pEngine->stats.framesDropped;
+	if(pEngine->pThread) {
+		//Post once per wake up so the semaphore count doesn't grow while the worker is busy decoding
+		if(AtomicExchange(&pEngine->wakeUpPending, 1) == 0)
+			ScanSemaphorePost(pEngine->pWakeUp);
+	}
+	else if(!pEngine->driven && ScanSchedulerWaitMs(&pEngine->scheduler, ScanClockNs()) == 0) {
+		ScanNewestFrame(pEngine); //No threads: scan on the caller's thread, never waiting for the budget
+	}
+}
+
+void ScanEngineScanNewest(ScanEngine* pEngine) {
+	if(ScanSchedulerWaitMs(&pEngine->scheduler, ScanClockNs()) == 0)
+		ScanNewestFrame(pEngine);
+}
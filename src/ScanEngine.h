@@ -0,0 +1,115 @@
+#ifndef SCAN_ENGINE_H
+#define SCAN_ENGINE_H
+
+#include "FrameRing.h"
+#include "ScanDenoise.h"
+#include "ScanEnhance.h"
+#include "ScanExport.h"
+#include "ScanPipeline.h"
+#include "ScanResults.h"
+#include "ScanScheduler.h"
+#include "ScanStats.h"
+#include "ScanThread.h"
+
+//Runs zbar_scan_image on its own thread so a slow decode never stalls the camera callback or the render loop.
+//The camera callback writes grayscale frames into the engine's FrameRing and every published frame wakes the worker up.
+//The worker averages the newest frame with the previous ones if denoising is on, then scans it when its ScanQualityGate
+//and ScanScheduler allow it, after enhancing it in place if an enhancement mode is set. Every symbol found that the dedup
+//cache hasn't seen recently is handed back through a result queue the main loop drains in batches, and written to a
+//ScanExport ring for consumers outside the app if one is set.
+
+struct ScanEngine {
+	FrameRing ring;
+	ScanDecoder decoder; //Used by the worker thread only
+	ScanThread* pThread; //NULL if the platform has no threads or the engine is driven. Scans then run inside
+	//ScanEnginePublishFrame, or in ScanEngineScanNewest for a driven engine.
+	bool driven; //Created by ScanEngineCreateDriven: scanned by an outside worker (see ScanService)
+	uint64 maxFrameAgeNs; //A frame older than this when the worker gets to it is dropped as stale, 0 scans every frame
+	ScanSemaphore* pWakeUp;
+	volatile int32 wakeUpPending; //Set when pWakeUp has been posted and the worker hasn't looked at the ring yet
+	volatile int32 quit;
+	ScanScheduler scheduler; //Owned by the worker thread
+	ScanQualityGate gate; //Owned by the worker thread
+	volatile int32 qualityGate; //Non zero to skip blurred and badly exposed frames. Set by any thread.
+	ScanStats stats; //Decode stages and counters are recorded by the engine, the camera callback records the rest
+
+	ScanDedupCache dedup; //Owned by the worker thread
+	ScanResultQueue results; //Single producer (worker) single consumer (main loop)
+	ScanExport* pExport; //Written by the worker if not NULL, see ScanEngineSetExport
+
+	ScanEnhancer enhancer; //Owned by the worker thread
+	volatile int32 enhanceMode; //ScanEnhanceMode of the next scans. Set by any thread, read by the worker once per scan.
+
+	ScanDenoiser denoiser; //Owned by the worker thread
+	volatile int32 denoise; //Non zero to average frames before they are scanned. Set by any thread.
+};
+
+//Create the ZBar scanner with pProfile (NULL for QR codes only, see ScanDecoderInit), which also sets the enhancement
+//mode, the quality gate and denoising, and start the worker thread. The worker spends at most cpuBudget of one core
+//decoding (see ScanScheduler). A symbol seen again within dedupTtlMs of its last sighting is not queued again, 0 queues
+//every sighting. Returns NULL on failure.
+ScanEngine* ScanEngineCreate(float cpuBudget, ScanMode mode, const ScanProfile* pProfile, uint dedupTtlMs);
+
+//Like ScanEngineCreate but without a worker thread: published frames are only scanned by calls to
+//ScanEngineScanNewest, so several engines can share a pool of workers. Returns NULL on failure.
+ScanEngine* ScanEngineCreateDriven(float cpuBudget, ScanMode mode, const ScanProfile* pProfile, uint dedupTtlMs);
+
+//Stop the worker thread and free everything.
+void ScanEngineDestroy(ScanEngine* pEngine);
+
+//Driven engine: scan the newest published frame if there is one, the quality gate and scheduler allow it and it isn't
+//stale. Only one thread at a time may call this for an engine, it then owns the consumer side of the ring.
+void ScanEngineScanNewest(ScanEngine* pEngine);
+
+//Camera callback: get a width x height Y800 buffer to write the next frame into. Returns NULL if out of memory.
+FrameSlot* ScanEngineBeginFrame(ScanEngine* pEngine, uint width, uint height);
+
+//Camera callback: hand the frame written into the slot from ScanEngineBeginFrame to the worker and wake it up. The slot's
+//quality should be set with ComputeFrameQuality first, otherwise the quality gate lets the frame through.
+//timestamp is the ScanClockNs() time the frame was captured.
+void ScanEnginePublishFrame(ScanEngine* pEngine, uint64 timestamp);
+
+//Main loop: get up to maxResults of the oldest queued results and return how many there are. Their data stays valid
+//until ScanEngineResultsDone, which must be called before polling the next batch.
+inline uint ScanEnginePollResults(ScanEngine* pEngine, ScanResult* pResults, uint maxResults) {
+	return ScanResultQueuePoll(&pEngine->results, pResults, maxResults);
+}
+
+inline void ScanEngineResultsDone(ScanEngine* pEngine) {
+	ScanResultQueueDone(&pEngine->results);
+}
+
+//Switch the enhancement applied to frames before they are scanned. Takes effect from the next scan.
+inline void ScanEngineSetEnhance(ScanEngine* pEngine, ScanEnhanceMode mode) {
+	AtomicStore(&pEngine->enhanceMode, (int32)mode);
+}
+
+inline ScanEnhanceMode ScanEngineGetEnhance(ScanEngine* pEngine) {
+	return (ScanEnhanceMode)AtomicLoad(&pEngine->enhanceMode);
+}
+
+//Turn the quality gate on or off. Takes effect from the next frame.
+inline void ScanEngineSetQualityGate(ScanEngine* pEngine, bool enabled) {
+	AtomicStore(&pEngine->qualityGate, enabled ? 1 : 0);
+}
+
+inline bool ScanEngineGetQualityGate(ScanEngine* pEngine) {
+	return AtomicLoad(&pEngine->qualityGate) != 0;
+}
+
+//Also write every symbol reported to pExport (NULL for none), which must stay open while the engine uses it. Set it
+//before the first frame is published: the worker reads it without synchronization.
+inline void ScanEngineSetExport(ScanEngine* pEngine, ScanExport* pExport) {
+	pEngine->pExport = pExport;
+}
+
+//Turn temporal denoising on or off. Takes effect from the next frame, the average starts over when it is turned back on.
+inline void ScanEngineSetDenoise(ScanEngine* pEngine, bool enabled) {
+	AtomicStore(&pEngine->denoise, enabled ? 1 : 0);
+}
+
+inline bool ScanEngineGetDenoise(ScanEngine* pEngine) {
+	return AtomicLoad(&pEngine->denoise) != 0;
+}
+
+#endif
@@ -0,0 +1,111 @@
+#include "ScanEnhance.h"
+#include "BufferPool.h"
+#include "FrameKernels.h"
+
+#include <string.h>
+
+static const char* g_scanEnhanceModeNames[SCAN_ENHANCE_COUNT] = { "off", "stretch", "threshold" };
+
+//Window radius for a frame. Frames are square crops, the larger side is used for any other shape.
+static uint EnhanceRadius(uint width, uint height) {
+	const uint radius = (width > height ? width : height) / SCAN_ENHANCE_WINDOW_DIVISOR;
+	if(radius < SCAN_ENHANCE_MIN_RADIUS)
+		return SCAN_ENHANCE_MIN_RADIUS;
+	return radius > SCAN_ENHANCE_MAX_RADIUS ? SCAN_ENHANCE_MAX_RADIUS : radius;
+}
+
+//Number of window positions covered around position i of n: the window is cut off at the edges.
+static inline uint WindowCount(uint i, uint radius, uint n) {
+	return (i + radius < n ? i + radius : n - 1) - (i > radius ? i - radius : 0) + 1;
+}
+
+//Slide a window of 2 * radius + 1 columns along one row of column sums and write the rounded mean of every window (or
+//its threshold) to pMeans. rowCount is the number of frame rows in the column sums.
+//Windows away from the edges all have the same size, so their division is a multiply by a reciprocal scaled by 2^40.
+//Its rounding error is below 2^-18 for sums under 2^22 while the division's fractions are steps of at least 2^-15 (the
+//largest window has 129 * 129 pixels), so the result is the same as dividing.
+static void ComputeMeans(const uint16* pSums, uint width, uint radius, uint rowCount, bool thresholds, uint8* pMeans) {
+	const uint windowCount = rowCount * (2 * radius + 1);
+	const uint64 reciprocal = (1ull << 40) / windowCount + 1;
+	uint32 sum = 0;
+	for(uint x = 0; x < radius && x < width; ++x)
+		sum += pSums[x];
+
+	for(uint x = 0; x < width; ++x) {
+		if(x + radius < width)
+			sum += pSums[x + radius];
+		if(x > radius)
+			sum -= pSums[x - radius - 1];
+		uint mean;
+		if(x >= radius && x + radius < width) {
+			mean = (uint)(((sum + windowCount / 2) * reciprocal) >> 40);
+		}
+		else {
+			const uint count = rowCount * WindowCount(x, radius, width);
+			mean = (sum + count / 2) / count;
+		}
+		pMeans[x] = (uint8)(thresholds ? (mean * SCAN_ENHANCE_THRESHOLD_SCALE + 64) >> 7 : mean);
+	}
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//PUBLIC FUNCTIONS
+
+const char* ScanEnhanceModeName(ScanEnhanceMode mode) {
+	return g_scanEnhanceModeNames[mode];
+}
+
+bool ScanEnhanceModeFromName(const char* pName, ScanEnhanceMode* pMode) {
+	for(uint i = 0; i < SCAN_ENHANCE_COUNT; ++i) {
+		if(strcmp(pName, g_scanEnhanceModeNames[i]) == 0) {
+			*pMode = (ScanEnhanceMode)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ScanEnhancerInit(ScanEnhancer* pEnhancer) {
+	memset(pEnhancer, 0, sizeof(ScanEnhancer));
+}
+
+void ScanEnhancerRelease(ScanEnhancer* pEnhancer) {
+	ScanFree(pEnhancer->pBuffer);
+	ScanEnhancerInit(pEnhancer);
+}
+
+//Row y is rewritten once the column sums cover rows y - radius to y + radius. The rows below it are still original, the
+//rows above it are not: the last radius + 1 original rows are kept in a ring, row i in slot i % (radius + 1), so row
+//y - radius - 1 can be taken out of the sums just before row y takes its slot.
+bool ScanEnhance(ScanEnhancer* pEnhancer, ScanEnhanceMode mode, uint8* pPixels, uint width, uint height) {
+	if(mode == SCAN_ENHANCE_OFF || width == 0 || height == 0)
+		return true;
+
+	const uint radius = EnhanceRadius(width, height), savedRows = radius + 1;
+	if(!ScanReserveBuffer(&pEnhancer->pBuffer, &pEnhancer->bufferCapacity, width * (sizeof(uint16) + 1 + savedRows)))
+		return false;
+	uint16* pSums = (uint16*)pEnhancer->pBuffer;
+	uint8* pMeans = pEnhancer->pBuffer + width * sizeof(uint16);
+	uint8* pSaved = pMeans + width;
+
+	memset(pSums, 0, width * sizeof(uint16));
+	for(uint y = 0; y < radius && y < height; ++y)
+		AddY800ToSums(pPixels + y * width, pSums, width);
+
+	uint8* pRow = pPixels;
+	for(uint y = 0; y < height; ++y, pRow += width) {
+		uint8* pSavedRow = pSaved + (y % savedRows) * width;
+		if(y + radius < height)
+			AddY800ToSums(pRow + radius * width, pSums, width);
+		if(y > radius)
+			SubtractY800FromSums(pSavedRow, pSums, width); //Row y - radius - 1
+		memcpy(pSavedRow, pRow, width);
+
+		ComputeMeans(pSums, width, radius, WindowCount(y, radius, height), mode == SCAN_ENHANCE_THRESHOLD, pMeans);
+		if(mode == SCAN_ENHANCE_STRETCH)
+			StretchY800(pRow, pMeans, width);
+		else
+			ThresholdY800(pRow, pMeans, width);
+	}
+	return true;
+}
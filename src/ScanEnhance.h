@@ -0,0 +1,47 @@
+#ifndef SCAN_ENHANCE_H
+#define SCAN_ENHANCE_H
+
+#include "ScanTypes.h"
+
+//Optional clean up of a Y800 frame before ZBar scans it. In low light or glare a code has little contrast and the
+//illumination changes across it, so ZBar's edge detector misses modules and frame after frame fails. Both modes compare
+//every pixel with the mean of the window around it, which follows the illumination:
+// - SCAN_ENHANCE_STRETCH amplifies the difference to the local mean, keeping gray levels, and
+// - SCAN_ENHANCE_THRESHOLD binarizes against a fraction of the local mean (Bradley's adaptive threshold).
+//The window means are box sums: 16 bit column sums slide down the frame a row at a time and a running sum slides along
+//each row, so a pixel costs the same whatever the window size and no integral image has to be stored. The column sums
+//and the per pixel stretch or threshold are SIMD kernels (see FrameKernels.h).
+//All state belongs to the thread that scans.
+
+#define SCAN_ENHANCE_WINDOW_DIVISOR 16 //Window radius is the frame size over this, a few QR modules of a code filling the frame
+#define SCAN_ENHANCE_MIN_RADIUS 4
+#define SCAN_ENHANCE_MAX_RADIUS 64 //(2 * 64 + 1) rows of 255 still fit a 16 bit column sum
+#define SCAN_ENHANCE_THRESHOLD_SCALE 109 //Threshold is 109/128 (85%) of the local mean
+
+enum ScanEnhanceMode {
+	SCAN_ENHANCE_OFF, //Scan the frame as converted
+	SCAN_ENHANCE_STRETCH, //Local contrast stretch
+	SCAN_ENHANCE_THRESHOLD, //Adaptive threshold
+	SCAN_ENHANCE_COUNT
+};
+
+struct ScanEnhancer {
+	uint8* pBuffer; //Column sums, the means or thresholds of one row and the last rows before they were overwritten
+	uint bufferCapacity;
+};
+
+//Name of the mode ("off", "stretch", "threshold"), as used in app.icf and by the tools.
+const char* ScanEnhanceModeName(ScanEnhanceMode mode);
+
+//Look up a mode by its name. Returns false if the name is unknown.
+bool ScanEnhanceModeFromName(const char* pName, ScanEnhanceMode* pMode);
+
+void ScanEnhancerInit(ScanEnhancer* pEnhancer);
+
+void ScanEnhancerRelease(ScanEnhancer* pEnhancer);
+
+//Enhance a width x height Y800 frame in place. SCAN_ENHANCE_OFF leaves it untouched. Returns false, also leaving the
+//frame untouched, if the working buffer couldn't be allocated.
+bool ScanEnhance(ScanEnhancer* pEnhancer, ScanEnhanceMode mode, uint8* pPixels, uint width, uint height);
+
+#endif
@@ -0,0 +1,264 @@
+#include "ScanExport.h"
+#include "BufferPool.h"
+
+#include <string.h>
+
+#ifdef SCAN_HOST_BUILD
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+static inline int16 ClampInt16(int value) {
+	return (int16)(value < -32768 ? -32768 : (value > 32767 ? 32767 : value));
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//WRITER
+
+bool ScanExportOpen(ScanExport* pExport, const char* pPath, uint ringBytes) {
+	memset(pExport, 0, sizeof(ScanExport));
+	if(ringBytes < 256 || (ringBytes & (ringBytes - 1)))
+		return false;
+	const uint blockSize = sizeof(ScanExportHeader) + ringBytes;
+	if(pPath == NULL) {
+		pExport->pBlock = (uint8*)ScanAlloc(blockSize);
+	}
+	else {
+#ifdef SCAN_HOST_BUILD
+		//A new file rather than the old one truncated: readers still mapping the old one keep a valid mapping
+		unlink(pPath);
+		const int fd = open(pPath, O_RDWR | O_CREAT | O_EXCL, 0644);
+		if(fd < 0)
+			return false;
+		void* pMapping = MAP_FAILED;
+		if(ftruncate(fd, (off_t)blockSize) == 0)
+			pMapping = mmap(NULL, blockSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd); //The mapping keeps the file open
+		if(pMapping == MAP_FAILED)
+			return false;
+		pExport->pBlock = (uint8*)pMapping;
+		pExport->mapped = true;
+#else
+		return false; //No shared memory or file mappings in s3e
+#endif
+	}
+	if(pExport->pBlock == NULL)
+		return false;
+	pExport->blockSize = blockSize;
+	pExport->pHeader = (ScanExportHeader*)pExport->pBlock;
+	pExport->pRing = pExport->pBlock + sizeof(ScanExportHeader);
+
+	ScanExportHeader* pHeader = pExport->pHeader;
+	memset(pHeader, 0, sizeof(ScanExportHeader));
+	pHeader->version = SCAN_EXPORT_VERSION;
+	pHeader->headerSize = sizeof(ScanExportHeader);
+	pHeader->ringBytes = ringBytes;
+	AtomicStore((volatile int32*)&pHeader->magic, (int32)SCAN_EXPORT_MAGIC); //Last: a reader that sees it sees the rest
+	return true;
+}
+
+void ScanExportClose(ScanExport* pExport) {
+	if(pExport->pBlock) {
+#ifdef SCAN_HOST_BUILD
+		if(pExport->mapped)
+			munmap(pExport->pBlock, pExport->blockSize);
+		else
+#endif
+			ScanFree(pExport->pBlock);
+	}
+	memset(pExport, 0, sizeof(ScanExport));
+}
+
+bool ScanExportWrite(ScanExport* pExport, int32 type, const char* pData, uint dataLength, const int* pPointsXY,
+	uint numPoints, uint width, uint height, uint32 frameSequence, uint64 timestampNs, uint64 latencyNs) {
+	if(pExport->pBlock == NULL)
+		return false;
+	ScanExportHeader* pHeader = pExport->pHeader;
+	numPoints = numPoints < SCAN_EXPORT_MAX_POINTS ? numPoints : SCAN_EXPORT_MAX_POINTS;
+
+	//Positions only grow and are taken modulo the ring size. With at most half the ring per record, a record and the
+	//filler before it always fit.
+	const uint32 ringBytes = pHeader->ringBytes;
+	const uint32 size = (sizeof(ScanExportRecord) + numPoints * 2 * sizeof(int16) + dataLength + 1 +
+		SCAN_EXPORT_ALIGNMENT - 1) & ~(uint32)(SCAN_EXPORT_ALIGNMENT - 1);
+	if(size > ringBytes / 2) {
+		AtomicAdd(&pHeader->dropped, 1);
+		return false;
+	}
+	uint32 head = (uint32)pHeader->head;
+	uint32 offset = head & (ringBytes - 1);
+	const uint32 padding = offset + size > ringBytes ? ringBytes - offset : 0;
+	AtomicStore(&pHeader->writeEnd, (int32)(head + padding + size)); //Before any byte a reader may be using changes
+
+	if(padding) {
+		ScanExportRecord* pFiller = (ScanExportRecord*)(pExport->pRing + offset);
+		pFiller->size = padding;
+		pFiller->type = SCAN_EXPORT_FILLER;
+		head += padding;
+		offset = 0;
+	}
+
+	ScanExportRecord* pRecord = (ScanExportRecord*)(pExport->pRing + offset);
+	pRecord->size = size;
+	pRecord->type = type;
+	pRecord->sequence = (uint32)pHeader->records;
+	pRecord->frameSequence = frameSequence;
+	pRecord->timestampNs = timestampNs;
+	pRecord->latencyUs = latencyNs / 1000 > 0xffffffffull ? 0xffffffffu : (uint32)(latencyNs / 1000);
+	pRecord->dataLength = dataLength;
+	pRecord->frameWidth = (uint16)(width > 0xffff ? 0xffff : width);
+	pRecord->frameHeight = (uint16)(height > 0xffff ? 0xffff : height);
+	pRecord->numPoints = numPoints;
+	int16* pPoints = (int16*)(pRecord + 1);
+	for(uint i = 0; i < 2 * numPoints; ++i)
+		pPoints[i] = ClampInt16(pPointsXY[i]);
+	char* pRecordData = (char*)(pPoints + 2 * numPoints);
+	memcpy(pRecordData, pData, dataLength);
+	pRecordData[dataLength] = '\0';
+
+	AtomicAdd(&pHeader->records, 1);
+	AtomicStore(&pHeader->head, (int32)(head + size)); //Publish the record after it has been filled in
+	return true;
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//READER
+
+#define SCAN_EXPORT_HEAD_TRIES 1000
+
+//Get head and the number of records written before it, the sequence of the record written there next. The writer
+//updates them one after the other, so they only match while no record is being written (writeEnd == head): try a few
+//times. Returns false if the writer never paused, e.g. it stopped in the middle of a record, with *pHead still set.
+static bool ReadHead(ScanExportHeader* pHeader, uint32* pHead, uint32* pRecords) {
+	for(uint i = 0; i < SCAN_EXPORT_HEAD_TRIES; ++i) {
+		const int32 records = AtomicLoad(&pHeader->records);
+		const int32 head = AtomicLoad(&pHeader->head);
+		*pHead = (uint32)head;
+		if(AtomicLoad(&pHeader->writeEnd) == head && AtomicLoad(&pHeader->records) == records) {
+			*pRecords = (uint32)records;
+			return true;
+		}
+	}
+	return false;
+}
+
+//Point the reader at the ring of its block and skip the records already there. Every record written from then on is
+//read or counted as missed; unless the writer was stuck in the middle of a record, then the first record read sets the
+//sequence expected.
+static void StartReading(ScanExportReader* pReader) {
+	pReader->pHeader = (ScanExportHeader*)pReader->pBlock;
+	pReader->pRing = pReader->pBlock + pReader->pHeader->headerSize;
+	pReader->haveSequence = ReadHead(pReader->pHeader, &pReader->position, &pReader->nextSequence);
+	pReader->recordPosition = pReader->position;
+}
+
+bool ScanExportReaderOpen(ScanExportReader* pReader, const char* pPath) {
+	memset(pReader, 0, sizeof(ScanExportReader));
+#ifdef SCAN_HOST_BUILD
+	const int fd = open(pPath, O_RDWR);
+	if(fd < 0)
+		return false;
+	struct stat status;
+	void* pMapping = MAP_FAILED;
+	if(fstat(fd, &status) == 0 && (uint64)status.st_size >= sizeof(ScanExportHeader))
+		pMapping = mmap(NULL, (size_t)status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(pMapping == MAP_FAILED)
+		return false;
+	pReader->pBlock = (const uint8*)pMapping;
+	pReader->blockSize = (uint)status.st_size;
+	pReader->mapped = true;
+
+	//The writer sets the magic last, after the rest of the header
+	ScanExportHeader* pHeader = (ScanExportHeader*)pMapping;
+	const uint32 ringBytes = pHeader->ringBytes;
+	if((uint32)AtomicLoad((volatile int32*)&pHeader->magic) != SCAN_EXPORT_MAGIC || pHeader->version != SCAN_EXPORT_VERSION ||
+		ringBytes < 256 || (ringBytes & (ringBytes - 1)) || (uint64)pHeader->headerSize + ringBytes > pReader->blockSize)
+		return false;
+	StartReading(pReader);
+	return true;
+#else
+	(void)pPath;
+	return false;
+#endif
+}
+
+void ScanExportReaderAttach(ScanExportReader* pReader, const ScanExport* pExport) {
+	memset(pReader, 0, sizeof(ScanExportReader));
+	pReader->pBlock = pExport->pBlock;
+	pReader->blockSize = pExport->blockSize;
+	if(pReader->pBlock)
+		StartReading(pReader);
+}
+
+void ScanExportReaderClose(ScanExportReader* pReader) {
+#ifdef SCAN_HOST_BUILD
+	if(pReader->mapped)
+		munmap((void*)pReader->pBlock, pReader->blockSize);
+#endif
+	memset(pReader, 0, sizeof(ScanExportReader));
+}
+
+bool ScanExportReaderNext(ScanExportReader* pReader, ScanExportView* pView) {
+	if(pReader->pRing == NULL)
+		return false;
+	ScanExportHeader* pHeader = pReader->pHeader;
+	const uint32 ringBytes = pHeader->ringBytes;
+	for(;;) {
+		const uint32 head = (uint32)AtomicLoad(&pHeader->head);
+		if(pReader->position == head)
+			return false;
+
+		//Copy the record's fields, then check the writer hadn't reached them yet. Only the size and type of a filler are
+		//written, and it may be too close to the end of the ring for the rest.
+		const uint32 offset = pReader->position & (ringBytes - 1);
+		const ScanExportRecord* pRecord = (const ScanExportRecord*)(pReader->pRing + offset);
+		ScanExportRecord& record = pView->record;
+		record.size = pRecord->size;
+		record.type = pRecord->type;
+		if(record.type != SCAN_EXPORT_FILLER && offset + sizeof(ScanExportRecord) <= ringBytes)
+			memcpy(&record, pRecord, sizeof(ScanExportRecord));
+		const uint32 size = record.size;
+		if((uint32)AtomicLoad(&pHeader->writeEnd) - pReader->position > ringBytes || size == 0 || size > ringBytes - offset ||
+			(size & (SCAN_EXPORT_ALIGNMENT - 1))) {
+			//Fell behind by more than the ring: go on from the newest and count the records skipped now, as there may be
+			//no later record to show the gap. If the counters don't match the gap shows in the next record's sequence.
+			uint32 records;
+			if(ReadHead(pHeader, &pReader->position, &records)) {
+				if(pReader->haveSequence)
+					pReader->missed += records - pReader->nextSequence;
+				pReader->nextSequence = records;
+				pReader->haveSequence = true;
+			}
+			continue;
+		}
+		pReader->position += size;
+		if(record.type == SCAN_EXPORT_FILLER)
+			continue;
+		pReader->recordPosition = pReader->position - size;
+		if(record.numPoints > SCAN_EXPORT_MAX_POINTS || record.dataLength >= size ||
+			sizeof(ScanExportRecord) + record.numPoints * 2 * sizeof(int16) + record.dataLength >= size) {
+			++pReader->missed; //Not a record this version writes
+			++pReader->nextSequence; //Already counted, not part of the next record's gap
+			continue;
+		}
+		if(pReader->haveSequence)
+			pReader->missed += record.sequence - pReader->nextSequence;
+		pReader->nextSequence = record.sequence + 1;
+		pReader->haveSequence = true;
+		++pReader->read;
+		pView->pPoints = (const int16*)(pRecord + 1);
+		pView->pData = (const char*)(pView->pPoints + 2 * record.numPoints);
+		return true;
+	}
+}
+
+bool ScanExportReaderValid(ScanExportReader* pReader) {
+	if((uint32)AtomicLoad(&pReader->pHeader->writeEnd) - pReader->recordPosition <= pReader->pHeader->ringBytes)
+		return true;
+	--pReader->read;
+	++pReader->missed;
+	return false;
+}
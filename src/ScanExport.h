@@ -0,0 +1,125 @@
+#ifndef SCAN_EXPORT_H
+#define SCAN_EXPORT_H
+
+#include "ScanThread.h"
+
+//Hands every reported symbol to consumers outside the UI: the scan worker writes a compact binary record of each into a
+//ring in one block of memory, which readers poll without locks and read in place.
+// - Host builds map the block from a file, so another process can map it too; a file in /dev/shm on Linux is shared
+//   memory. On the device the block is on the heap for consumers in the same process (e.g. an extension).
+// - There is one writer and it never waits: a reader that falls more than the ring behind loses the oldest records and
+//   counts them. A reader never changes the block, but maps it writable as AtomicLoad is a locked add of 0.
+// - Records are variable length (this header, the location polygon and the payload), are never split across the end
+//   of the ring and are 8 byte aligned. Positions are byte counts since the ring was created and only grow, taken
+//   modulo ringBytes.
+// - A record is safe to use while the writer hasn't started to overwrite it, which ScanExportReaderValid checks after
+//   the fact, the way a seqlock reader does. Its lengths are the exception: ScanExportReaderNext checks a copy of them
+//   and readers use that copy, as a torn length read from the ring would take them out of the record.
+//Only fixed size types are used and the block has no pointers. A consumer links ScanExport.cpp (libscan.a on the host)
+//and doesn't need ZBar.
+
+#define SCAN_EXPORT_MAGIC 0x58524353 //"SCRX"
+#define SCAN_EXPORT_VERSION 1
+#define SCAN_EXPORT_DEFAULT_RING_BYTES 65536 //Power of two. Hundreds of short codes, or several of the largest QR codes.
+#define SCAN_EXPORT_ALIGNMENT 8
+#define SCAN_EXPORT_MAX_POINTS 16 //Location polygon points a record holds
+#define SCAN_EXPORT_FILLER 0 //type of the record that fills the end of the ring before a wrap (ZBAR_NONE)
+
+//At the start of the block, followed by the ring.
+struct ScanExportHeader {
+	uint32 magic; //SCAN_EXPORT_MAGIC, written last by the writer
+	uint32 version; //SCAN_EXPORT_VERSION
+	uint32 headerSize; //Bytes from the start of the block to the ring
+	uint32 ringBytes;
+	volatile int32 head; //Position after the last complete record
+	volatile int32 writeEnd; //Position up to which the writer may be writing. Bytes before writeEnd - ringBytes are gone.
+	volatile int32 records; //Records written
+	volatile int32 dropped; //Records too large for the ring, not written
+};
+
+struct ScanExportRecord {
+	uint32 size; //Bytes to the next record
+	int32 type; //zbar_symbol_type_t, SCAN_EXPORT_FILLER for a filler
+	uint32 sequence; //Records written before this one. A gap tells a reader how many it missed.
+	uint32 frameSequence; //FrameSlot::sequence of the frame the symbol was found in
+	uint64 timestampNs; //ScanClockNs() time the frame was captured (CLOCK_MONOTONIC on host builds)
+	uint32 latencyUs; //From the capture to the end of the decode
+	uint32 dataLength; //Payload bytes, without the nul that follows them
+	uint16 frameWidth, frameHeight; //Size of the scanned frame (the cropped square) the polygon is in
+	uint32 numPoints; //Location polygon points, up to SCAN_EXPORT_MAX_POINTS
+	//Followed by numPoints x, y int16 pairs in frame pixels, the payload and a nul
+};
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//WRITER
+
+//Owned by the thread that writes, the scan worker.
+struct ScanExport {
+	uint8* pBlock; //Header and ring, NULL if not open
+	uint blockSize;
+	bool mapped; //pBlock is a file mapping (host builds), otherwise it is on the heap
+	ScanExportHeader* pHeader;
+	uint8* pRing;
+};
+
+//Create the block with a ring of ringBytes (a power of two): mapped from a new file at pPath, replacing any file there,
+//or on the heap if pPath is NULL. Files need a host build. Returns false on failure, pExport must still be closed.
+bool ScanExportOpen(ScanExport* pExport, const char* pPath, uint ringBytes);
+
+//Unmap or free the block. A mapped file stays behind with the records in it.
+void ScanExportClose(ScanExport* pExport);
+
+//Append a record: the payload, its location polygon as pPointsXY (numPoints x, y pairs in a width x height frame, only
+//the first SCAN_EXPORT_MAX_POINTS are kept), the frame's capture time and the capture to decode latency. Returns false
+//and counts it as dropped if it can't fit.
+bool ScanExportWrite(ScanExport* pExport, int32 type, const char* pData, uint dataLength, const int* pPointsXY,
+	uint numPoints, uint width, uint height, uint32 frameSequence, uint64 timestampNs, uint64 latencyNs);
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//READER
+
+//A record returned by ScanExportReaderNext.
+struct ScanExportView {
+	ScanExportRecord record; //Copy of its fields, checked: numPoints <= SCAN_EXPORT_MAX_POINTS, the payload fits
+	const int16* pPoints; //record.numPoints x, y pairs, in the ring
+	const char* pData; //record.dataLength bytes and a nul, in the ring
+};
+
+struct ScanExportReader {
+	const uint8* pBlock;
+	uint blockSize;
+	bool mapped; //Opened from a file by ScanExportReaderOpen
+	ScanExportHeader* pHeader;
+	const uint8* pRing;
+	uint32 position; //Next record to read
+	uint32 recordPosition; //Position of the record last returned
+	uint32 nextSequence; //Sequence expected next
+	bool haveSequence; //nextSequence is known: from the start, or once a record has been read if the writer was busy
+
+	//Counters
+	uint32 read;
+	uint32 missed; //Records overwritten before they were read
+};
+
+//Map the block a writer created at pPath (host builds). Only records written from now on are read, and each of them
+//counts as read or missed. Returns false if there is no such file or it isn't a complete block yet; pReader must still
+//be closed.
+bool ScanExportReaderOpen(ScanExportReader* pReader, const char* pPath);
+
+//Read the block of a writer in this process. Only records written from now on are read, as by ScanExportReaderOpen.
+void ScanExportReaderAttach(ScanExportReader* pReader, const ScanExport* pExport);
+
+void ScanExportReaderClose(ScanExportReader* pReader);
+
+//Get the oldest record not read yet: a checked copy of its fields, and its polygon and payload in place in the ring.
+//Returns false if there is none. The ring may be overwritten while the record is used, so a consumer:
+// - takes the lengths from pView->record only, never from the ring again, as they may be torn by then,
+// - copies what it needs out of pPoints and pData, within those lengths,
+// - then checks ScanExportReaderValid, and throws the copies away if it fails.
+bool ScanExportReaderNext(ScanExportReader* pReader, ScanExportView* pView);
+
+//True if the record last returned by ScanExportReaderNext hasn't started to be overwritten. If it has, what was read
+//from it may be torn, and it counts as missed instead of read. Call it once per record.
+bool ScanExportReaderValid(ScanExportReader* pReader);
+
+#endif
@@ -0,0 +1,121 @@
+#include "ScanGovernor.h"
+
+#include <string.h>
+
+#define SCAN_GOVERNOR_DEFAULT_WINDOW_NS 2000000000ull //2 s
+#define SCAN_GOVERNOR_DEFAULT_MAX_PREPARE_NS 15000000ull //15 ms, half a frame at 30 frames/s
+#define SCAN_GOVERNOR_DEFAULT_MAX_DECODE_NS 150000000ull //150 ms
+#define SCAN_GOVERNOR_DEFAULT_MAX_LATENCY_NS 400000000ull //400 ms
+#define SCAN_GOVERNOR_DEFAULT_HEADROOM_PERCENT 40
+#define SCAN_GOVERNOR_DEFAULT_DOWN_WINDOWS 2
+#define SCAN_GOVERNOR_DEFAULT_UP_WINDOWS 4
+#define SCAN_GOVERNOR_DEFAULT_UP_HOLDOFF_NS 60000000000ull //60 s
+#define SCAN_GOVERNOR_DEFAULT_MIN_SCANS 4
+
+static void ReadTotals(const ScanStats* pStats, ScanGovernorWindow* pTotals) {
+	const LatencyHistogram* pStages = pStats->stages;
+	pTotals->frames = pStages[SCAN_STAGE_PREPARE].count;
+	pTotals->scans = pStats->framesScanned;
+	pTotals->decoded = pStats->framesDecoded;
+	pTotals->latencies = pStages[SCAN_STAGE_LATENCY].count;
+	pTotals->prepareNs = pStages[SCAN_STAGE_PREPARE].totalNs;
+	pTotals->decodeNs = pStages[SCAN_STAGE_ENHANCE].totalNs + pStages[SCAN_STAGE_DECODE].totalNs;
+	pTotals->latencyNs = pStages[SCAN_STAGE_LATENCY].totalNs;
+}
+
+void ScanGovernorInit(ScanGovernor* pGovernor, uint levels, uint level, uint64 nowNs) {
+	memset(pGovernor, 0, sizeof(ScanGovernor));
+	pGovernor->windowNs = SCAN_GOVERNOR_DEFAULT_WINDOW_NS;
+	pGovernor->maxPrepareNs = SCAN_GOVERNOR_DEFAULT_MAX_PREPARE_NS;
+	pGovernor->maxDecodeNs = SCAN_GOVERNOR_DEFAULT_MAX_DECODE_NS;
+	pGovernor->maxLatencyNs = SCAN_GOVERNOR_DEFAULT_MAX_LATENCY_NS;
+	pGovernor->headroomPercent = SCAN_GOVERNOR_DEFAULT_HEADROOM_PERCENT;
+	pGovernor->downWindows = SCAN_GOVERNOR_DEFAULT_DOWN_WINDOWS;
+	pGovernor->upWindows = SCAN_GOVERNOR_DEFAULT_UP_WINDOWS;
+	pGovernor->upHoldoffNs = SCAN_GOVERNOR_DEFAULT_UP_HOLDOFF_NS;
+	pGovernor->holdoffNs = pGovernor->upHoldoffNs;
+	pGovernor->minScans = SCAN_GOVERNOR_DEFAULT_MIN_SCANS;
+	pGovernor->maxLevel = levels ? levels - 1 : 0;
+	pGovernor->level = level < pGovernor->maxLevel ? level : pGovernor->maxLevel;
+	pGovernor->windowStartNs = nowNs;
+	pGovernor->settling = true; //The totals are only read at the end of the first window
+}
+
+uint ScanGovernorUpdate(ScanGovernor* pGovernor, const ScanStats* pStats, uint64 nowNs, ScanGovernorReason* pReason) {
+	*pReason = SCAN_GOVERNOR_HOLD;
+	if(nowNs - pGovernor->windowStartNs < pGovernor->windowNs)
+		return pGovernor->level;
+
+	//Close the window
+	ScanGovernorWindow totals;
+	ReadTotals(pStats, &totals);
+	ScanGovernorWindow& window = pGovernor->window;
+	window.frames = totals.frames - pGovernor->totals.frames;
+	window.scans = totals.scans - pGovernor->totals.scans;
+	window.decoded = totals.decoded - pGovernor->totals.decoded;
+	window.latencies = totals.latencies - pGovernor->totals.latencies;
+	window.prepareNs = totals.prepareNs - pGovernor->totals.prepareNs;
+	window.decodeNs = totals.decodeNs - pGovernor->totals.decodeNs;
+	window.latencyNs = totals.latencyNs - pGovernor->totals.latencyNs;
+	pGovernor->totals = totals;
+	pGovernor->windowStartNs = nowNs;
+	const bool settling = pGovernor->settling;
+	pGovernor->settling = false;
+	if(settling || window.frames == 0 || window.scans < pGovernor->minScans || window.latencies == 0) {
+		pGovernor->overloadedWindows = pGovernor->headroomWindows = 0;
+		return pGovernor->level;
+	}
+
+	const uint64 prepareNs = window.prepareNs / window.frames;
+	const uint64 decodeNs = window.decodeNs / window.scans;
+	const uint64 latencyNs = window.latencyNs / window.latencies;
+	ScanGovernorReason overload = SCAN_GOVERNOR_HOLD;
+	if(prepareNs > pGovernor->maxPrepareNs)
+		overload = SCAN_GOVERNOR_SLOW_PREPARE;
+	else if(decodeNs > pGovernor->maxDecodeNs)
+		overload = SCAN_GOVERNOR_SLOW_DECODE;
+	else if(latencyNs > pGovernor->maxLatencyNs)
+		overload = SCAN_GOVERNOR_HIGH_LATENCY;
+	const uint percent = pGovernor->headroomPercent;
+	const bool headroom = overload == SCAN_GOVERNOR_HOLD && window.decoded == 0 &&
+		prepareNs * 100 < pGovernor->maxPrepareNs * percent && decodeNs * 100 < pGovernor->maxDecodeNs * percent &&
+		latencyNs * 100 < pGovernor->maxLatencyNs * percent;
+	pGovernor->overloadedWindows = overload != SCAN_GOVERNOR_HOLD ? pGovernor->overloadedWindows + 1 : 0;
+	pGovernor->headroomWindows = headroom ? pGovernor->headroomWindows + 1 : 0;
+
+	if(pGovernor->overloadedWindows >= pGovernor->downWindows && pGovernor->level > 0) {
+		*pReason = overload;
+		return pGovernor->level - 1;
+	}
+	if(pGovernor->headroomWindows >= pGovernor->upWindows && pGovernor->level < pGovernor->maxLevel &&
+		nowNs >= pGovernor->upBlockedUntilNs) {
+		*pReason = SCAN_GOVERNOR_HEADROOM;
+		return pGovernor->level + 1;
+	}
+	return pGovernor->level;
+}
+
+void ScanGovernorSwitched(ScanGovernor* pGovernor, const ScanStats* pStats, uint level, uint64 nowNs) {
+	if(level < pGovernor->level) {
+		++pGovernor->switchesDown;
+		if(pGovernor->lastStepUp && pGovernor->holdoffNs < 16 * pGovernor->upHoldoffNs)
+			pGovernor->holdoffNs *= 2; //The larger size couldn't be sustained, try it again less often
+		pGovernor->upBlockedUntilNs = nowNs + pGovernor->holdoffNs;
+		pGovernor->lastStepUp = false;
+	}
+	else if(level > pGovernor->level) {
+		++pGovernor->switchesUp;
+		pGovernor->lastStepUp = true;
+	}
+	pGovernor->level = level;
+	ReadTotals(pStats, &pGovernor->totals);
+	pGovernor->windowStartNs = nowNs;
+	pGovernor->settling = true;
+	pGovernor->overloadedWindows = pGovernor->headroomWindows = 0;
+}
+
+const char* ScanGovernorReasonName(ScanGovernorReason reason) {
+	static const char* names[SCAN_GOVERNOR_REASON_COUNT] = { "hold", "slow prepare", "slow decode", "high latency",
+		"headroom" };
+	return reason < SCAN_GOVERNOR_REASON_COUNT ? names[reason] : "?";
+}
@@ -0,0 +1,79 @@
+#ifndef SCAN_GOVERNOR_H
+#define SCAN_GOVERNOR_H
+
+#include "ScanStats.h"
+
+//Picks the camera resolution the device can sustain. The main loop feeds it the scan engine's stats and it looks at
+//them over windows of windowNs:
+// - a window is overloaded if the camera callback's prepare time per frame, the scan worker's enhance and decode time
+//   per scan or the end to end latency is over its limit. downWindows overloaded windows in a row step the resolution
+//   down. A phone that throttles when it gets hot shows up here as decodes getting slower.
+// - a window has headroom if all three are under headroomPercent of their limits while frames were scanned and none
+//   decoded, so a small or distant code may need more pixels. upWindows such windows in a row step the resolution up,
+//   but not within a holdoff of a step down, so the governor doesn't flip between two sizes. The holdoff starts at
+//   upHoldoffNs and doubles every time a step up had to be taken back, up to 16 times.
+//The window after a switch is skipped, as it mixes frames of both sizes. All state belongs to the main loop.
+
+enum ScanGovernorReason {
+	SCAN_GOVERNOR_HOLD, //No switch
+	SCAN_GOVERNOR_SLOW_PREPARE, //Down: the camera callback takes too long per frame
+	SCAN_GOVERNOR_SLOW_DECODE, //Down: scans take too long
+	SCAN_GOVERNOR_HIGH_LATENCY, //Down: results come too late after the frame was captured
+	SCAN_GOVERNOR_HEADROOM, //Up: time to spare and nothing decoded
+	SCAN_GOVERNOR_REASON_COUNT
+};
+
+//Totals of the ScanStats the governor looks at, or their difference over a window.
+struct ScanGovernorWindow {
+	uint32 frames; //Frames prepared by the camera callback
+	uint32 scans;
+	uint32 decoded; //Scans that found a symbol
+	uint32 latencies; //Scans with a latency recorded
+	uint64 prepareNs;
+	uint64 decodeNs; //Enhancement included
+	uint64 latencyNs;
+};
+
+struct ScanGovernor {
+	//Settings
+	uint64 windowNs;
+	uint64 maxPrepareNs; //Mean prepare time per frame
+	uint64 maxDecodeNs; //Mean enhance and decode time per scan
+	uint64 maxLatencyNs; //Mean capture to end of scan time
+	uint headroomPercent;
+	uint downWindows;
+	uint upWindows;
+	uint64 upHoldoffNs;
+	uint minScans; //Windows with fewer scans (e.g. while a result is shown) count as neither overloaded nor headroom
+
+	//State
+	uint level; //Current resolution, 0 the lowest
+	uint maxLevel; //Highest resolution allowed. Lowered when the camera refuses a size.
+	uint64 windowStartNs;
+	bool settling; //The current window is the first after a switch and is skipped
+	ScanGovernorWindow totals; //Stats totals at the start of the window
+	ScanGovernorWindow window; //The last complete window, for tracing
+	uint overloadedWindows; //In a row
+	uint headroomWindows; //In a row
+	uint64 holdoffNs; //Time a step down blocks stepping up
+	bool lastStepUp; //The last switch was a step up
+	uint64 upBlockedUntilNs;
+
+	//Counters
+	uint32 switchesUp;
+	uint32 switchesDown;
+};
+
+//Start at level of levels resolutions (0 to levels - 1) with the default limits.
+void ScanGovernorInit(ScanGovernor* pGovernor, uint levels, uint level, uint64 nowNs);
+
+//Look at the stats once per main loop. Returns the level to switch to, the current level if there's nothing to do, and
+//why in *pReason. The switch only counts once the caller reports it with ScanGovernorSwitched.
+uint ScanGovernorUpdate(ScanGovernor* pGovernor, const ScanStats* pStats, uint64 nowNs, ScanGovernorReason* pReason);
+
+//The camera now runs at level. Starts a new window, skipped because it mixes the sizes.
+void ScanGovernorSwitched(ScanGovernor* pGovernor, const ScanStats* pStats, uint level, uint64 nowNs);
+
+const char* ScanGovernorReasonName(ScanGovernorReason reason);
+
+#endif
@@ -0,0 +1,125 @@
+#include "ScanPipeline.h"
+
+#include <string.h>
+
+void ComputeFrameCrop(uint width, uint height, FrameCrop* pCrop) {
+	if(width > height) {
+		pCrop->dim = height;
+		pCrop->x = (width - height) / 2;
+		pCrop->y = 0;
+	}
+	else {
+		pCrop->dim = width;
+		pCrop->x = 0;
+		pCrop->y = (height - width) / 2;
+	}
+}
+
+void PrepareCameraFrame(const CameraFrame* pFrame, const FrameCrop* pCrop, uint previewDim, uint16* pPreview, uint8* pGray) {
+	const bool yuvFrame = pFrame->pixelType != FRAME_PIXEL_RGB565; //NV21/NV12: pData starts with the 8 bit luma plane
+	const uint bytesPerPixel = yuvFrame ? 1 : 2;
+	const uint pitch = (pFrame->pitch / bytesPerPixel) < pFrame->width ? pFrame->width : (pFrame->pitch / bytesPerPixel); //Row length in pixels
+
+	if(yuvFrame) {
+		//Only the preview is color converted. The chroma plane follows the luma plane with the same pitch.
+		//The luma plane is only valid during the camera callback, so its cropping square is copied for the scan worker,
+		//which may scan it long after the callback returned. The copy is a memcpy per line (see scanbench's luma copy).
+		const uint8* pLuma = (const uint8*)pFrame->pData;
+		const uint8* pChroma = pLuma + pitch * pFrame->height;
+		if(pPreview) {
+			ScaleCropYUV420SPToRGB565(pLuma, pitch, pChroma, pitch, pFrame->pixelType == FRAME_PIXEL_NV21,
+				pCrop->x, pCrop->y, pCrop->dim, previewDim, pFrame->rotation, pPreview);
+		}
+		if(pGray)
+			CropY800(pLuma, pitch, pCrop->x, pCrop->y, pCrop->dim, pGray);
+	}
+	else {
+		const uint16* pPixels = (const uint16*)pFrame->pData;
+		if(pPreview && pGray && previewDim == pCrop->dim) {
+			//Crop and rotate into the preview and convert it to grayscale in the same pass, so the frame is only read once.
+			CropRotateRGB565(pPixels, pitch, pCrop->x, pCrop->y, pCrop->dim, pFrame->rotation, pPreview, pGray);
+			return;
+		}
+		if(pPreview)
+			ScaleCropRGB565(pPixels, pitch, pCrop->x, pCrop->y, pCrop->dim, previewDim, pFrame->rotation, pPreview);
+		if(pGray)
+			CropRGB565ToY800(pPixels, pitch, pCrop->x, pCrop->y, pCrop->dim, pGray);
+	}
+}
+
+static const char* g_scanModeNames[] = { "full", "pyramid", "tracking" };
+
+const char* ScanModeName(ScanMode mode) {
+	return g_scanModeNames[mode];
+}
+
+bool ScanModeFromName(const char* pName, ScanMode* pMode) {
+	for(uint i = 0; i < sizeof(g_scanModeNames) / sizeof(g_scanModeNames[0]); ++i) {
+		if(strcmp(pName, g_scanModeNames[i]) == 0) {
+			*pMode = (ScanMode)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ScanDecoderInit(ScanDecoder* pDecoder, ScanMode mode, const ScanProfile* pProfile) {
+	memset(pDecoder, 0, sizeof(ScanDecoder));
+	pDecoder->mode = mode;
+	if(pProfile)
+		pDecoder->profile = *pProfile;
+	else
+		ScanProfileSetDefault(&pDecoder->profile, "default");
+	ScanPyramidInit(&pDecoder->pyramid);
+	ScanTrackerInit(&pDecoder->tracker);
+
+	pDecoder->pScanner = zbar_image_scanner_create();
+	pDecoder->pImage = zbar_image_create();
+	if(pDecoder->pScanner == NULL || pDecoder->pImage == NULL)
+		return false;
+	ScanProfileApply(&pDecoder->profile, pDecoder->pScanner);
+	//Build the fourcc from its characters: reading "Y800" as an unsigned long reads past the string where long is 64 bits
+	zbar_image_set_format(pDecoder->pImage, (unsigned long)'Y' | ((unsigned long)'8' << 8) | ((unsigned long)'0' << 16) |
+		((unsigned long)'0' << 24));
+	return true;
+}
+
+void ScanDecoderRelease(ScanDecoder* pDecoder) {
+	if(pDecoder->pImage)
+		zbar_image_destroy(pDecoder->pImage);
+	if(pDecoder->pScanner)
+		zbar_image_scanner_destroy(pDecoder->pScanner);
+	ScanPyramidRelease(&pDecoder->pyramid);
+	ScanTrackerRelease(&pDecoder->tracker);
+	pDecoder->pImage = NULL;
+	pDecoder->pScanner = NULL;
+}
+
+int ScanDecoderScan(ScanDecoder* pDecoder, const uint8* pPixels, uint width, uint height) {
+	if(pDecoder->mode == SCAN_MODE_TRACKING) {
+		return ScanTrackerScan(&pDecoder->tracker, &pDecoder->pyramid, pDecoder->pScanner, pDecoder->pImage, pPixels, width,
+			height);
+	}
+	if(pDecoder->mode == SCAN_MODE_PYRAMID)
+		return ScanPyramidScan(&pDecoder->pyramid, pDecoder->pScanner, pDecoder->pImage, pPixels, width, height);
+
+	zbar_image_set_size(pDecoder->pImage, width, height);
+	zbar_image_set_data(pDecoder->pImage, pPixels, width * height, NULL);
+	return zbar_scan_image(pDecoder->pScanner, pDecoder->pImage);
+}
+
+void ScanDecoderSymbolPoint(const ScanDecoder* pDecoder, const zbar_symbol_t* pSymbol, uint i, int* pX, int* pY) {
+	uint hitX = 0, hitY = 0, hitShift = 0;
+	if(pDecoder->mode == SCAN_MODE_TRACKING) {
+		hitX = pDecoder->tracker.hitX;
+		hitY = pDecoder->tracker.hitY;
+		hitShift = pDecoder->tracker.hitShift;
+	}
+	else if(pDecoder->mode == SCAN_MODE_PYRAMID) {
+		hitX = pDecoder->pyramid.hitX;
+		hitY = pDecoder->pyramid.hitY;
+		hitShift = pDecoder->pyramid.hitShift;
+	}
+	*pX = zbar_symbol_get_loc_x(pSymbol, i) * (1 << hitShift) + (int)hitX;
+	*pY = zbar_symbol_get_loc_y(pSymbol, i) * (1 << hitShift) + (int)hitY;
+}
@@ -0,0 +1,95 @@
+#ifndef SCAN_PIPELINE_H
+#define SCAN_PIPELINE_H
+
+#include "FrameKernels.h"
+#include "ScanProfile.h"
+#include "ScanPyramid.h"
+#include "ScanTracker.h"
+
+//The camera frame to decoded symbol path with no Marmalade dependency, shared by the app and the host tools:
+// - PrepareCameraFrame crops, rotates and converts one raw camera frame into a preview and a Y800 scan image, and
+// - ScanDecoder owns the ZBar scanner and image and scans Y800 images.
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//CAMERA FRAMES
+
+enum FramePixelType {
+	FRAME_PIXEL_RGB565, //16 bit RGB565
+	FRAME_PIXEL_NV21, //8 bit luma plane followed by interleaved V/U at half resolution
+	FRAME_PIXEL_NV12 //Same as NV21 with U first
+};
+
+//One raw camera frame, as described by s3eCameraFrameData
+struct CameraFrame {
+	const void* pData;
+	uint width;
+	uint height;
+	uint pitch; //Row length in bytes (of the luma plane for YUV frames). Values below the width are treated as the width.
+	FrameRotation rotation;
+	FramePixelType pixelType;
+};
+
+//Square cut out of a camera frame
+struct FrameCrop {
+	uint x; //Top left corner in frame pixels
+	uint y;
+	uint dim; //Width and height
+};
+
+//Get the largest square centred in a width x height frame.
+void ComputeFrameCrop(uint width, uint height, FrameCrop* pCrop);
+
+//Cut pCrop out of pFrame. pPreview gets the RGB565 square rotated upright and shrunk to previewDim x previewDim
+//(previewDim <= crop.dim), pGray the full resolution crop.dim x crop.dim Y800 square for ZBar, both line by line.
+//Either may be NULL to skip it. With both and previewDim == crop.dim an RGB565 frame is read once for both and its Y800
+//square is rotated too; otherwise the Y800 square is not rotated (see CropY800).
+void PrepareCameraFrame(const CameraFrame* pFrame, const FrameCrop* pCrop, uint previewDim, uint16* pPreview, uint8* pGray);
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//DECODING
+
+enum ScanMode {
+	SCAN_MODE_FULL, //Scan every frame at full resolution only
+	SCAN_MODE_PYRAMID, //Try downscaled copies and a crop around the likely code before the full frame (see ScanPyramid)
+	SCAN_MODE_TRACKING //Scan around the codes found in the last frames, falling back to SCAN_MODE_PYRAMID (see ScanTracker)
+};
+
+//"full", "pyramid" or "tracking", as used by the tools' --mode option.
+const char* ScanModeName(ScanMode mode);
+
+//Parse a ScanModeName. Returns false if the name is unknown.
+bool ScanModeFromName(const char* pName, ScanMode* pMode);
+
+struct ScanDecoder {
+	zbar_image_scanner_t* pScanner;
+	zbar_image_t* pImage; //Holds the symbols of the last scan
+	ScanMode mode;
+	ScanProfile profile;
+	ScanPyramid pyramid; //Used in SCAN_MODE_PYRAMID and SCAN_MODE_TRACKING
+	ScanTracker tracker; //Used in SCAN_MODE_TRACKING
+};
+
+//Create the ZBar scanner and image and apply pProfile to the scanner, or the default profile (QR codes only) if it is
+//NULL. Returns false on failure, pDecoder must still be released.
+bool ScanDecoderInit(ScanDecoder* pDecoder, ScanMode mode, const ScanProfile* pProfile);
+
+void ScanDecoderRelease(ScanDecoder* pDecoder);
+
+//Scan a width x height Y800 image. Returns the number of symbols found, 0 if none and -1 on error.
+int ScanDecoderScan(ScanDecoder* pDecoder, const uint8* pPixels, uint width, uint height);
+
+//First symbol found by the last ScanDecoderScan, NULL if none. Walk the rest with zbar_symbol_next.
+inline const zbar_symbol_t* ScanDecoderFirstSymbol(const ScanDecoder* pDecoder) {
+	return zbar_image_first_symbol(pDecoder->pImage);
+}
+
+//Map point i of the location polygon of a symbol of the last scan to frame pixels. The pyramid and the tracker scan
+//downscaled copies and crops, so ZBar's own coordinates are only frame pixels in SCAN_MODE_FULL.
+void ScanDecoderSymbolPoint(const ScanDecoder* pDecoder, const zbar_symbol_t* pSymbol, uint i, int* pX, int* pY);
+
+//False for a symbol of the last scan that a verifying profile hasn't confirmed yet. Such symbols are not reported.
+inline bool ScanDecoderIsVerified(const ScanDecoder* pDecoder, const zbar_symbol_t* pSymbol) {
+	return !pDecoder->profile.verify || zbar_symbol_get_count(pSymbol) >= 0;
+}
+
+#endif
@@ -0,0 +1,138 @@
+#include "ScanProfile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct SymbologyName {
+	const char* pName;
+	zbar_symbol_type_t type;
+};
+
+static const SymbologyName g_symbologyNames[] = {
+	{ "ean8", ZBAR_EAN8 }, { "upce", ZBAR_UPCE }, { "isbn10", ZBAR_ISBN10 }, { "upca", ZBAR_UPCA }, { "ean13", ZBAR_EAN13 },
+	{ "isbn13", ZBAR_ISBN13 }, { "i25", ZBAR_I25 }, { "code39", ZBAR_CODE39 }, { "pdf417", ZBAR_PDF417 },
+	{ "qrcode", ZBAR_QRCODE }, { "code128", ZBAR_CODE128 }
+};
+#define SYMBOLOGY_NAME_COUNT (sizeof(g_symbologyNames) / sizeof(g_symbologyNames[0]))
+
+//Parse a whole decimal number. Returns false on anything else.
+static bool ParseInt(const char* pValue, int* pResult) {
+	char* pEnd;
+	const long value = strtol(pValue, &pEnd, 10);
+	if(pEnd == pValue || *pEnd != '\0')
+		return false;
+	*pResult = (int)value;
+	return true;
+}
+
+void ScanProfileSetDefault(ScanProfile* pProfile, const char* pName) {
+	memset(pProfile, 0, sizeof(ScanProfile));
+	snprintf(pProfile->name, sizeof(pProfile->name), "%s", pName);
+	pProfile->symbologies[0] = ZBAR_QRCODE;
+	pProfile->numSymbologies = 1;
+	pProfile->xDensity = 1;
+	pProfile->yDensity = 1;
+	pProfile->qualityGate = true;
+}
+
+bool ScanProfileSet(ScanProfile* pProfile, const char* pKey, const char* pValue) {
+	int value;
+	if(strcmp(pKey, "Symbologies") == 0) {
+		//Comma separated names, spaces around them are ignored
+		pProfile->numSymbologies = 0;
+		while(*pValue) {
+			while(*pValue == ' ' || *pValue == ',')
+				++pValue;
+			const char* pNameEnd = pValue;
+			while(*pNameEnd && *pNameEnd != ',' && *pNameEnd != ' ')
+				++pNameEnd;
+			if(pNameEnd == pValue)
+				break;
+			char name[16];
+			if((size_t)(pNameEnd - pValue) >= sizeof(name) || pProfile->numSymbologies == SCAN_PROFILE_MAX_SYMBOLOGIES)
+				return false;
+			memcpy(name, pValue, pNameEnd - pValue);
+			name[pNameEnd - pValue] = '\0';
+			const zbar_symbol_type_t type = ScanSymbologyFromName(name);
+			if(type == ZBAR_NONE)
+				return false;
+			pProfile->symbologies[pProfile->numSymbologies++] = type;
+			pValue = pNameEnd;
+		}
+		return pProfile->numSymbologies > 0;
+	}
+	if(strcmp(pKey, "XDensity") == 0 && ParseInt(pValue, &value) && value >= 0) {
+		pProfile->xDensity = value;
+		return true;
+	}
+	if(strcmp(pKey, "YDensity") == 0 && ParseInt(pValue, &value) && value >= 0) {
+		pProfile->yDensity = value;
+		return true;
+	}
+	if(strcmp(pKey, "Verify") == 0 && ParseInt(pValue, &value) && (value == 0 || value == 1)) {
+		pProfile->verify = value == 1;
+		return true;
+	}
+	if(strcmp(pKey, "Enhance") == 0)
+		return ScanEnhanceModeFromName(pValue, &pProfile->enhance);
+	if(strcmp(pKey, "QualityGate") == 0 && ParseInt(pValue, &value) && (value == 0 || value == 1)) {
+		pProfile->qualityGate = value == 1;
+		return true;
+	}
+	if(strcmp(pKey, "Denoise") == 0 && ParseInt(pValue, &value) && (value == 0 || value == 1)) {
+		pProfile->denoise = value == 1;
+		return true;
+	}
+	return false;
+}
+
+void ScanProfileApply(const ScanProfile* pProfile, zbar_image_scanner_t* pScanner) {
+	//ZBAR_NONE applies a setting to every symbology
+	zbar_image_scanner_set_config(pScanner, ZBAR_NONE, ZBAR_CFG_ENABLE, 0);
+	for(uint i = 0; i < pProfile->numSymbologies; ++i)
+		zbar_image_scanner_set_config(pScanner, pProfile->symbologies[i], ZBAR_CFG_ENABLE, 1);
+	zbar_image_scanner_set_config(pScanner, ZBAR_NONE, ZBAR_CFG_X_DENSITY, pProfile->xDensity);
+	zbar_image_scanner_set_config(pScanner, ZBAR_NONE, ZBAR_CFG_Y_DENSITY, pProfile->yDensity);
+	zbar_image_scanner_enable_cache(pScanner, pProfile->verify ? 1 : 0);
+}
+
+bool ScanProfileLoad(ScanProfile* pProfile, const char* pName, ScanConfigGetter getValue, void* pContext) {
+	static const char* keys[] = { "Symbologies", "XDensity", "YDensity", "Verify", "Enhance", "QualityGate", "Denoise" };
+	ScanProfileSetDefault(pProfile, pName);
+	char group[SCAN_PROFILE_NAME_SIZE + 16];
+	snprintf(group, sizeof(group), "ScanProfile_%s", pName);
+
+	char value[SCAN_CONFIG_VALUE_SIZE];
+	uint settings = 0;
+	for(uint i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
+		if(!getValue(pContext, group, keys[i], value))
+			continue;
+		if(!ScanProfileSet(pProfile, keys[i], value))
+			return false;
+		++settings;
+	}
+	return settings > 0;
+}
+
+zbar_symbol_type_t ScanSymbologyFromName(const char* pName) {
+	for(uint i = 0; i < SYMBOLOGY_NAME_COUNT; ++i) {
+		if(strcmp(pName, g_symbologyNames[i].pName) == 0)
+			return g_symbologyNames[i].type;
+	}
+	return ZBAR_NONE;
+}
+
+void ScanProfileFormat(const ScanProfile* pProfile, char* pText, uint textSize) {
+	char symbologies[SCAN_PROFILE_MAX_SYMBOLOGIES * 9] = "";
+	uint length = 0;
+	for(uint i = 0; i < pProfile->numSymbologies; ++i) {
+		for(uint j = 0; j < SYMBOLOGY_NAME_COUNT; ++j) {
+			if(g_symbologyNames[j].type == pProfile->symbologies[i])
+				length += snprintf(symbologies + length, sizeof(symbologies) - length, "%s%s", i ? "," : "", g_symbologyNames[j].pName);
+		}
+	}
+	snprintf(pText, textSize, "%s: %s, density %d x %d, verify %d, enhance %s, gate %d, denoise %d", pProfile->name,
+		symbologies, pProfile->xDensity, pProfile->yDensity, pProfile->verify ? 1 : 0, ScanEnhanceModeName(pProfile->enhance),
+		pProfile->qualityGate ? 1 : 0, pProfile->denoise ? 1 : 0);
+}
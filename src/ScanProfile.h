@@ -0,0 +1,59 @@
+#ifndef SCAN_PROFILE_H
+#define SCAN_PROFILE_H
+
+#include "ScanEnhance.h"
+#include "ScanTypes.h"
+#include "zbar.h"
+#ifdef SCAN_HOST_BUILD
+using namespace zbar; //The desktop zbar.h declares the C API inside namespace zbar when compiled as C++
+#endif
+
+//Named ZBar scanner settings. Every symbology enabled and every scan line added costs decode time on every frame, so a
+//deployment enables only the codes it needs at the lowest density that still decodes them. Profiles are read from
+//app.icf on the device (see data/app.config.txt) and from the same file by tools/scanreplay --profiles, which measures
+//each profile's cost and hit rate on a recording.
+
+#define SCAN_PROFILE_NAME_SIZE 32
+#define SCAN_PROFILE_MAX_SYMBOLOGIES 12
+#define SCAN_CONFIG_VALUE_SIZE 256 //S3E_CONFIG_STRING_MAX
+
+struct ScanProfile {
+	char name[SCAN_PROFILE_NAME_SIZE];
+	zbar_symbol_type_t symbologies[SCAN_PROFILE_MAX_SYMBOLOGIES];
+	uint numSymbologies;
+	int xDensity; //ZBAR_CFG_X_DENSITY: scan every xDensity-th column, 0 for no vertical scan lines
+	int yDensity; //ZBAR_CFG_Y_DENSITY: scan every yDensity-th row, 0 for no horizontal scan lines
+	bool verify; //Report a symbol only once ZBar's inter-frame cache has seen it in consecutive scans
+	ScanEnhanceMode enhance; //Clean up applied to frames before they are scanned. Applied by the caller, not the scanner.
+	bool qualityGate; //Skip blurred and badly exposed frames (see ScanQualityGate). Applied by the caller.
+	bool denoise; //Average consecutive frames before they are scanned (see ScanDenoiser). Applied by the caller.
+};
+
+//QR codes only at full density without verification, the settings the app always had, with the quality gate on.
+void ScanProfileSetDefault(ScanProfile* pProfile, const char* pName);
+
+//Set one setting from its app.icf key and text value: "Symbologies" (comma separated names, see
+//ScanSymbologyFromName), "XDensity", "YDensity", "Verify" (0 or 1), "Enhance" (see ScanEnhanceModeFromName) or
+//"QualityGate" (0 or 1) or "Denoise" (0 or 1).
+//Returns false if the key or value is unknown.
+bool ScanProfileSet(ScanProfile* pProfile, const char* pKey, const char* pValue);
+
+//Apply the profile to a scanner: every symbology is disabled, then the profile's are enabled with its densities, and
+//ZBar's result cache is turned on or off for verify.
+void ScanProfileApply(const ScanProfile* pProfile, zbar_image_scanner_t* pScanner);
+
+//Reads a setting: copies the value of pKey in [pGroup] into pValue (SCAN_CONFIG_VALUE_SIZE bytes) and returns true if
+//it is set. s3eConfigGetString on the device, an app.icf parser in the tools.
+typedef bool (*ScanConfigGetter)(void* pContext, const char* pGroup, const char* pKey, char* pValue);
+
+//Load the profile pName from the group [ScanProfile_<pName>]. Settings that aren't set keep their ScanProfileSetDefault
+//value. Returns false if the group sets nothing or has a bad value.
+bool ScanProfileLoad(ScanProfile* pProfile, const char* pName, ScanConfigGetter getValue, void* pContext);
+
+//Look up a symbology by its lower case name ("qrcode", "ean13", "code128", ...). Returns ZBAR_NONE if unknown.
+zbar_symbol_type_t ScanSymbologyFromName(const char* pName);
+
+//Write the profile's settings as one line of text, for traces and tool output.
+void ScanProfileFormat(const ScanProfile* pProfile, char* pText, uint textSize);
+
+#endif
@@ -0,0 +1,127 @@
+#include "ScanPyramid.h"
+#include "BufferPool.h"
+#include "FrameKernels.h"
+#include "ScanThread.h"
+
+#include <string.h>
+
+#define SCAN_PYRAMID_DEFAULT_MIN_DIMENSION 96 //Below this even a version 1 code would have less than 4 pixels per module
+
+//Run ZBar on one width x height image and record the attempt.
+static int ScanAttemptImage(ScanPyramid* pPyramid, ScanAttempt attempt, zbar_image_scanner_t* pScanner, zbar_image_t* pImage,
+	const uint8* pPixels, uint width, uint height) {
+	const uint64 startNs = ScanClockNs();
+	zbar_image_set_size(pImage, width, height);
+	zbar_image_set_data(pImage, pPixels, width * height, NULL);
+	const int numSymbols = zbar_scan_image(pScanner, pImage);
+
+	ScanAttemptStats* pStats = &pPyramid->stats[attempt];
+	++pStats->attempts;
+	pStats->totalNs += ScanClockNs() - startNs;
+	if(numSymbols > 0)
+		++pStats->decoded;
+	return numSymbols;
+}
+
+//Find the tile with the most edge energy (sum of absolute horizontal and vertical differences) in a width x height image.
+//QR codes are dense in edges, so that tile is the most likely place for a code ZBar missed at low resolution.
+static void FindCandidateTile(const uint8* pPixels, uint width, uint height, uint* pTileX, uint* pTileY) {
+	uint energy[SCAN_PYRAMID_TILES * SCAN_PYRAMID_TILES];
+	memset(energy, 0, sizeof(energy));
+	const uint tileW = width / SCAN_PYRAMID_TILES, tileH = height / SCAN_PYRAMID_TILES;
+
+	const uint8* row = pPixels;
+	for(uint y = 0; y + 1 < height; ++y, row += width) {
+		const uint ty = y / tileH < SCAN_PYRAMID_TILES ? y / tileH : SCAN_PYRAMID_TILES - 1;
+		uint* rowEnergy = energy + ty * SCAN_PYRAMID_TILES;
+		for(uint x = 0; x + 1 < width; ++x) {
+			const int dx = (int)row[x + 1] - row[x], dy = (int)row[x + width] - row[x];
+			const uint tx = x / tileW < SCAN_PYRAMID_TILES ? x / tileW : SCAN_PYRAMID_TILES - 1;
+			rowEnergy[tx] += (dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy);
+		}
+	}
+
+	uint best = 0;
+	for(uint i = 1; i < SCAN_PYRAMID_TILES * SCAN_PYRAMID_TILES; ++i) {
+		if(energy[i] > energy[best])
+			best = i;
+	}
+	*pTileX = best % SCAN_PYRAMID_TILES;
+	*pTileY = best / SCAN_PYRAMID_TILES;
+}
+
+void ScanPyramidInit(ScanPyramid* pPyramid) {
+	memset(pPyramid, 0, sizeof(ScanPyramid));
+	pPyramid->minDimension = SCAN_PYRAMID_DEFAULT_MIN_DIMENSION;
+}
+
+void ScanPyramidRelease(ScanPyramid* pPyramid) {
+	for(uint i = 0; i < SCAN_PYRAMID_LEVELS; ++i)
+		ScanFree(pPyramid->pLevels[i]);
+	ScanFree(pPyramid->pCrop);
+	const uint minDimension = pPyramid->minDimension;
+	ScanPyramidInit(pPyramid);
+	pPyramid->minDimension = minDimension;
+}
+
+int ScanPyramidScan(ScanPyramid* pPyramid, zbar_image_scanner_t* pScanner, zbar_image_t* pImage,
+	const uint8* pPixels, uint width, uint height) {
+	++pPyramid->frames;
+	const uint64 buildStartNs = ScanClockNs();
+
+	//Build the levels. Each one is downscaled from the level above it.
+	const uint8* levels[SCAN_PYRAMID_LEVELS] = { pPixels };
+	uint widths[SCAN_PYRAMID_LEVELS] = { width }, heights[SCAN_PYRAMID_LEVELS] = { height };
+	uint numLevels = 1;
+	for(; numLevels < SCAN_PYRAMID_LEVELS; ++numLevels) {
+		const uint w = widths[numLevels - 1] / 2, h = heights[numLevels - 1] / 2;
+		if(w < pPyramid->minDimension || h < pPyramid->minDimension)
+			break;
+		if(!ScanReserveBuffer(&pPyramid->pLevels[numLevels], &pPyramid->levelCapacity[numLevels], w * h))
+			return -1;
+		DownscaleY800By2(levels[numLevels - 1], widths[numLevels - 1], widths[numLevels - 1], heights[numLevels - 1],
+			pPyramid->pLevels[numLevels]);
+		levels[numLevels] = pPyramid->pLevels[numLevels];
+		widths[numLevels] = w;
+		heights[numLevels] = h;
+	}
+
+	//Look for the crop candidate before scanning, so its cost is part of buildNs rather than of an attempt.
+	const uint coarsest = numLevels - 1;
+	uint tileX = 0, tileY = 0;
+	if(numLevels > 1)
+		FindCandidateTile(levels[coarsest], widths[coarsest], heights[coarsest], &tileX, &tileY);
+	pPyramid->buildNs += ScanClockNs() - buildStartNs;
+
+	pPyramid->hitX = pPyramid->hitY = pPyramid->hitShift = 0;
+	int numSymbols = 0;
+	for(uint level = coarsest; level > 0; --level) {
+		numSymbols = ScanAttemptImage(pPyramid, (ScanAttempt)level, pScanner, pImage, levels[level], widths[level], heights[level]);
+		pPyramid->hitShift = level;
+		if(numSymbols != 0)
+			return numSymbols;
+	}
+
+	if(numLevels > 1) {
+		//Crop a square of half the frame size centred on the candidate tile, clamped to the frame
+		const uint dim = (width < height ? width : height) / 2;
+		if(!ScanReserveBuffer(&pPyramid->pCrop, &pPyramid->cropCapacity, dim * dim))
+			return -1;
+		const uint centreX = (2 * tileX + 1) * width / (2 * SCAN_PYRAMID_TILES);
+		const uint centreY = (2 * tileY + 1) * height / (2 * SCAN_PYRAMID_TILES);
+		uint cropX = centreX > dim / 2 ? centreX - dim / 2 : 0, cropY = centreY > dim / 2 ? centreY - dim / 2 : 0;
+		cropX = cropX + dim > width ? width - dim : cropX;
+		cropY = cropY + dim > height ? height - dim : cropY;
+		CropY800(pPixels, width, cropX, cropY, dim, pPyramid->pCrop);
+		numSymbols = ScanAttemptImage(pPyramid, SCAN_ATTEMPT_CROP, pScanner, pImage, pPyramid->pCrop, dim, dim);
+		pPyramid->hitShift = 0;
+		if(numSymbols != 0) {
+			pPyramid->hitX = cropX;
+			pPyramid->hitY = cropY;
+			return numSymbols;
+		}
+	}
+
+	pPyramid->hitShift = 0;
+	return ScanAttemptImage(pPyramid, SCAN_ATTEMPT_FULL, pScanner, pImage, pPixels, width, height);
+}
@@ -0,0 +1,60 @@
+#ifndef SCAN_PYRAMID_H
+#define SCAN_PYRAMID_H
+
+#include "ScanTypes.h"
+#include "zbar.h"
+#ifdef SCAN_HOST_BUILD
+using namespace zbar; //The desktop zbar.h declares the C API inside namespace zbar when compiled as C++
+#endif
+
+//Multi-scale scanning. ZBar's cost grows with the pixel count, while most codes fill enough of the frame to decode at
+//half or quarter resolution. A frame is scanned in this order, stopping at the first attempt that finds a symbol:
+// - every downscaled level from the coarsest up (2x2 box filter per level),
+// - a full resolution crop, half the frame size, around the tile with the most edge energy (the likely code), and
+// - the full frame.
+//Levels smaller than minDimension are not built. All state belongs to the thread that scans.
+
+#define SCAN_PYRAMID_LEVELS 3 //Full, half and quarter resolution
+#define SCAN_PYRAMID_TILES 8 //The candidate search splits the coarsest level into SCAN_PYRAMID_TILES x SCAN_PYRAMID_TILES tiles
+
+enum ScanAttempt {
+	SCAN_ATTEMPT_FULL = 0, //Values up to SCAN_PYRAMID_LEVELS - 1 are pyramid levels
+	SCAN_ATTEMPT_HALF = 1,
+	SCAN_ATTEMPT_QUARTER = 2,
+	SCAN_ATTEMPT_CROP = SCAN_PYRAMID_LEVELS,
+	SCAN_ATTEMPT_COUNT
+};
+
+struct ScanAttemptStats {
+	uint32 attempts; //zbar_scan_image calls
+	uint32 decoded; //Calls that found at least one symbol
+	uint64 totalNs; //Time spent in zbar_scan_image
+};
+
+struct ScanPyramid {
+	uint minDimension; //Smallest width or height a downscaled level may have
+
+	uint8* pLevels[SCAN_PYRAMID_LEVELS]; //pLevels[0] is unused, level 0 is the caller's frame
+	uint levelCapacity[SCAN_PYRAMID_LEVELS]; //Allocated size of pLevels in bytes
+	uint8* pCrop;
+	uint cropCapacity;
+
+	//Where the symbols of the last scan are in the frame: frame x = (symbol x << hitShift) + hitX, the same for y
+	uint hitX, hitY, hitShift;
+
+	ScanAttemptStats stats[SCAN_ATTEMPT_COUNT];
+	uint64 buildNs; //Time spent downscaling and searching for the candidate tile
+	uint32 frames; //Frames passed to ScanPyramidScan
+};
+
+void ScanPyramidInit(ScanPyramid* pPyramid);
+
+//Free the level and crop buffers.
+void ScanPyramidRelease(ScanPyramid* pPyramid);
+
+//Scan a width x height Y800 frame with the attempt order described above. Returns the result of the last
+//zbar_scan_image call; pImage then holds its symbols. Returns -1 if a buffer couldn't be allocated.
+int ScanPyramidScan(ScanPyramid* pPyramid, zbar_image_scanner_t* pScanner, zbar_image_t* pImage,
+	const uint8* pPixels, uint width, uint height);
+
+#endif
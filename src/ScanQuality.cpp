@@ -0,0 +1,75 @@
+#include "ScanQuality.h"
+
+#include <string.h>
+
+#define SCAN_GATE_DEFAULT_SHARPNESS_PERCENT 50
+#define SCAN_GATE_DEFAULT_MAX_CLIPPED_PERCENT 90
+#define SCAN_GATE_DEFAULT_MIN_CONTRAST 3 //Gray levels
+#define SCAN_GATE_DEFAULT_MAX_WAIT_NS 300000000ull //300 ms
+
+void ComputeFrameQuality(const uint8* pPixels, uint width, uint height, FrameQuality* pQuality) {
+	memset(pQuality, 0, sizeof(FrameQuality));
+	if(width < SCAN_QUALITY_GRID + 2 || height < SCAN_QUALITY_GRID + 2)
+		return;
+	//Grid points stay one pixel inside the frame so all 4 neighbours exist
+	const uint stepX = (width - 2) / SCAN_QUALITY_GRID, stepY = (height - 2) / SCAN_QUALITY_GRID;
+
+	uint8 samples[SCAN_QUALITY_GRID * SCAN_QUALITY_GRID];
+	uint sum = 0, laplacianSum = 0, dark = 0, bright = 0;
+	uint8* pSample = samples;
+	for(uint gy = 0; gy < SCAN_QUALITY_GRID; ++gy) {
+		const uint8* p = pPixels + (1 + gy * stepY + stepY / 2) * width + 1 + stepX / 2;
+		for(uint gx = 0; gx < SCAN_QUALITY_GRID; ++gx, p += stepX) {
+			const int center = *p;
+			const int laplacian = 4 * center - p[-1] - p[1] - p[-(int)width] - p[width];
+			laplacianSum += laplacian < 0 ? -laplacian : laplacian;
+			sum += center;
+			dark += center <= SCAN_QUALITY_DARK;
+			bright += center >= SCAN_QUALITY_BRIGHT;
+			*pSample++ = (uint8)center;
+		}
+	}
+
+	const uint count = SCAN_QUALITY_GRID * SCAN_QUALITY_GRID;
+	const int mean = (int)(sum / count);
+	uint deviationSum = 0;
+	for(uint i = 0; i < count; ++i) {
+		const int d = samples[i] - mean;
+		deviationSum += d < 0 ? -d : d;
+	}
+	const uint sharpness = 64 * laplacianSum / (deviationSum + count);
+	pQuality->valid = true;
+	pQuality->mean = (uint8)mean;
+	pQuality->contrast = (uint8)(deviationSum / count);
+	pQuality->darkPercent = (uint8)(100 * dark / count);
+	pQuality->brightPercent = (uint8)(100 * bright / count);
+	pQuality->sharpness = (uint16)(sharpness < 0xffff ? sharpness : 0xffff);
+}
+
+void ScanQualityGateInit(ScanQualityGate* pGate) {
+	memset(pGate, 0, sizeof(ScanQualityGate));
+	pGate->sharpnessPercent = SCAN_GATE_DEFAULT_SHARPNESS_PERCENT;
+	pGate->maxClippedPercent = SCAN_GATE_DEFAULT_MAX_CLIPPED_PERCENT;
+	pGate->minContrast = SCAN_GATE_DEFAULT_MIN_CONTRAST;
+	pGate->maxWaitNs = SCAN_GATE_DEFAULT_MAX_WAIT_NS;
+}
+
+ScanGateDecision ScanQualityGateCheck(ScanQualityGate* pGate, const FrameQuality* pQuality, uint64 nowNs) {
+	ScanGateDecision decision = SCAN_GATE_PASS;
+	if(pQuality->valid) {
+		//The peak decays so a scene that is less sharp as a whole (further away, out of focus range) lowers the bar
+		const uint decayedPeak = pGate->sharpnessPeak - pGate->sharpnessPeak / 16;
+		pGate->sharpnessPeak = pQuality->sharpness > decayedPeak ? pQuality->sharpness : decayedPeak;
+
+		if(pQuality->darkPercent >= pGate->maxClippedPercent || pQuality->brightPercent >= pGate->maxClippedPercent ||
+			pQuality->contrast < pGate->minContrast)
+			decision = SCAN_GATE_EXPOSURE;
+		else if(pQuality->sharpness * 100 < pGate->sharpnessPercent * pGate->sharpnessPeak)
+			decision = SCAN_GATE_BLURRED;
+		if(decision != SCAN_GATE_PASS && nowNs - pGate->lastPassNs >= pGate->maxWaitNs)
+			decision = SCAN_GATE_FORCED;
+	}
+	if(ScanGateScans(decision))
+		pGate->lastPassNs = nowNs;
+	return decision;
+}
@@ -0,0 +1,61 @@
+#ifndef SCAN_QUALITY_H
+#define SCAN_QUALITY_H
+
+#include "ScanTypes.h"
+
+//Frame quality gate: skips frames ZBar can't decode anyway, motion blurred while the user is aiming or badly over or
+//under exposed, so they don't each cost a full decode attempt.
+// - ComputeFrameQuality measures sharpness and exposure on a SCAN_QUALITY_GRID x SCAN_QUALITY_GRID grid of a Y800
+//   frame. The camera callback runs it right after converting the frame, while the frame is still in the cache.
+// - The scan worker's ScanQualityGate compares the sharpness with the decaying peak of recent frames, so the threshold
+//   follows the scene and the camera, and lets a frame through anyway once none has passed for maxWaitNs, so a scene
+//   that never looks sharp is still scanned.
+
+#define SCAN_QUALITY_GRID 32 //Grid points per side. Each reads the pixel and its 4 neighbours.
+#define SCAN_QUALITY_DARK 16 //Samples at or below this gray level count as clipped dark
+#define SCAN_QUALITY_BRIGHT 240 //Samples at or above this gray level count as clipped bright
+
+struct FrameQuality {
+	bool valid; //False if the frame is too small to measure. Such frames always pass the gate.
+	uint8 mean; //Mean gray level of the samples
+	uint8 contrast; //Mean absolute difference of the samples from their mean
+	uint8 darkPercent; //Samples clipped dark
+	uint8 brightPercent; //Samples clipped bright
+	uint16 sharpness; //64 * mean absolute Laplacian / (contrast + 1). Blur lowers it, lighting changes barely do.
+};
+
+//Measure a width x height Y800 frame. Costs about 5 * SCAN_QUALITY_GRID^2 pixel reads whatever the frame size.
+void ComputeFrameQuality(const uint8* pPixels, uint width, uint height, FrameQuality* pQuality);
+
+enum ScanGateDecision {
+	SCAN_GATE_PASS, //Sharp and well exposed: scanned
+	SCAN_GATE_FORCED, //Failed, but scanned because nothing passed for maxWaitNs
+	SCAN_GATE_BLURRED, //Skipped: sharpness under sharpnessPercent of the recent peak
+	SCAN_GATE_EXPOSURE, //Skipped: mostly clipped, or too flat to hold a code
+	SCAN_GATE_DECISION_COUNT
+};
+
+//Owned by the scan worker.
+struct ScanQualityGate {
+	//Settings
+	uint sharpnessPercent; //A frame is sharp enough at this percentage of sharpnessPeak
+	uint maxClippedPercent; //A frame with this many samples clipped dark or bright is badly exposed
+	uint minContrast; //A frame with less contrast is badly exposed (a covered lens or a blank wall)
+	uint64 maxWaitNs; //A failing frame is scanned anyway once this long has passed since the last one went through
+
+	//State
+	uint sharpnessPeak; //Maximum sharpness of recent frames, decaying by 1/16 per frame
+	uint64 lastPassNs; //Time the last frame went through
+};
+
+void ScanQualityGateInit(ScanQualityGate* pGate);
+
+//Decide whether a frame with pQuality, considered at nowNs, is worth scanning. Frames are scanned for SCAN_GATE_PASS
+//and SCAN_GATE_FORCED.
+ScanGateDecision ScanQualityGateCheck(ScanQualityGate* pGate, const FrameQuality* pQuality, uint64 nowNs);
+
+inline bool ScanGateScans(ScanGateDecision decision) {
+	return decision == SCAN_GATE_PASS || decision == SCAN_GATE_FORCED;
+}
+
+#endif
@@ -0,0 +1,119 @@
+#include "ScanResults.h"
+#include "BufferPool.h"
+#include "ScanThread.h"
+
+#include <string.h>
+
+#define SCAN_RESULT_PADDING 0xffffffffu //dataLength of the filler entry written when an entry doesn't fit before the wrap
+
+//Entry layout in the queue: this header, the payload and its nul, padded to SCAN_RESULT_ENTRY_ALIGNMENT.
+struct ScanResultEntry {
+	int32 type;
+	uint32 frameSequence;
+	uint32 dataLength;
+	uint32 size; //Bytes to the next entry
+};
+
+bool ScanResultQueueInit(ScanResultQueue* pQueue) {
+	memset(pQueue, 0, sizeof(ScanResultQueue));
+	pQueue->pBuffer = (uint8*)ScanAlloc(SCAN_RESULT_QUEUE_BYTES);
+	return pQueue->pBuffer != NULL;
+}
+
+void ScanResultQueueRelease(ScanResultQueue* pQueue) {
+	ScanFree(pQueue->pBuffer);
+	memset(pQueue, 0, sizeof(ScanResultQueue));
+}
+
+bool ScanResultQueuePush(ScanResultQueue* pQueue, zbar_symbol_type_t type, const char* pData, uint dataLength,
+	uint32 frameSequence) {
+	//Offsets only grow and are taken modulo the queue size, so head - tail is the number of bytes in use.
+	const uint32 size = (sizeof(ScanResultEntry) + dataLength + 1 + SCAN_RESULT_ENTRY_ALIGNMENT - 1) &
+		~(uint32)(SCAN_RESULT_ENTRY_ALIGNMENT - 1);
+	uint32 head = (uint32)pQueue->head;
+	const uint32 tail = (uint32)AtomicLoad(&pQueue->tail);
+	uint32 offset = head & (SCAN_RESULT_QUEUE_BYTES - 1);
+	const uint32 padding = offset + size > SCAN_RESULT_QUEUE_BYTES ? SCAN_RESULT_QUEUE_BYTES - offset : 0;
+	if(pQueue->pBuffer == NULL || size > SCAN_RESULT_QUEUE_BYTES || head - tail + padding + size > SCAN_RESULT_QUEUE_BYTES) {
+		AtomicAdd(&pQueue->dropped, 1);
+		return false;
+	}
+
+	//Entries are never split across the wrap: the rest of the buffer becomes a filler entry the consumer skips.
+	if(padding) {
+		ScanResultEntry* pFiller = (ScanResultEntry*)(pQueue->pBuffer + offset);
+		pFiller->dataLength = SCAN_RESULT_PADDING;
+		pFiller->size = padding;
+		head += padding;
+		offset = 0;
+	}
+
+	ScanResultEntry* pEntry = (ScanResultEntry*)(pQueue->pBuffer + offset);
+	pEntry->type = (int32)type;
+	pEntry->frameSequence = frameSequence;
+	pEntry->dataLength = dataLength;
+	pEntry->size = size;
+	char* pEntryData = (char*)(pEntry + 1);
+	memcpy(pEntryData, pData, dataLength);
+	pEntryData[dataLength] = '\0';
+	AtomicStore(&pQueue->head, (int32)(head + size)); //Publish the entry after it has been filled in
+	return true;
+}
+
+uint ScanResultQueuePoll(ScanResultQueue* pQueue, ScanResult* pResults, uint maxResults) {
+	uint32 position = (uint32)pQueue->tail;
+	const uint32 head = (uint32)AtomicLoad(&pQueue->head);
+	uint numResults = 0;
+	while(position != head && numResults < maxResults) {
+		const ScanResultEntry* pEntry = (const ScanResultEntry*)(pQueue->pBuffer + (position & (SCAN_RESULT_QUEUE_BYTES - 1)));
+		position += pEntry->size;
+		if(pEntry->dataLength == SCAN_RESULT_PADDING)
+			continue;
+		ScanResult* pResult = &pResults[numResults++];
+		pResult->type = (zbar_symbol_type_t)pEntry->type;
+		pResult->frameSequence = pEntry->frameSequence;
+		pResult->dataLength = pEntry->dataLength;
+		pResult->pData = (const char*)(pEntry + 1);
+	}
+	pQueue->readEnd = (int32)position;
+	return numResults;
+}
+
+void ScanResultQueueDone(ScanResultQueue* pQueue) {
+	AtomicStore(&pQueue->tail, pQueue->readEnd); //Hand the entries back to the producer
+}
+
+void ScanDedupInit(ScanDedupCache* pCache, uint ttlMs) {
+	memset(pCache, 0, sizeof(ScanDedupCache));
+	pCache->ttlNs = (uint64)ttlMs * 1000000;
+}
+
+bool ScanDedupIsRepeat(ScanDedupCache* pCache, zbar_symbol_type_t type, const char* pData, uint dataLength, uint64 nowNs) {
+	if(pCache->ttlNs == 0)
+		return false;
+
+	//64 bit FNV-1a of the type and the payload. With at most SCAN_DEDUP_ENTRIES payloads remembered a collision is not
+	//a practical concern.
+	uint64 hash = 14695981039346656037ull;
+	hash = (hash ^ (uint64)type) * 1099511628211ull;
+	for(uint i = 0; i < dataLength; ++i)
+		hash = (hash ^ (uint8)pData[i]) * 1099511628211ull;
+	if(hash == 0)
+		hash = 1;
+
+	//Look for the payload, and remember the entry seen longest ago in case it has to be added
+	ScanDedupEntry* pOldest = &pCache->entries[0];
+	for(uint i = 0; i < SCAN_DEDUP_ENTRIES; ++i) {
+		ScanDedupEntry* pEntry = &pCache->entries[i];
+		if(pEntry->hash == hash) {
+			const bool repeat = nowNs - pEntry->lastSeenNs < pCache->ttlNs;
+			pEntry->lastSeenNs = nowNs;
+			return repeat;
+		}
+		if(pEntry->hash == 0 || (pOldest->hash != 0 && pEntry->lastSeenNs < pOldest->lastSeenNs))
+			pOldest = pEntry;
+	}
+	pOldest->hash = hash;
+	pOldest->lastSeenNs = nowNs;
+	return false;
+}
@@ -0,0 +1,77 @@
+#ifndef SCAN_RESULTS_H
+#define SCAN_RESULTS_H
+
+#include "ScanTypes.h"
+#include "zbar.h"
+#ifdef SCAN_HOST_BUILD
+using namespace zbar; //The desktop zbar.h declares the C API inside namespace zbar when compiled as C++
+#endif
+
+//Handing decoded symbols from the scan worker to the main loop:
+// - a ScanResultQueue is a single producer single consumer ring of variable length entries in one fixed block, so a
+//   long payload costs its length rather than a worst case slot size and is never truncated, and
+// - a ScanDedupCache remembers recently reported payloads by hash, so in continuous scanning a code that stays in view
+//   is reported once instead of on every frame.
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//RESULT QUEUE
+
+#define SCAN_RESULT_QUEUE_BYTES 32768 //Power of two. Holds a few of the largest QR codes (7089 digits) or hundreds of short ones.
+#define SCAN_RESULT_ENTRY_ALIGNMENT 16 //Entry header size, so the padding before a wrap always fits a header
+
+//A queued symbol as seen by the consumer
+struct ScanResult {
+	zbar_symbol_type_t type;
+	uint32 frameSequence; //FrameSlot::sequence of the frame the symbol was found in
+	uint dataLength;
+	const char* pData; //dataLength bytes and a nul. Points into the queue and stays valid until ScanResultQueueDone.
+};
+
+struct ScanResultQueue {
+	uint8* pBuffer; //SCAN_RESULT_QUEUE_BYTES, NULL if the allocation failed
+	volatile int32 head; //Byte offset the producer writes the next entry at, modulo SCAN_RESULT_QUEUE_BYTES
+	volatile int32 tail; //Byte offset of the oldest entry not released by the consumer
+	int32 readEnd; //Consumer only: end of the entries returned by the last ScanResultQueuePoll
+	volatile int32 dropped; //Results lost because the queue was full
+};
+
+//Allocate the queue's buffer. Returns false if out of memory, pQueue must still be released.
+bool ScanResultQueueInit(ScanResultQueue* pQueue);
+
+void ScanResultQueueRelease(ScanResultQueue* pQueue);
+
+//Producer: copy a symbol into the queue. Returns false and counts it as dropped if there isn't enough room.
+bool ScanResultQueuePush(ScanResultQueue* pQueue, zbar_symbol_type_t type, const char* pData, uint dataLength,
+	uint32 frameSequence);
+
+//Consumer: fill pResults with up to maxResults of the oldest queued results and return how many. Their data stays in the
+//queue until ScanResultQueueDone; polling again before that returns the same entries.
+uint ScanResultQueuePoll(ScanResultQueue* pQueue, ScanResult* pResults, uint maxResults);
+
+//Consumer: hand the space of the entries returned by the last ScanResultQueuePoll back to the producer.
+void ScanResultQueueDone(ScanResultQueue* pQueue);
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//DEDUP CACHE
+
+#define SCAN_DEDUP_ENTRIES 64 //Distinct payloads remembered at once. The oldest is forgotten first.
+
+struct ScanDedupEntry {
+	uint64 hash; //FNV-1a of the symbol type and payload, 0 if the entry is empty
+	uint64 lastSeenNs;
+};
+
+//Not thread safe: owned by the scan worker.
+struct ScanDedupCache {
+	ScanDedupEntry entries[SCAN_DEDUP_ENTRIES];
+	uint64 ttlNs; //0 disables the cache: every sighting is new
+};
+
+void ScanDedupInit(ScanDedupCache* pCache, uint ttlMs);
+
+//Record a sighting at nowNs. Returns true if the same type and payload was already seen less than ttlNs ago. A repeat
+//refreshes the entry, so a code held in view stays suppressed and is reported again only ttlNs after it was last seen.
+//Payloads are compared by their 64 bit hash only.
+bool ScanDedupIsRepeat(ScanDedupCache* pCache, zbar_symbol_type_t type, const char* pData, uint dataLength, uint64 nowNs);
+
+#endif
@@ -0,0 +1,83 @@
+#include "ScanScheduler.h"
+
+#include <string.h>
+
+#define SCAN_DEFAULT_CHANGE_THRESHOLD 3 //Gray levels
+#define SCAN_DEFAULT_UNCHANGED_RESCAN_NS 500000000ull //500 ms
+
+void ScanSchedulerInit(ScanScheduler* pScheduler, float cpuBudget) {
+	memset(pScheduler, 0, sizeof(ScanScheduler));
+	pScheduler->cpuBudget = cpuBudget <= 0.0f ? 0.01f : (cpuBudget > 1.0f ? 1.0f : cpuBudget);
+	pScheduler->changeThreshold = SCAN_DEFAULT_CHANGE_THRESHOLD;
+	pScheduler->unchangedRescanNs = SCAN_DEFAULT_UNCHANGED_RESCAN_NS;
+}
+
+uint ScanSchedulerWaitMs(const ScanScheduler* pScheduler, uint64 nowNs) {
+	if(nowNs >= pScheduler->nextScanNs)
+		return 0;
+	return (uint)((pScheduler->nextScanNs - nowNs + 999999) / 1000000);
+}
+
+bool ScanSchedulerShouldScan(ScanScheduler* pScheduler, const uint8* pPixels, uint width, uint height, uint64 nowNs) {
+	++pScheduler->framesOffered;
+	ComputeFrameSignature(pPixels, width, height, pScheduler->signature);
+
+	if(pScheduler->haveFailedSignature && nowNs - pScheduler->lastScanNs < pScheduler->unchangedRescanNs) {
+		const uint difference = FrameSignatureDifference(pScheduler->signature, pScheduler->failedSignature);
+		if(difference < pScheduler->changeThreshold * SCAN_SIGNATURE_SIZE) {
+			++pScheduler->framesUnchanged;
+			return false;
+		}
+	}
+
+	pScheduler->lastScanNs = nowNs;
+	++pScheduler->framesScanned;
+	return true;
+}
+
+void ScanSchedulerScanDone(ScanScheduler* pScheduler, uint64 startNs, uint64 endNs, bool decoded) {
+	//Moving average over roughly the last 4 scans
+	const uint64 costNs = endNs - startNs;
+	pScheduler->decodeCostNs = pScheduler->decodeCostNs ? (pScheduler->decodeCostNs * 3 + costNs) / 4 : costNs;
+
+	//Spend cpuBudget of the time decoding: a scan costing C is followed by C * (1 - budget) / budget of idle time.
+	const float idleRatio = (1.0f - pScheduler->cpuBudget) / pScheduler->cpuBudget;
+	pScheduler->nextScanNs = endNs + (uint64)((float)pScheduler->decodeCostNs * idleRatio);
+
+	if(decoded) {
+		++pScheduler->scansDecoded;
+		pScheduler->haveFailedSignature = false;
+	}
+	else {
+		memcpy(pScheduler->failedSignature, pScheduler->signature, SCAN_SIGNATURE_SIZE);
+		pScheduler->haveFailedSignature = true;
+	}
+}
+
+void ComputeFrameSignature(const uint8* pPixels, uint width, uint height, uint8* pSignature) {
+	//Each cell is the average of 4 pixels spread over it. That is enough to notice the camera or the code moving and
+	//costs 1024 reads whatever the frame size.
+	const uint cellW = width / SCAN_SIGNATURE_CELLS, cellH = height / SCAN_SIGNATURE_CELLS;
+	if(cellW < 2 || cellH < 2) {
+		memset(pSignature, 0, SCAN_SIGNATURE_SIZE);
+		return;
+	}
+
+	for(uint cy = 0; cy < SCAN_SIGNATURE_CELLS; ++cy) {
+		const uint8* row0 = pPixels + (cy * cellH + cellH / 4) * width;
+		const uint8* row1 = pPixels + (cy * cellH + (cellH * 3) / 4) * width;
+		for(uint cx = 0; cx < SCAN_SIGNATURE_CELLS; ++cx) {
+			const uint x0 = cx * cellW + cellW / 4, x1 = cx * cellW + (cellW * 3) / 4;
+			*pSignature++ = (uint8)((row0[x0] + row0[x1] + row1[x0] + row1[x1] + 2) >> 2);
+		}
+	}
+}
+
+uint FrameSignatureDifference(const uint8* pSignatureA, const uint8* pSignatureB) {
+	uint difference = 0;
+	for(uint i = 0; i < SCAN_SIGNATURE_SIZE; ++i) {
+		const int d = (int)pSignatureA[i] - (int)pSignatureB[i];
+		difference += d < 0 ? -d : d;
+	}
+	return difference;
+}
@@ -0,0 +1,53 @@
+#ifndef SCAN_SCHEDULER_H
+#define SCAN_SCHEDULER_H
+
+#include "ScanTypes.h"
+
+//Decides when the scan worker scans. Every new frame is scanned as soon as the decoder is free, except that:
+// - the time spent decoding is kept under cpuBudget of one core, using the measured decode cost, and
+// - a frame whose signature barely differs from the last frame that failed to decode is skipped, because ZBar would
+//   fail on it again. Unchanged frames are still rescanned every unchangedRescanNs in case the difference was subtle.
+//All state belongs to the thread that scans.
+
+#define SCAN_SIGNATURE_CELLS 16 //The signature is a SCAN_SIGNATURE_CELLS x SCAN_SIGNATURE_CELLS grid of average luma
+#define SCAN_SIGNATURE_SIZE (SCAN_SIGNATURE_CELLS * SCAN_SIGNATURE_CELLS)
+
+struct ScanScheduler {
+	//Settings
+	float cpuBudget; //Fraction of one core the decoder may use, (0, 1]. 1 scans back to back.
+	uint changeThreshold; //Mean absolute signature difference (gray levels) below which a frame counts as unchanged
+	uint64 unchangedRescanNs; //An unchanged frame is scanned anyway once this long has passed since the last scan
+
+	//State
+	uint64 decodeCostNs; //Moving average of the time one scan takes
+	uint64 nextScanNs; //Earliest time the CPU budget allows the next scan to start
+	uint64 lastScanNs; //Start time of the last scan
+	bool haveFailedSignature;
+	uint8 failedSignature[SCAN_SIGNATURE_SIZE]; //Signature of the last scanned frame that didn't decode
+	uint8 signature[SCAN_SIGNATURE_SIZE]; //Signature of the frame being considered
+
+	//Counters
+	uint32 framesOffered; //Frames passed to ScanSchedulerShouldScan
+	uint32 framesScanned;
+	uint32 framesUnchanged; //Frames skipped by the signature check
+	uint32 scansDecoded; //Scans that found at least one symbol
+};
+
+void ScanSchedulerInit(ScanScheduler* pScheduler, float cpuBudget);
+
+//Milliseconds to wait before the CPU budget allows another scan. 0 means a scan may start now.
+uint ScanSchedulerWaitMs(const ScanScheduler* pScheduler, uint64 nowNs);
+
+//Returns true if the width x height Y800 frame should be scanned, false if it is unchanged since the last failed scan.
+bool ScanSchedulerShouldScan(ScanScheduler* pScheduler, const uint8* pPixels, uint width, uint height, uint64 nowNs);
+
+//Record the outcome of a scan that ScanSchedulerShouldScan allowed.
+void ScanSchedulerScanDone(ScanScheduler* pScheduler, uint64 startNs, uint64 endNs, bool decoded);
+
+//Write the SCAN_SIGNATURE_SIZE byte signature of a width x height Y800 frame to pSignature.
+void ComputeFrameSignature(const uint8* pPixels, uint width, uint height, uint8* pSignature);
+
+//Sum of the absolute differences between two signatures. Divide by SCAN_SIGNATURE_SIZE for the mean in gray levels.
+uint FrameSignatureDifference(const uint8* pSignatureA, const uint8* pSignatureB);
+
+#endif
@@ -0,0 +1,117 @@
+#include "ScanService.h"
+
+#include <string.h>
+
+//Claim the pending stream whose frame has waited longest, so a stream that keeps publishing can't starve the others.
+//Returns the stream's index, or -1 if no stream is both pending and free.
+static int TakeStream(ScanService* pService) {
+	const uint start = (uint)AtomicAdd(&pService->nextStream, 1) % pService->numStreams;
+	const int32 nowMs = (int32)(ScanClockNs() / 1000000);
+	for(;;) {
+		int oldest = -1;
+		int32 oldestAgeMs = -1;
+		for(uint i = 0; i < pService->numStreams; ++i) {
+			const uint index = (start + i) % pService->numStreams;
+			ScanStream* pStream = &pService->streams[index];
+			if(!AtomicLoad(&pStream->pending) || AtomicLoad(&pStream->busy))
+				continue;
+			//Compared as an age so the ms clock wrapping around doesn't matter
+			const int32 ageMs = nowMs - AtomicLoad(&pStream->publishedMs);
+			if(ageMs > oldestAgeMs) {
+				oldest = (int)index;
+				oldestAgeMs = ageMs;
+			}
+		}
+		if(oldest < 0)
+			return -1;
+		ScanStream* pStream = &pService->streams[oldest];
+		if(AtomicExchange(&pStream->busy, 1) == 0) {
+			AtomicStore(&pStream->pending, 0); //Frames published from here on make the stream pending again
+			return oldest;
+		}
+		//Another worker got there first, look again
+	}
+}
+
+//Worker thread: sleep until a frame is published, then scan streams until none has a frame waiting.
+static void* ServiceWorker(void* pArg) {
+	ScanService* pService = (ScanService*)pArg;
+	for(;;) {
+		ScanSemaphoreWait(pService->pWakeUp);
+		if(AtomicLoad(&pService->quit))
+			return NULL;
+		int stream;
+		while((stream = TakeStream(pService)) >= 0) {
+			ScanEngineScanNewest(pService->streams[stream].pEngine);
+			AtomicStore(&pService->streams[stream].busy, 0);
+		}
+	}
+}
+
+ScanService* ScanServiceCreate(uint numStreams, uint numWorkers, ScanMode mode, const ScanProfile* pProfile,
+	uint dedupTtlMs, uint maxFrameAgeMs) {
+	if(numStreams == 0 || numStreams > SCAN_SERVICE_MAX_STREAMS || !ScanThreadsAvailable())
+		return NULL;
+	if(numWorkers == 0)
+		numWorkers = 1;
+	if(numWorkers > SCAN_SERVICE_MAX_WORKERS)
+		numWorkers = SCAN_SERVICE_MAX_WORKERS;
+
+	ScanService* pService = new ScanService;
+	memset(pService, 0, sizeof(ScanService));
+	for(uint i = 0; i < numStreams; ++i) {
+		//Every stream gets a whole worker's worth of budget, the pool size is what bounds the CPU spent
+		ScanEngine* pEngine = ScanEngineCreateDriven(1.0f, mode, pProfile, dedupTtlMs);
+		if(pEngine == NULL) {
+			ScanServiceDestroy(pService);
+			return NULL;
+		}
+		pEngine->maxFrameAgeNs = (uint64)maxFrameAgeMs * 1000000;
+		pService->streams[i].pEngine = pEngine;
+		pService->numStreams = i + 1;
+	}
+	pService->pWakeUp = ScanSemaphoreCreate(0);
+	if(pService->pWakeUp == NULL) {
+		ScanServiceDestroy(pService);
+		return NULL;
+	}
+	for(uint i = 0; i < numWorkers; ++i) {
+		pService->pWorkers[i] = ScanThreadCreate(ServiceWorker, pService);
+		if(pService->pWorkers[i] == NULL)
+			break;
+		pService->numWorkers = i + 1;
+	}
+	if(pService->numWorkers == 0) {
+		ScanServiceDestroy(pService);
+		return NULL;
+	}
+	return pService;
+}
+
+void ScanServiceDestroy(ScanService* pService) {
+	if(pService == NULL)
+		return;
+
+	AtomicStore(&pService->quit, 1);
+	for(uint i = 0; i < pService->numWorkers; ++i)
+		ScanSemaphorePost(pService->pWakeUp);
+	for(uint i = 0; i < pService->numWorkers; ++i)
+		ScanThreadJoin(pService->pWorkers[i]);
+	ScanSemaphoreDestroy(pService->pWakeUp);
+
+	for(uint i = 0; i < pService->numStreams; ++i)
+		ScanEngineDestroy(pService->streams[i].pEngine);
+	delete pService;
+}
+
+void ScanServicePublishFrame(ScanService* pService, uint stream, uint64 timestamp) {
+	ScanStream* pStream = &pService->streams[stream];
+	ScanEnginePublishFrame(pStream->pEngine, timestamp);
+	//Only the first frame since the stream was last taken sets the time, later ones replace it in the ring but don't
+	//make the stream look newer than it is
+	if(!AtomicLoad(&pStream->pending)) {
+		AtomicStore(&pStream->publishedMs, (int32)(timestamp / 1000000));
+		AtomicStore(&pStream->pending, 1);
+	}
+	ScanSemaphorePost(pService->pWakeUp);
+}
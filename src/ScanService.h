@@ -0,0 +1,58 @@
+#ifndef SCAN_SERVICE_H
+#define SCAN_SERVICE_H
+
+#include "ScanEngine.h"
+
+//Scans several camera streams on one shared pool of worker threads, for fixed installations (e.g. cameras over a
+//conveyor) on a multi-core box. Every stream is a driven ScanEngine with its own frame ring, decoder, scheduler, result
+//queue and stats, so streams share nothing but the workers.
+//A worker that wakes up takes the stream whose pending frame was published longest ago (earliest deadline first), scans
+//that stream's newest frame and looks again, so:
+// - each stream is scanned newest frame first, frames overwritten in its ring are counted as dropped,
+// - a frame older than the stream's maxFrameAgeNs when a worker gets to it is dropped as stale,
+// - no stream waits behind another stream's backlog, and a stream is scanned by one worker at a time.
+
+#define SCAN_SERVICE_MAX_STREAMS 32
+#define SCAN_SERVICE_MAX_WORKERS 64
+
+struct ScanStream {
+	ScanEngine* pEngine; //Driven engine. Its frames are written and published through ScanService* calls.
+	volatile int32 busy; //1 while a worker scans the stream
+	volatile int32 pending; //1 when a frame was published since a worker last took the stream
+	volatile int32 publishedMs; //Low 32 bits of the ScanClockNs() time in ms of the oldest pending frame
+};
+
+struct ScanService {
+	ScanStream streams[SCAN_SERVICE_MAX_STREAMS];
+	uint numStreams;
+	ScanThread* pWorkers[SCAN_SERVICE_MAX_WORKERS];
+	uint numWorkers;
+	ScanSemaphore* pWakeUp; //Posted once per published frame
+	volatile int32 quit;
+	volatile int32 nextStream; //Where the next search for a stream starts, so ties are broken in turn
+};
+
+//Create numStreams driven engines with the given settings and start numWorkers workers (at least 1, at most
+//SCAN_SERVICE_MAX_WORKERS). A frame is dropped as stale once it is maxFrameAgeMs old, 0 scans every frame the ring
+//keeps. Returns NULL on failure or if the platform has no threads.
+ScanService* ScanServiceCreate(uint numStreams, uint numWorkers, ScanMode mode, const ScanProfile* pProfile,
+	uint dedupTtlMs, uint maxFrameAgeMs);
+
+//Stop the workers and destroy the streams' engines.
+void ScanServiceDestroy(ScanService* pService);
+
+//Producer of a stream: get a width x height Y800 buffer to write its next frame into. Every stream may have its own
+//producer thread, or one thread may feed several. Returns NULL if out of memory.
+inline FrameSlot* ScanServiceBeginFrame(ScanService* pService, uint stream, uint width, uint height) {
+	return ScanEngineBeginFrame(pService->streams[stream].pEngine, width, height);
+}
+
+//Producer of a stream: publish the frame written into the slot from ScanServiceBeginFrame and wake up a worker.
+//timestamp is the ScanClockNs() time the frame was captured.
+void ScanServicePublishFrame(ScanService* pService, uint stream, uint64 timestamp);
+
+inline ScanEngine* ScanServiceEngine(ScanService* pService, uint stream) {
+	return pService->streams[stream].pEngine;
+}
+
+#endif
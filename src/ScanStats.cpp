@@ -0,0 +1,109 @@
+#include "ScanStats.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+void ScanStatsReset(ScanStats* pStats) {
+	memset(pStats, 0, sizeof(ScanStats));
+}
+
+void LatencyHistogramAdd(LatencyHistogram* pHistogram, uint64 ns) {
+	uint32 us = (uint32)(ns / 1000 < 0xffffffffull ? ns / 1000 : 0xffffffffull);
+	uint bucket = 0;
+	for(; us > 1 && bucket < LATENCY_BUCKETS - 1; us >>= 1)
+		++bucket;
+	++pHistogram->buckets[bucket];
+	++pHistogram->count;
+	pHistogram->totalNs += ns;
+	if(ns > pHistogram->maxNs)
+		pHistogram->maxNs = ns;
+}
+
+uint64 LatencyHistogramPercentileNs(const LatencyHistogram* pHistogram, uint percent) {
+	if(pHistogram->count == 0)
+		return 0;
+	const uint64 rank = ((uint64)pHistogram->count * percent + 99) / 100; //Number of times at or below the percentile
+	uint64 seen = 0;
+	for(uint i = 0; i < LATENCY_BUCKETS - 1; ++i) {
+		seen += pHistogram->buckets[i];
+		if(seen >= rank && seen > 0)
+			return (2000ull << i) < pHistogram->maxNs ? (2000ull << i) : pHistogram->maxNs;
+	}
+	return pHistogram->maxNs;
+}
+
+//Append a printf formatted line to pText, truncating it if it doesn't fit.
+static void AppendLine(char* pText, uint textSize, uint* pLength, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	const int written = vsnprintf(pText + *pLength, textSize - *pLength, format, args);
+	va_end(args);
+	if(written > 0)
+		*pLength = *pLength + written < textSize ? *pLength + written : textSize - 1;
+}
+
+void StartupTimesInit(StartupTimes* pTimes, uint64 startNs) {
+	memset(pTimes, 0, sizeof(StartupTimes));
+	pTimes->startNs = startNs;
+}
+
+bool StartupTimesMark(StartupTimes* pTimes, StartupPhase phase, uint64 nowNs) {
+	if(pTimes->phaseNs[phase])
+		return false;
+	pTimes->phaseNs[phase] = nowNs ? nowNs : 1;
+	return true;
+}
+
+void StartupTimesFormat(const StartupTimes* pTimes, char* pText, uint textSize) {
+	static const char* phaseNames[STARTUP_PHASE_COUNT] = { "ui", "camera", "scanner", "1st render", "1st frame", "1st preview" };
+	if(textSize == 0)
+		return;
+	pText[0] = '\0';
+	uint length = 0;
+	AppendLine(pText, textSize, &length, "startup ms:");
+	for(uint i = 0; i < STARTUP_PHASE_COUNT; ++i) {
+		if(pTimes->phaseNs[i] == 0)
+			continue;
+		const uint64 ns = pTimes->phaseNs[i] > pTimes->startNs ? pTimes->phaseNs[i] - pTimes->startNs : 0;
+		AppendLine(pText, textSize, &length, " %s %u", phaseNames[i], (uint)(ns / 1000000));
+	}
+}
+
+uint ScanStatsFormat(const ScanStats* pStats, char* pText, uint textSize) {
+	static const char* stageNames[SCAN_STAGE_COUNT] = { "prepare", "upload", "denoise", "enhance", "decode", "extract",
+		"latency", "1st decode" };
+	if(textSize == 0)
+		return 0;
+	pText[0] = '\0';
+	uint length = 0, lines = 4;
+	AppendLine(pText, textSize, &length, "frames %u in, %u queued, %u drop\n", pStats->framesReceived, pStats->framesPublished,
+		pStats->framesDropped);
+	AppendLine(pText, textSize, &length, "preview %u uploaded, %u same\n", pStats->previewsUploaded, pStats->previewsSkipped);
+	AppendLine(pText, textSize, &length, "scans %u, %u unchanged, %u stale, %u hit\n", pStats->framesScanned,
+		pStats->framesUnchanged, pStats->framesStale, pStats->framesDecoded);
+	AppendLine(pText, textSize, &length, "results %u new, %u repeat\n", pStats->resultsQueued, pStats->resultsRepeated);
+	const uint32* pGate = pStats->gateDecisions;
+	if(pGate[SCAN_GATE_PASS] + pGate[SCAN_GATE_FORCED] + pGate[SCAN_GATE_BLURRED] + pGate[SCAN_GATE_EXPOSURE]) {
+		AppendLine(pText, textSize, &length, "gate %u pass, %u forced, %u blur, %u exposure\n", pGate[SCAN_GATE_PASS],
+			pGate[SCAN_GATE_FORCED], pGate[SCAN_GATE_BLURRED], pGate[SCAN_GATE_EXPOSURE]);
+		++lines;
+	}
+	for(uint i = 0; i < SCAN_ENHANCE_COUNT; ++i) { //Hit rate of each enhancement mode used, to compare them
+		if(pStats->enhanceScans[i] == 0)
+			continue;
+		AppendLine(pText, textSize, &length, "%-9s %u scans, %u%% hit\n", ScanEnhanceModeName((ScanEnhanceMode)i),
+			pStats->enhanceScans[i], 100 * pStats->enhanceDecoded[i] / pStats->enhanceScans[i]);
+		++lines;
+	}
+	for(uint i = 0; i < SCAN_STAGE_COUNT; ++i) {
+		const LatencyHistogram* pHistogram = &pStats->stages[i];
+		if(pHistogram->count == 0)
+			continue;
+		AppendLine(pText, textSize, &length, "%-10s %7u p95 %7u max %7u us\n", stageNames[i],
+			(uint)(pHistogram->totalNs / pHistogram->count / 1000), (uint)(LatencyHistogramPercentileNs(pHistogram, 95) / 1000),
+			(uint)(pHistogram->maxNs / 1000));
+		++lines;
+	}
+	return lines;
+}
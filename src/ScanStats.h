@@ -0,0 +1,99 @@
+#ifndef SCAN_STATS_H
+#define SCAN_STATS_H
+
+#include "ScanEnhance.h"
+#include "ScanQuality.h"
+#include "ScanTypes.h"
+
+//Timing probes and counters for the camera to decode path. Stage times go into fixed size log2 histograms, so recording
+//is a few adds and never allocates. Every stage and counter has a single writer thread (the camera callback or the scan
+//worker). Readers (overlay, trace) may see a slightly stale or torn snapshot, which is fine for statistics.
+
+#define LATENCY_BUCKETS 24 //Bucket i counts times in [2^i, 2^(i+1)) microseconds, the last one everything above 2^23 us
+
+struct LatencyHistogram {
+	uint32 buckets[LATENCY_BUCKETS];
+	uint32 count;
+	uint64 totalNs;
+	uint64 maxNs;
+};
+
+enum ScanStage {
+	SCAN_STAGE_PREPARE, //Crop, rotate and grayscale conversion of a camera frame (PrepareCameraFrame)
+	SCAN_STAGE_UPLOAD, //Preview texture ChangeTexels and Upload
+	SCAN_STAGE_DENOISE, //Temporal averaging of a frame the worker took from the ring (ScanDenoise)
+	SCAN_STAGE_ENHANCE, //Contrast stretch or adaptive threshold of a frame before it is scanned (ScanEnhance)
+	SCAN_STAGE_DECODE, //ZBar scan of a frame, all pyramid attempts included (ScanDecoderScan)
+	SCAN_STAGE_EXTRACT, //Copying the symbols found into the result queue
+	SCAN_STAGE_LATENCY, //End to end: from a frame's capture timestamp to the end of its scan
+	SCAN_STAGE_FIRST_DECODE, //Time from scanning (re)starting to the first QR code shown
+	SCAN_STAGE_COUNT
+};
+
+struct ScanStats {
+	LatencyHistogram stages[SCAN_STAGE_COUNT];
+
+	//Camera callback
+	uint32 framesReceived; //Camera frames delivered to the app
+	uint32 framesPublished; //Frames handed to the scan worker
+	uint32 framesDropped; //Published frames overwritten before the worker looked at them
+	uint32 previewsUploaded;
+	uint32 previewsSkipped; //Preview uploads skipped because the last frame looked the same as the last upload
+
+	//Scan worker
+	uint32 framesScanned;
+	uint32 framesUnchanged; //Frames skipped by the scheduler because they matched the last failed one
+	uint32 framesStale; //Frames dropped because they were older than the engine's maxFrameAgeNs when the worker got to them
+	uint32 framesDecoded; //Scans that found at least one symbol
+	uint32 resultsQueued; //Symbols handed to the main loop
+	uint32 resultsRepeated; //Symbols not queued because the dedup cache had seen them recently
+	uint32 enhanceScans[SCAN_ENHANCE_COUNT]; //framesScanned split by the ScanEnhanceMode the frame was scanned with
+	uint32 enhanceDecoded[SCAN_ENHANCE_COUNT]; //framesDecoded split the same way
+	uint32 gateDecisions[SCAN_GATE_DECISION_COUNT]; //Quality gate decisions, counted while the gate is on
+};
+
+void ScanStatsReset(ScanStats* pStats);
+
+void LatencyHistogramAdd(LatencyHistogram* pHistogram, uint64 ns);
+
+//Upper bound of the bucket that holds the given percentile (0-100) of the recorded times. 0 if nothing was recorded.
+uint64 LatencyHistogramPercentileNs(const LatencyHistogram* pHistogram, uint percent);
+
+inline void ScanStatsAddStage(ScanStats* pStats, ScanStage stage, uint64 ns) {
+	LatencyHistogramAdd(&pStats->stages[stage], ns);
+}
+
+//Write a short human readable summary, one stat per line (stage times as mean, 95th percentile and max), for the overlay
+//and trace dumps. Returns the number of lines.
+uint ScanStatsFormat(const ScanStats* pStats, char* pText, uint textSize);
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//STARTUP
+
+//Milestones of app startup, in the order they are usually reached. Camera start and scanner creation run while the UI
+//is built and first drawn, so the phases overlap and only their times from the start of main() are comparable.
+enum StartupPhase {
+	STARTUP_UI_BUILT, //Native UI elements created and the window shown
+	STARTUP_CAMERA_STARTED, //s3eCameraStart returned
+	STARTUP_SCANNER_READY, //ZBar scanner and scan worker created (ScanEngineCreate returned)
+	STARTUP_FIRST_RENDER, //First pApp->Update() returned: the UI is laid out, its fonts loaded and drawn
+	STARTUP_FIRST_FRAME, //First camera frame received
+	STARTUP_FIRST_PREVIEW, //First frame with the camera preview on screen
+	STARTUP_PHASE_COUNT
+};
+
+//Written by the main thread only.
+struct StartupTimes {
+	uint64 startNs; //ScanClockNs() time main() started
+	uint64 phaseNs[STARTUP_PHASE_COUNT]; //ScanClockNs() time each phase was first reached, 0 until then
+};
+
+void StartupTimesInit(StartupTimes* pTimes, uint64 startNs);
+
+//Record that phase was reached at nowNs. Only the first time counts. Returns true if this was the first time.
+bool StartupTimesMark(StartupTimes* pTimes, StartupPhase phase, uint64 nowNs);
+
+//Write one line with the milliseconds from the start to every phase reached so far.
+void StartupTimesFormat(const StartupTimes* pTimes, char* pText, uint textSize);
+
+#endif
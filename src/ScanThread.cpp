@@ -0,0 +1,130 @@
+#include "ScanThread.h"
+
+#ifdef SCAN_HOST_BUILD
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+
+//POSIX implementation for host builds. ScanThread and ScanSemaphore are defined here around the pthread types.
+
+struct ScanThread {
+	pthread_t thread;
+};
+
+struct ScanSemaphore {
+	sem_t sem;
+};
+
+bool ScanThreadsAvailable() {
+	return true;
+}
+
+ScanThread* ScanThreadCreate(ScanThreadFunc func, void* pArg) {
+	ScanThread* pThread = new ScanThread;
+	if(pthread_create(&pThread->thread, NULL, func, pArg) != 0) {
+		delete pThread;
+		return NULL;
+	}
+	return pThread;
+}
+
+void ScanThreadJoin(ScanThread* pThread) {
+	if(pThread) {
+		pthread_join(pThread->thread, NULL);
+		delete pThread;
+	}
+}
+
+ScanSemaphore* ScanSemaphoreCreate(uint initialCount) {
+	ScanSemaphore* pSemaphore = new ScanSemaphore;
+	if(sem_init(&pSemaphore->sem, 0, initialCount) != 0) {
+		delete pSemaphore;
+		return NULL;
+	}
+	return pSemaphore;
+}
+
+void ScanSemaphoreDestroy(ScanSemaphore* pSemaphore) {
+	if(pSemaphore) {
+		sem_destroy(&pSemaphore->sem);
+		delete pSemaphore;
+	}
+}
+
+void ScanSemaphoreWait(ScanSemaphore* pSemaphore) {
+	while(sem_wait(&pSemaphore->sem) != 0 && errno == EINTR) {}
+}
+
+void ScanSemaphorePost(ScanSemaphore* pSemaphore) {
+	sem_post(&pSemaphore->sem);
+}
+
+bool ScanSemaphoreTimedWait(ScanSemaphore* pSemaphore, uint timeoutMs) {
+	//sem_timedwait takes an absolute CLOCK_REALTIME deadline
+	timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += timeoutMs / 1000;
+	deadline.tv_nsec += (long)(timeoutMs % 1000) * 1000000;
+	if(deadline.tv_nsec >= 1000000000) {
+		++deadline.tv_sec;
+		deadline.tv_nsec -= 1000000000;
+	}
+	int result;
+	while((result = sem_timedwait(&pSemaphore->sem, &deadline)) != 0 && errno == EINTR) {}
+	return result == 0;
+}
+
+uint64 ScanClockNs() {
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64)now.tv_sec * 1000000000ull + (uint64)now.tv_nsec;
+}
+
+#else
+
+#include "s3eThread.h"
+#include "s3eTimer.h"
+
+//The s3eThread types are used directly. ScanThread and ScanSemaphore are never defined, only cast.
+
+bool ScanThreadsAvailable() {
+	return s3eThreadAvailable() == S3E_TRUE;
+}
+
+ScanThread* ScanThreadCreate(ScanThreadFunc func, void* pArg) {
+	return (ScanThread*)s3eThreadCreate(func, pArg, NULL, 0, NULL);
+}
+
+void ScanThreadJoin(ScanThread* pThread) {
+	if(pThread)
+		s3eThreadJoin((s3eThread*)pThread, NULL);
+}
+
+ScanSemaphore* ScanSemaphoreCreate(uint initialCount) {
+	return (ScanSemaphore*)s3eThreadSemCreate(initialCount);
+}
+
+void ScanSemaphoreDestroy(ScanSemaphore* pSemaphore) {
+	if(pSemaphore)
+		s3eThreadSemDestroy((s3eThreadSem*)pSemaphore);
+}
+
+void ScanSemaphoreWait(ScanSemaphore* pSemaphore) {
+	s3eThreadSemWait((s3eThreadSem*)pSemaphore, -1);
+}
+
+void ScanSemaphorePost(ScanSemaphore* pSemaphore) {
+	s3eThreadSemPost((s3eThreadSem*)pSemaphore);
+}
+
+bool ScanSemaphoreTimedWait(ScanSemaphore* pSemaphore, uint timeoutMs) {
+	return s3eThreadSemWait((s3eThreadSem*)pSemaphore, (int)timeoutMs) == S3E_RESULT_SUCCESS;
+}
+
+uint64 ScanClockNs() {
+	return s3eTimerGetUSTNanoseconds();
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef SCAN_THREAD_H
+#define SCAN_THREAD_H
+
+#include "ScanTypes.h"
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+//Thin wrappers around the platform's threads, semaphores, clock and atomic operations so the scan code does not depend
+//on one threading API. All atomic operations are full memory barriers.
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//ATOMICS
+
+//Atomically replace *p with value and return the previous value.
+inline int32 AtomicExchange(volatile int32* p, int32 value) {
+#if defined(_MSC_VER)
+	return (int32)_InterlockedExchange((volatile long*)p, (long)value);
+#else
+	int32 old;
+	do {
+		old = *p;
+	} while(__sync_val_compare_and_swap(p, old, value) != old);
+	return old;
+#endif
+}
+
+//Atomically add delta to *p and return the new value.
+inline int32 AtomicAdd(volatile int32* p, int32 delta) {
+#if defined(_MSC_VER)
+	return (int32)_InterlockedExchangeAdd((volatile long*)p, (long)delta) + delta;
+#else
+	return __sync_add_and_fetch(p, delta);
+#endif
+}
+
+//Atomically set *p to desired if it equals expected. Returns true if the swap happened.
+inline bool AtomicCompareExchange(volatile int32* p, int32 expected, int32 desired) {
+#if defined(_MSC_VER)
+	return _InterlockedCompareExchange((volatile long*)p, (long)desired, (long)expected) == (long)expected;
+#else
+	return __sync_bool_compare_and_swap(p, expected, desired);
+#endif
+}
+
+//Read *p with a full barrier so that everything written before the matching store is visible.
+inline int32 AtomicLoad(volatile int32* p) {
+	return AtomicAdd(p, 0);
+}
+
+//Write *p with a full barrier so that everything written before it is visible to the thread that loads it.
+inline void AtomicStore(volatile int32* p, int32 value) {
+	AtomicExchange(p, value);
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//THREADS
+
+struct ScanThread;
+struct ScanSemaphore;
+typedef void* (*ScanThreadFunc)(void* pArg);
+
+//Returns false if the platform can't create threads. Callers are expected to fall back to doing the work inline.
+bool ScanThreadsAvailable();
+
+//Start a thread running func(pArg). Returns NULL on failure.
+ScanThread* ScanThreadCreate(ScanThreadFunc func, void* pArg);
+
+//Wait for the thread to return and release it.
+void ScanThreadJoin(ScanThread* pThread);
+
+ScanSemaphore* ScanSemaphoreCreate(uint initialCount);
+void ScanSemaphoreDestroy(ScanSemaphore* pSemaphore);
+void ScanSemaphoreWait(ScanSemaphore* pSemaphore);
+void ScanSemaphorePost(ScanSemaphore* pSemaphore);
+
+//Wait at most timeoutMs for the semaphore. Returns true if it was signalled, false on timeout.
+bool ScanSemaphoreTimedWait(ScanSemaphore* pSemaphore, uint timeoutMs);
+
+//Monotonic clock in nanoseconds. Only differences between two readings are meaningful.
+uint64 ScanClockNs();
+
+#endif
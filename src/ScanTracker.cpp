@@ -0,0 +1,97 @@
+#include "ScanTracker.h"
+#include "BufferPool.h"
+#include "FrameKernels.h"
+
+#include <string.h>
+
+#define SCAN_TRACKER_DEFAULT_FULL_SCAN_INTERVAL 15 //About half a second at 30 frames per second
+#define SCAN_TRACKER_MARGIN 16 //Pixels added around the padded box for the quiet zone ZBar needs around a code
+#define SCAN_TRACKER_MIN_DIMENSION 96 //Smallest region scanned, as SCAN_PYRAMID_DEFAULT_MIN_DIMENSION
+
+//Set the tracked region to the bounding box of the symbols in pImage, whose coordinates map to the frame as
+//frame = (symbol << shift) + offset. The region is dropped if no symbol has a location.
+static void TrackSymbols(ScanTracker* pTracker, const zbar_image_t* pImage, uint offsetX, uint offsetY, uint shift) {
+	int x0 = 0x7fffffff, y0 = 0x7fffffff, x1 = -1, y1 = -1;
+	for(const zbar_symbol_t* pSymbol = zbar_image_first_symbol(pImage); pSymbol; pSymbol = zbar_symbol_next(pSymbol)) {
+		const uint points = zbar_symbol_get_loc_size(pSymbol);
+		for(uint i = 0; i < points; ++i) {
+			const int x = zbar_symbol_get_loc_x(pSymbol, i), y = zbar_symbol_get_loc_y(pSymbol, i);
+			x0 = x < x0 ? x : x0;
+			y0 = y < y0 ? y : y0;
+			x1 = x > x1 ? x : x1;
+			y1 = y > y1 ? y : y1;
+		}
+	}
+	pTracker->haveRegion = x1 >= 0 && y1 >= 0;
+	if(!pTracker->haveRegion)
+		return;
+	pTracker->regionX0 = ((uint)(x0 < 0 ? 0 : x0) << shift) + offsetX;
+	pTracker->regionY0 = ((uint)(y0 < 0 ? 0 : y0) << shift) + offsetY;
+	pTracker->regionX1 = ((uint)x1 << shift) + offsetX;
+	pTracker->regionY1 = ((uint)y1 << shift) + offsetY;
+}
+
+void ScanTrackerInit(ScanTracker* pTracker) {
+	memset(pTracker, 0, sizeof(ScanTracker));
+	pTracker->fullScanInterval = SCAN_TRACKER_DEFAULT_FULL_SCAN_INTERVAL;
+}
+
+void ScanTrackerRelease(ScanTracker* pTracker) {
+	ScanFree(pTracker->pRegion);
+	const uint fullScanInterval = pTracker->fullScanInterval;
+	ScanTrackerInit(pTracker);
+	pTracker->fullScanInterval = fullScanInterval;
+}
+
+int ScanTrackerScan(ScanTracker* pTracker, ScanPyramid* pPyramid, zbar_image_scanner_t* pScanner, zbar_image_t* pImage,
+	const uint8* pPixels, uint width, uint height) {
+	const uint frameDim = width < height ? width : height;
+	if(pTracker->haveRegion && pTracker->framesSinceFullScan < pTracker->fullScanInterval) {
+		//Square around the box, padded by half its size on every side for movement plus the quiet zone margin,
+		//centred on the box and clamped to the frame
+		const uint boxW = pTracker->regionX1 - pTracker->regionX0 + 1, boxH = pTracker->regionY1 - pTracker->regionY0 + 1;
+		const uint boxDim = boxW > boxH ? boxW : boxH;
+		uint dim = boxDim * 2 + 2 * SCAN_TRACKER_MARGIN;
+		dim = dim < SCAN_TRACKER_MIN_DIMENSION ? SCAN_TRACKER_MIN_DIMENSION : dim;
+
+		//A region over half the frame costs about as much as the pyramid's coarse levels, which are tried first there
+		if(dim <= frameDim && 2 * dim * dim <= width * height) {
+			if(!ScanReserveBuffer(&pTracker->pRegion, &pTracker->regionCapacity, dim * dim))
+				return -1;
+			const uint centreX = (pTracker->regionX0 + pTracker->regionX1) / 2, centreY = (pTracker->regionY0 + pTracker->regionY1) / 2;
+			uint x = centreX > dim / 2 ? centreX - dim / 2 : 0, y = centreY > dim / 2 ? centreY - dim / 2 : 0;
+			x = x + dim > width ? width - dim : x;
+			y = y + dim > height ? height - dim : y;
+			CropY800(pPixels, width, x, y, dim, pTracker->pRegion);
+
+			zbar_image_set_size(pImage, dim, dim);
+			zbar_image_set_data(pImage, pTracker->pRegion, dim * dim, NULL);
+			const int numSymbols = zbar_scan_image(pScanner, pImage);
+			++pTracker->regionScans;
+			pTracker->regionPixels += dim * dim;
+			++pTracker->framesSinceFullScan;
+			if(numSymbols > 0) {
+				++pTracker->regionHits;
+				pTracker->hitX = x;
+				pTracker->hitY = y;
+				pTracker->hitShift = 0;
+				TrackSymbols(pTracker, pImage, x, y, 0);
+				return numSymbols;
+			}
+		}
+	}
+
+	//No region, a full scan is due or the region missed
+	const int numSymbols = ScanPyramidScan(pPyramid, pScanner, pImage, pPixels, width, height);
+	++pTracker->fullScans;
+	pTracker->fullPixels += width * height;
+	pTracker->framesSinceFullScan = 0;
+	pTracker->hitX = pPyramid->hitX;
+	pTracker->hitY = pPyramid->hitY;
+	pTracker->hitShift = pPyramid->hitShift;
+	if(numSymbols > 0)
+		TrackSymbols(pTracker, pImage, pPyramid->hitX, pPyramid->hitY, pPyramid->hitShift);
+	else
+		pTracker->haveRegion = false;
+	return numSymbols;
+}
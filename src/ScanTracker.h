@@ -0,0 +1,43 @@
+#ifndef SCAN_TRACKER_H
+#define SCAN_TRACKER_H
+
+#include "ScanPyramid.h"
+
+//Region of interest tracking between frames. After a scan finds symbols the tracker keeps the bounding box of their
+//polygons (zbar_symbol_get_loc_*) in frame coordinates. The next frames are scanned in a padded square around that box
+//only, which in continuous scanning is a small part of the frame because codes barely move between frames. The whole
+//frame is scanned with the pyramid (see ScanPyramid) when the region scan finds nothing, when no code is tracked and at
+//least every fullScanInterval frames, so codes that come into view elsewhere are still found.
+//All state belongs to the thread that scans.
+
+struct ScanTracker {
+	uint fullScanInterval; //Region scans allowed in a row before the whole frame is scanned again
+
+	bool haveRegion; //False until a scan finds symbols with a location, and after a full scan finds none
+	uint regionX0, regionY0, regionX1, regionY1; //Bounding box of the last symbols found, in frame pixels, inclusive
+	uint framesSinceFullScan;
+	uint hitX, hitY, hitShift; //Where the symbols of the last scan are in the frame, as ScanPyramid::hitX
+
+	uint8* pRegion; //The padded region cut out of the frame
+	uint regionCapacity;
+
+	//Statistics
+	uint32 regionScans;
+	uint32 regionHits; //Region scans that found at least one symbol
+	uint32 fullScans;
+	uint64 regionPixels; //Pixels scanned by region scans
+	uint64 fullPixels; //Frame pixels of the full scans
+};
+
+void ScanTrackerInit(ScanTracker* pTracker);
+
+//Free the region buffer and forget the tracked region.
+void ScanTrackerRelease(ScanTracker* pTracker);
+
+//Scan a width x height Y800 frame: the tracked region if there is one and a full scan isn't due, otherwise or if that
+//finds nothing the whole frame through pPyramid. Returns the result of the last zbar_scan_image call; pImage then holds
+//its symbols. Returns -1 if a buffer couldn't be allocated.
+int ScanTrackerScan(ScanTracker* pTracker, ScanPyramid* pPyramid, zbar_image_scanner_t* pScanner, zbar_image_t* pImage,
+	const uint8* pPixels, uint width, uint height);
+
+#endif
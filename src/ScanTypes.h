@@ -0,0 +1,36 @@
+#ifndef SCAN_TYPES_H
+#define SCAN_TYPES_H
+
+//The scan modules (everything but main.cpp) only need the s3e integer types and heap functions. Defining
+//SCAN_HOST_BUILD replaces those with the standard C ones, so the modules also build as a plain desktop library
+//(see tools/Makefile).
+#ifdef SCAN_HOST_BUILD
+	#include <stdint.h>
+	#include <stdlib.h>
+
+	typedef uint8_t uint8;
+	typedef int16_t int16;
+	typedef uint16_t uint16;
+	typedef int32_t int32;
+	typedef uint32_t uint32;
+	typedef int64_t int64;
+	typedef uint64_t uint64;
+	typedef unsigned int uint;
+
+	#define s3eMalloc malloc
+	#define s3eRealloc realloc
+	#define s3eFree free
+#else
+	#include "s3eTypes.h"
+	#include "s3eMemory.h"
+#endif
+
+//Orientation of a raw camera frame. The values match s3eCameraFrameRotation so the two can be cast freely.
+enum FrameRotation {
+	FRAME_ROTNORMAL = 0, //No rotation needed
+	FRAME_ROT90 = 1, //Rotate 90 degrees CCW to correct orientation
+	FRAME_ROT180 = 2, //Rotate 180 degrees to correct orientation
+	FRAME_ROT270 = 3 //Rotate 90 degrees CW to correct orientation
+};
+
+#endif
@@ -5,15 +5,36 @@ using namespace IwNUI;
 
 #include "s3eTimer.h"
 #include "s3eCamera.h"
+#include "s3eConfig.h"
+#include "s3eKeyboard.h"
 #include "zbar.h"
 
+#include "BufferPool.h"
+#include "FrameFile.h"
+#include "ScanEngine.h"
+#include "ScanGovernor.h"
+
 //Function prototypes
 void RequestQuit();
+void* CreateScanEngineThread(void*);
+void BeginScanEngineSetup();
+ScanEngine* WaitForScanEngine();
 void StartCamera();
 void StopCamera();
+bool RestartCamera(uint size);
+void UpdateCameraGovernor();
+void ReleaseCameraResources();
+void LoadScanProfile();
+void LoadCameraSettings();
+void OpenScanExport();
+bool GetConfigValue(void*, const char* pGroup, const char* pKey, char* pValue);
+CIwTexture** SelectPreviewTextures(uint dim);
+void ProcessScanResults();
+void TraceScanStats();
+void TraceStartupTimes();
+void DrawCameraPreview(const CIwSVec2& xy, const CIwSVec2& wh);
 int32 CameraUpdateCallback(void*, void*);
 int32 CameraStoppedCallback(void*, void*);
-int32 ScanQrCodeCallback(void*, void*);
 
 enum CameraState {
 	CAMERA_IDLE, //Camera has been stopped or has not yet been started
@@ -24,18 +45,62 @@ enum CameraState {
 CameraState g_CameraState = CAMERA_IDLE;
 
 //Camera
-uint16* g_pCameraTexelsRGB565 = NULL; //Buffer to hold cropped raw camera pixels in RGB565 format. These pixels are displayed on screen.
-uint g_frameResolution, g_frameRotation = 0;
-uint g_cameraSquareDimension = 0; //The dimension of the square cropped out of the raw camera preview data (frameData). 
-uint g_cameraCropXStart, g_cameraCropYStart = 0; //The coordinates of the top left corner of the cropping square inside of the raw camera preview data.
-CIwTexture* g_pCameraTextureRGB565 = NULL; //This texture uses the data held in the g_pCameraTexelsRGB565 buffer.
+#define PREVIEW_TEXTURE_COUNT 3 //Preview textures uploaded in turn, so an upload never waits for the GPU to finish drawing from one
+#define PREVIEW_CHANGE_THRESHOLD 1 //Mean signature difference (gray levels) below which the preview isn't converted and uploaded again
+#define PREVIEW_TEXTURE_SETS 2 //Texture rings kept for different preview sizes, so switching back and forth creates no textures
+struct PreviewTextureSet {
+	uint dim; //Width and height of the textures, 0 if the set is empty
+	CIwTexture* pTextures[PREVIEW_TEXTURE_COUNT];
+};
+uint16* g_pCameraTexelsRGB565 = NULL; //Buffer to hold the cropped camera pixels scaled to the preview size in RGB565 format. These pixels are displayed on screen.
+BufferPool g_previewBufferPool; //Owns g_pCameraTexelsRGB565 and keeps the buffers of other preview sizes for reuse
+uint g_frameWidth = 0, g_frameHeight = 0, g_frameRotation = 0;
+FrameCrop g_cameraCrop = { 0, 0, 0 }; //The square cropped out of the raw camera preview data (frameData)
+uint g_previewMaxDim = 0; //Size of the preview rectangle on screen in pixels. There is no point uploading a larger preview.
+uint g_previewDim = 0; //Width and height of the preview textures: the crop size, at most g_previewMaxDim
+PreviewTextureSet g_previewTextureSets[PREVIEW_TEXTURE_SETS];
+CIwTexture** g_ppPreviewTextures = NULL; //Ring of preview textures of the current size, each filled from g_pCameraTexelsRGB565
+uint g_previewTexture = 0; //Index of the most recently uploaded texture, the one drawn
+bool g_havePreviewSignature = false;
+uint8 g_previewSignature[SCAN_SIGNATURE_SIZE]; //Signature of the scan frame the drawn preview was made from
+bool g_haveFrameSignature = false;
+uint8 g_frameSignature[SCAN_SIGNATURE_SIZE]; //Signature of the last scan frame, which decides if the next preview is made
+s3eCameraPixelType g_cameraPixelType = S3E_CAMERA_PIXEL_TYPE_RGB565_CONVERTED; //The pixel format requested from the camera
+#define CAMERA_SIZE_COUNT 3 //Streaming sizes the governor moves between
+const s3eCameraStreamingSizeHint g_cameraSizes[CAMERA_SIZE_COUNT] = { S3E_CAMERA_STREAMING_SIZE_HINT_SMALL,
+	S3E_CAMERA_STREAMING_SIZE_HINT_MEDIUM, S3E_CAMERA_STREAMING_SIZE_HINT_LARGE };
+const char* g_cameraSizeNames[CAMERA_SIZE_COUNT] = { "small", "medium", "large" };
+uint g_cameraSize = 1; //Index in g_cameraSizes of the size the camera streams at. Starts at [Camera] Size in app.icf.
+bool g_cameraGovernorEnabled = true; //Let g_cameraGovernor move the camera size up and down. [Camera] Governor in app.icf.
+ScanGovernor g_cameraGovernor; //Watches frame prepare, decode and latency times and picks g_cameraSize
+bool g_rotatePreviewOnGpu = true; //Upload the crop unrotated and draw it upright with rotated texture coordinates instead of rotating it on the CPU
 
 //ZBar
+#define SCAN_RESULT_BATCH 16 //Results taken from the scan engine's queue at a time
+#define STATUS_PAYLOAD_CHARS 200 //Longer payloads are cut short in the status text. The trace gets them in full.
 bool g_qrCodeFound = false;
-uint8* g_pCameraPixelsGrayscale = NULL; //Buffer to hold grayscale converted camera pixels (RGB565 -> YUV800). These pixels are scanned by ZBar for QR codes
-zbar_image_scanner_t* g_pZBarScanner = NULL; //Zbar object that process images for barcodes
-zbar_image_t* g_pZBarImage = NULL; //Zbar object returned by g_pZBarScanner containing any identified barcodes
-uint g_qrScanTimeout = 1000; //The period between each QR code scan
+bool g_continuousScan = false; //Keep scanning and report every new code found instead of stopping at the first one until "Scan Again"
+uint g_dedupTtlMs = 3000; //Continuous scanning: a code is reported again only this long after it was last seen
+uint g_codesFound = 0; //Continuous scanning: codes reported since the app started
+ScanEngine* g_pScanEngine = NULL; //Owns the ZBar scanner and the grayscale frames (RGB565 -> YUV800, or the cropped NV21/NV12 luma plane) it scans on its own thread
+ScanProfile g_scanProfile; //Symbologies and scan density, loaded from app.icf by LoadScanProfile
+ScanExport g_scanExport; //Ring every reported code is also written to, for consumers in the process. Open if [Scan] ExportBytes is set.
+ScanMode g_scanMode = SCAN_MODE_TRACKING; //SCAN_MODE_PYRAMID scans every frame whole at several resolutions, SCAN_MODE_FULL at full resolution only
+float g_scanCpuBudget = 0.5f; //Fraction of one CPU core the scan worker may spend decoding. Every new frame is scanned within this budget.
+bool g_showScanStats = false; //Draw the scan statistics over the camera preview. Toggled with the menu key, the E key cycles the frame enhancement.
+uint g_statsTracePeriod = 5000; //Milliseconds between two scan statistics trace dumps while the camera runs
+uint64 g_lastStatsTraceTime = 0; //ScanClockNs() time of the last periodic TraceScanStats()
+uint32 g_lastTraceAllocations = 0, g_lastTraceFrames = 0; //ScanAllocationCount() and frames received at the last TraceScanStats()
+uint64 g_scanStartTime = 0; //ScanClockNs() time scanning (re)started, used to trace the time to decode
+ScanThread* g_pScanEngineSetup = NULL; //Creates the scan engine while the UI is built. Joined by WaitForScanEngine.
+ScanEngine* g_pCreatedScanEngine = NULL; //Written by the setup thread, read after joining it
+uint64 g_scanEngineReadyTime = 0; //ScanClockNs() time the scan engine was created
+//Startup
+StartupTimes g_startupTimes; //Time from the start of main() to each startup phase, traced once the first preview is shown
+//Recording
+const char* g_recordFramesPath = NULL; //Set to a file name (e.g. "camera.frames") to record all camera frames for replay with tools/scanreplay
+FrameRecorder g_frameRecorder = { NULL, 0, 0 };
+
 char* g_pQrString = NULL; //The identified text within the QR code
 
 struct MyNUIElements {
@@ -63,6 +128,7 @@ bool OnButtonClick(void* pData, CButton* pBtnNUI) {
 	if(strcmp("btnScanAgain", btnNameStr) == 0) {
 		IwTrace(]-->,("Scan Again button pressed."));
 		g_qrCodeFound = false;
+		g_scanStartTime = ScanClockNs();
 		g_myNUIElements->pBtnScan->SetAttribute("enabled", "0");
 		g_myNUIElements->pTextStatus->SetAttribute("caption", "Scanning for QR Code...");
 	}
@@ -84,7 +150,42 @@ void RequestQuit() {
 	s3eDeviceRequestQuit();
 }
 
-//Start camera, trace camera info, register camera callbacks and create ZBarScanner object.
+//Scan engine setup thread (or called directly without threads): create the ZBar scanner and the scan worker.
+void* CreateScanEngineThread(void*) {
+	g_pCreatedScanEngine = ScanEngineCreate(g_scanCpuBudget, g_scanMode, &g_scanProfile, g_continuousScan ? g_dedupTtlMs : 0);
+	if(g_pCreatedScanEngine && g_scanExport.pBlock) //No frame is published before the camera starts
+		ScanEngineSetExport(g_pCreatedScanEngine, &g_scanExport);
+	g_scanEngineReadyTime = ScanClockNs();
+	return NULL;
+}
+
+//Start creating the scan engine on a thread of its own, so ZBar's setup overlaps with building and first drawing the UI.
+//g_scanProfile must be loaded. Without threads the engine is created by WaitForScanEngine.
+void BeginScanEngineSetup() {
+	if(ScanThreadsAvailable())
+		g_pScanEngineSetup = ScanThreadCreate(CreateScanEngineThread, NULL);
+}
+
+//Wait for the setup thread and make its engine g_pScanEngine, or create the engine now if there is no setup thread
+//(no threads, or an earlier attempt failed). Returns g_pScanEngine, NULL if it couldn't be created.
+ScanEngine* WaitForScanEngine() {
+	if(g_pScanEngine)
+		return g_pScanEngine;
+	if(g_pScanEngineSetup) {
+		ScanThreadJoin(g_pScanEngineSetup);
+		g_pScanEngineSetup = NULL;
+	}
+	else {
+		CreateScanEngineThread(NULL);
+	}
+	g_pScanEngine = g_pCreatedScanEngine;
+	g_pCreatedScanEngine = NULL;
+	if(g_pScanEngine)
+		StartupTimesMark(&g_startupTimes, STARTUP_SCANNER_READY, g_scanEngineReadyTime);
+	return g_pScanEngine;
+}
+
+//Start camera, trace camera info, register camera callbacks and get the scan engine from its setup thread.
 void StartCamera() {
 	//Check if camera is available
 	if(s3eCameraAvailable() != S3E_TRUE) {
@@ -97,7 +198,7 @@ void StartCamera() {
 	else {
 		IwTrace(]-->, ("Camera available"));
 
-		//Check and trace which pixel formats are supported (RGB565_CONVERTED will be used regardless)
+		//Check and trace which pixel formats are supported
 		s3eBool cameraPixelRGB565 = s3eCameraIsFormatSupported(S3E_CAMERA_PIXEL_TYPE_RGB565);
 		s3eBool cameraPixelRGB888 = s3eCameraIsFormatSupported(S3E_CAMERA_PIXEL_TYPE_RGB888);
 		s3eBool cameraPixelNV21 = s3eCameraIsFormatSupported(S3E_CAMERA_PIXEL_TYPE_NV21);
@@ -111,15 +212,31 @@ void StartCamera() {
 		IwTrace(]-->, ("Camera pixel format NV12 supported = %u", cameraPixelNV12));
 		IwTrace(]-->, ("Camera pixel format BGRA8888 supported = %u", cameraPixelBGRA8888));
 
-		//Start camera
-		if(s3eCameraStart(S3E_CAMERA_STREAMING_SIZE_HINT_MEDIUM, S3E_CAMERA_PIXEL_TYPE_RGB565_CONVERTED) != S3E_RESULT_SUCCESS) {
+		//Prefer a YUV format: its luma plane is handed to ZBar as is and only the preview needs a color conversion.
+		//RGB565_CONVERTED makes the platform convert YUV to RGB, which then has to be converted back to grayscale.
+		if(cameraPixelNV21)
+			g_cameraPixelType = S3E_CAMERA_PIXEL_TYPE_NV21;
+		else if(cameraPixelNV12)
+			g_cameraPixelType = S3E_CAMERA_PIXEL_TYPE_NV12;
+		else
+			g_cameraPixelType = S3E_CAMERA_PIXEL_TYPE_RGB565_CONVERTED;
+
+		//Start camera. Fall back to RGB565_CONVERTED if the YUV format is refused.
+		s3eResult startResult = s3eCameraStart(g_cameraSizes[g_cameraSize], g_cameraPixelType);
+		if(startResult != S3E_RESULT_SUCCESS && g_cameraPixelType != S3E_CAMERA_PIXEL_TYPE_RGB565_CONVERTED) {
+			IwTrace(]-->, ("Start camera with pixel format %u failed, retrying with RGB565_CONVERTED", g_cameraPixelType));
+			g_cameraPixelType = S3E_CAMERA_PIXEL_TYPE_RGB565_CONVERTED;
+			startResult = s3eCameraStart(g_cameraSizes[g_cameraSize], g_cameraPixelType);
+		}
+		if(startResult != S3E_RESULT_SUCCESS) {
 			IwTrace(]-->, ("Start camera failed"));
 			///s3eDebugErrorShow(S3E_MESSAGE_CONTINUE, "Error starting camera.");
 			g_CameraState = CAMERA_UNAVAILABLE;
 			return;
 		}
 		g_CameraState = CAMERA_LOADING;
-		IwTrace(]-->, ("Start camera successful"));
+		StartupTimesMark(&g_startupTimes, STARTUP_CAMERA_STARTED, ScanClockNs());
+		IwTrace(]-->, ("Start camera successful (pixel format %u, size %s)", g_cameraPixelType, g_cameraSizeNames[g_cameraSize]));
 			
 		//Register camera update callback
 		if(s3eCameraRegister(S3E_CAMERA_UPDATE_STREAMING, CameraUpdateCallback, NULL) != S3E_RESULT_SUCCESS) {
@@ -139,19 +256,33 @@ void StartCamera() {
 			return;
 		}
 
-		//Creat ZBarScanner object
-		g_pZBarScanner = zbar_image_scanner_create();
-		if (g_pZBarScanner == NULL) {
+		//Get the scan engine (ZBar scanner and scan worker thread), usually already created by its setup thread while the
+		//camera was starting. It is kept when the camera stops, so a restart reuses the scanner, its frame buffers and the
+		//worker thread. Camera frames are only delivered by s3eDeviceYield, so none arrive before it is ready.
+		if (WaitForScanEngine() == NULL) {
 			IwTrace(]-->, ("Create ZBar image scanner failed"));
 			s3eDebugErrorShow(S3E_MESSAGE_CONTINUE, "Failed to initialize ZBar.");
 			StopCamera();
 			return;
 		}
-		zbar_image_scanner_set_config(g_pZBarScanner, ZBAR_QRCODE, ZBAR_CFG_ENABLE, 1);
+		ScanResult staleResults[SCAN_RESULT_BATCH];
+		while(ScanEnginePollResults(g_pScanEngine, staleResults, SCAN_RESULT_BATCH)) //Drop results from frames before the camera stopped
+			ScanEngineResultsDone(g_pScanEngine);
+		g_frameWidth = g_frameHeight = 0; //Check the format of the first frame again
+		ScanGovernorInit(&g_cameraGovernor, CAMERA_SIZE_COUNT, g_cameraSize, ScanClockNs());
+		//Start recording camera frames if requested
+		if(g_recordFramesPath) {
+			if(FrameRecorderOpen(&g_frameRecorder, g_recordFramesPath))
+				IwTrace(]-->, ("Recording camera frames to %s", g_recordFramesPath));
+			else
+				IwTrace(]-->, ("Failed to create camera recording %s", g_recordFramesPath));
+		}
+		IwTrace(]-->, ("Scan worker thread running = %u", g_pScanEngine->pThread != NULL));
 	}
 }
 
-//Unregisters camera callbacks, frees allocated buffers and deletes created camera/zbar objects.
+//Unregisters camera callbacks and stops the camera. Buffers, textures and the scan engine are kept for the next
+//StartCamera and freed by ReleaseCameraResources.
 void StopCamera() {
 	//Unregister camera callbacks, stop camera
 	s3eCameraUnRegister(S3E_CAMERA_UPDATE_STREAMING, CameraUpdateCallback);
@@ -159,27 +290,305 @@ void StopCamera() {
 	s3eCameraStop();
 	g_CameraState = CAMERA_IDLE;
 
-	//Free memory buffers
-	s3eFree(g_pCameraTexelsRGB565);
-	s3eFree(g_pCameraPixelsGrayscale);
-	g_pCameraTexelsRGB565 = NULL;
-	g_pCameraPixelsGrayscale = NULL;
+	if (g_frameRecorder.pFile) {
+		FrameRecorderClose(&g_frameRecorder);
+		IwTrace(]-->, ("Recorded %u camera frames (%u KB)", g_frameRecorder.frames, (uint)(g_frameRecorder.bytes / 1024)));
+	}
 	
-	//Delete created objects
-	if (g_pCameraTextureRGB565 != NULL) {
-		delete g_pCameraTextureRGB565;
-		g_pCameraTextureRGB565 = NULL;
+	IwTrace(]-->, ("Stop camera successful"));
+}
+
+//Switch the running camera to g_cameraSizes[size] without the teardown of StopCamera: the callbacks, the scan engine
+//and any recording stay, and the first frame of the new size gets its buffers and textures from the pools. Falls back
+//to the current size if the camera refuses the new one. Returns false if the camera couldn't be restarted at all.
+bool RestartCamera(uint size) {
+	//s3eCameraStop may report the stop through the stop callback, which would tear everything down
+	s3eCameraUnRegister(S3E_CAMERA_STOP_STREAMING, CameraStoppedCallback);
+	s3eCameraStop();
+	bool started = s3eCameraStart(g_cameraSizes[size], g_cameraPixelType) == S3E_RESULT_SUCCESS;
+	if(started) {
+		g_cameraSize = size;
 	}
-	if (g_pZBarImage) {
-		zbar_image_destroy(g_pZBarImage);
-		g_pZBarImage = NULL;
+	else {
+		IwTrace(]-->, ("Camera size %s refused, staying at %s", g_cameraSizeNames[size], g_cameraSizeNames[g_cameraSize]));
+		started = s3eCameraStart(g_cameraSizes[g_cameraSize], g_cameraPixelType) == S3E_RESULT_SUCCESS;
 	}
-	if (g_pZBarScanner) {
-		zbar_image_scanner_destroy(g_pZBarScanner);
-		g_pZBarScanner = NULL;
+	if(!started || s3eCameraRegister(S3E_CAMERA_STOP_STREAMING, CameraStoppedCallback, NULL) != S3E_RESULT_SUCCESS) {
+		IwTrace(]-->, ("Restart camera failed"));
+		StopCamera();
+		g_CameraState = CAMERA_UNAVAILABLE;
+		return false;
+	}
+	return true;
+}
+
+//Let the governor look at the scan stats and switch the camera size if the device can't keep up with the current one,
+//or has time to spare while no code is found. Every switch is traced with its reason and the window's numbers.
+void UpdateCameraGovernor() {
+	if(!g_cameraGovernorEnabled || g_CameraState != CAMERA_STREAMING || g_qrCodeFound)
+		return;
+	const uint64 now = ScanClockNs();
+	ScanGovernorReason reason;
+	const uint size = ScanGovernorUpdate(&g_cameraGovernor, &g_pScanEngine->stats, now, &reason);
+	if(size == g_cameraSize)
+		return;
+
+	const ScanGovernorWindow& window = g_cameraGovernor.window;
+	IwTrace(]-->, ("Camera size %s -> %s: %s (prepare %u us/frame, decode %u us/scan, latency %u ms, %u frames, %u scans, %u decoded)",
+		g_cameraSizeNames[g_cameraSize], g_cameraSizeNames[size], ScanGovernorReasonName(reason),
+		(uint)(window.prepareNs / window.frames / 1000), (uint)(window.decodeNs / window.scans / 1000),
+		(uint)(window.latencyNs / window.latencies / 1000000), window.frames, window.scans, window.decoded));
+	if(!RestartCamera(size))
+		return;
+	if(g_cameraSize < size) //Refused: don't ask for it again until the camera is started again
+		g_cameraGovernor.maxLevel = g_cameraSize;
+	ScanGovernorSwitched(&g_cameraGovernor, &g_pScanEngine->stats, g_cameraSize, now);
+}
+
+//Frees the buffers and deletes the textures and zbar objects kept across camera restarts. Called on exit.
+void ReleaseCameraResources() {
+	if(g_pScanEngineSetup) //The camera never started: the engine was never taken from the setup thread
+		WaitForScanEngine();
+	if (g_pScanEngine) {
+		ScanEngineDestroy(g_pScanEngine); //Waits for a scan in progress to finish
+		g_pScanEngine = NULL;
+	}
+	ScanExportClose(&g_scanExport);
+
+	for(uint i = 0; i < PREVIEW_TEXTURE_SETS; ++i) {
+		for(uint j = 0; j < PREVIEW_TEXTURE_COUNT; ++j)
+			delete g_previewTextureSets[i].pTextures[j];
+	}
+	memset(g_previewTextureSets, 0, sizeof(g_previewTextureSets));
+	g_ppPreviewTextures = NULL;
+
+	BufferPoolPut(&g_previewBufferPool, g_pCameraTexelsRGB565);
+	g_pCameraTexelsRGB565 = NULL;
+	BufferPoolRelease(&g_previewBufferPool);
+}
+
+//Load the scanner profile named by [Scan] Profile in app.icf (see data/app.config.txt) into g_scanProfile. A missing or
+//invalid profile falls back to QR codes only.
+void LoadScanProfile() {
+	char name[S3E_CONFIG_STRING_MAX];
+	if(s3eConfigGetString("Scan", "Profile", name) != S3E_RESULT_SUCCESS) {
+		ScanProfileSetDefault(&g_scanProfile, "default");
+	}
+	else if(!ScanProfileLoad(&g_scanProfile, name, GetConfigValue, NULL)) {
+		IwTrace(]-->, ("Scan profile %s is missing or invalid, scanning QR codes only", name));
+		ScanProfileSetDefault(&g_scanProfile, "default");
+	}
+	char text[256];
+	ScanProfileFormat(&g_scanProfile, text, sizeof(text));
+	IwTrace(]-->, ("Scan profile %s", text));
+}
+
+//Load the camera size the app starts at and whether the governor may change it from [Camera] in app.icf.
+void LoadCameraSettings() {
+	char size[S3E_CONFIG_STRING_MAX];
+	if(s3eConfigGetString("Camera", "Size", size) == S3E_RESULT_SUCCESS) {
+		uint i = 0;
+		while(i < CAMERA_SIZE_COUNT && strcmp(size, g_cameraSizeNames[i]) != 0)
+			++i;
+		if(i < CAMERA_SIZE_COUNT)
+			g_cameraSize = i;
+		else
+			IwTrace(]-->, ("Unknown camera size %s, using %s", size, g_cameraSizeNames[g_cameraSize]));
+	}
+	int governor;
+	if(s3eConfigGetInt("Camera", "Governor", &governor) == S3E_RESULT_SUCCESS)
+		g_cameraGovernorEnabled = governor != 0;
+	IwTrace(]-->, ("Camera size %s, governor %s", g_cameraSizeNames[g_cameraSize], g_cameraGovernorEnabled ? "on" : "off"));
+}
+
+//Open g_scanExport with a ring of [Scan] ExportBytes from app.icf, if set. s3e has no shared memory, so the ring is on
+//the heap for a reader in this process (ScanExportReaderAttach); the host tools map it from a file instead.
+void OpenScanExport() {
+	int ringBytes;
+	if(s3eConfigGetInt("Scan", "ExportBytes", &ringBytes) != S3E_RESULT_SUCCESS || ringBytes <= 0)
+		return;
+	if(ScanExportOpen(&g_scanExport, NULL, (uint)ringBytes))
+		IwTrace(]-->, ("Scan export: %d byte ring", ringBytes));
+	else
+		IwTrace(]-->, ("Scan export: can't create a %d byte ring, it must be a power of two of at least 256", ringBytes));
+}
+
+//ScanConfigGetter reading app.icf
+bool GetConfigValue(void*, const char* pGroup, const char* pKey, char* pValue) {
+	return s3eConfigGetString(pGroup, pKey, pValue) == S3E_RESULT_SUCCESS;
+}
+
+//Get the ring of preview textures for dim x dim previews. An existing set of that size is reused. Otherwise the set not
+//in use is (re)created, so flipping between two sizes never deletes or creates textures once both exist.
+CIwTexture** SelectPreviewTextures(uint dim) {
+	PreviewTextureSet* pSet = NULL;
+	for(uint i = 0; i < PREVIEW_TEXTURE_SETS && pSet == NULL; ++i) {
+		if(g_previewTextureSets[i].dim == dim)
+			pSet = &g_previewTextureSets[i];
+	}
+	if(pSet == NULL) {
+		pSet = g_ppPreviewTextures == g_previewTextureSets[0].pTextures ? &g_previewTextureSets[1] : &g_previewTextureSets[0];
+		IwTrace(]-->, ("Creating %u preview textures of %ux%u", PREVIEW_TEXTURE_COUNT, dim, dim));
+		for(uint i = 0; i < PREVIEW_TEXTURE_COUNT; ++i) {
+			delete pSet->pTextures[i];
+			pSet->pTextures[i] = new CIwTexture;
+			pSet->pTextures[i]->SetModifiable(true);
+			pSet->pTextures[i]->SetMipMapping(false);
+			pSet->pTextures[i]->CopyFromBuffer(dim, dim, CIwImage::RGB_565, dim<<1, (uint8*)g_pCameraTexelsRGB565, NULL);
+		}
+		pSet->dim = dim;
+	}
+	return pSet->pTextures;
+}
+
+//Called once per frame by the main loop. Drains the scan worker's results a batch at a time.
+//Single shot: shows the first code found since scanning (re)started, results that arrive after that are dropped.
+//Continuous: every result is new (the engine's dedup cache drops repeats), so each one is traced and the status shows
+//the number of codes found and the last one.
+void ProcessScanResults() {
+	if(g_pScanEngine == NULL)
+		return;
+
+	ScanResult results[SCAN_RESULT_BATCH];
+	uint numResults;
+	while((numResults = ScanEnginePollResults(g_pScanEngine, results, SCAN_RESULT_BATCH)) > 0) {
+		const ScanResult* pShown = NULL;
+		for(uint i = 0; i < numResults; ++i) {
+			const ScanResult& result = results[i];
+			if(g_qrCodeFound)
+				continue;
+			if(g_codesFound == 0 || !g_continuousScan) {
+				const uint64 timeToDecode = ScanClockNs() - g_scanStartTime;
+				ScanStatsAddStage(&g_pScanEngine->stats, SCAN_STAGE_FIRST_DECODE, timeToDecode);
+				IwTrace(]-->, ("QR code found! Time to decode = %u ms", (uint)(timeToDecode / 1000000)));
+			}
+			IwTrace(]-->, ("pQrData = %s", result.pData));
+			IwTrace(]-->, ("qrDataLength = %u", result.dataLength));
+			++g_codesFound;
+			pShown = &result;
+			if(!g_continuousScan) {
+				g_qrCodeFound = true;
+				TraceScanStats();
+				g_myNUIElements->pBtnScan->SetAttribute("enabled", "1");
+			}
+		}
+
+		if(pShown) { //Extract and print the code text, cut short so the label stays readable
+			const char* ellipsis = pShown->dataLength > STATUS_PAYLOAD_CHARS ? "..." : "";
+			char qrString[STATUS_PAYLOAD_CHARS + 64];
+			if(g_continuousScan)
+				snprintf(qrString, sizeof(qrString), "%u codes found, last: %.*s%s", g_codesFound, STATUS_PAYLOAD_CHARS, pShown->pData, ellipsis);
+			else
+				snprintf(qrString, sizeof(qrString), "%s found: %.*s%s", zbar_get_symbol_name(pShown->type), STATUS_PAYLOAD_CHARS, pShown->pData, ellipsis);
+			g_myNUIElements->pTextStatus->SetAttribute("caption", qrString);
+		}
+		ScanEngineResultsDone(g_pScanEngine);
 	}
-	
-	IwTrace(]-->, ("Stop camera successful"));
+}
+
+//Trace how the scan worker spent its time so the scheduler and pyramid settings can be tuned. The counters belong to the
+//worker and are read without synchronization, which is good enough for tracing.
+void TraceScanStats() {
+	char text[1024];
+	ScanStatsFormat(&g_pScanEngine->stats, text, sizeof(text));
+	for(char* pLine = strtok(text, "\n"); pLine; pLine = strtok(NULL, "\n"))
+		IwTrace(]-->, ("Scan stats: %s", pLine));
+
+	//Heap allocations by the scan modules (ScanAlloc). Once the camera runs at a fixed size there should be none per frame.
+	const uint32 allocations = ScanAllocationCount(), frames = g_pScanEngine->stats.framesReceived;
+	IwTrace(]-->, ("Scan allocations: %u total, %u over the last %u frames", allocations, allocations - g_lastTraceAllocations,
+		frames - g_lastTraceFrames));
+	g_lastTraceAllocations = allocations;
+	g_lastTraceFrames = frames;
+
+	//Cost and hit rate of the scanner profile, to compare profiles on a deployment
+	const ScanStats& stats = g_pScanEngine->stats;
+	const LatencyHistogram& decode = stats.stages[SCAN_STAGE_DECODE];
+	IwTrace(]-->, ("Scan profile %s: %u scans, %u us/scan, %u%% found a symbol", g_scanProfile.name, stats.framesScanned,
+		decode.count ? (uint)(decode.totalNs / decode.count / 1000) : 0, stats.framesScanned ? 100 * stats.framesDecoded / stats.framesScanned : 0));
+
+	const ScanScheduler& scheduler = g_pScanEngine->scheduler;
+	IwTrace(]-->, ("Scan scheduler: %u frames offered, %u scanned, %u skipped as unchanged, decode cost %u us",
+		scheduler.framesOffered, scheduler.framesScanned, scheduler.framesUnchanged, (uint)(scheduler.decodeCostNs / 1000)));
+
+	//Frames the quality gate kept from ZBar, and the decode time that saved at the current decode cost
+	const uint32* pDecisions = stats.gateDecisions;
+	const uint32 gated = pDecisions[SCAN_GATE_BLURRED] + pDecisions[SCAN_GATE_EXPOSURE];
+	IwTrace(]-->, ("Scan quality gate %s: %u passed, %u forced, %u blurred, %u badly exposed, ~%u ms of decoding saved",
+		ScanEngineGetQualityGate(g_pScanEngine) ? "on" : "off", pDecisions[SCAN_GATE_PASS], pDecisions[SCAN_GATE_FORCED],
+		pDecisions[SCAN_GATE_BLURRED], pDecisions[SCAN_GATE_EXPOSURE], (uint)(gated * scheduler.decodeCostNs / 1000000)));
+
+	//Share of the tiles averaged rather than restarted, low when the code or the phone keeps moving
+	const ScanDenoiser& denoiser = g_pScanEngine->denoiser;
+	const uint32 tiles = denoiser.tilesBlended + denoiser.tilesRestarted;
+	IwTrace(]-->, ("Scan denoise %s: %u frames averaged, %u%% of the tiles blended, %u restarted",
+		ScanEngineGetDenoise(g_pScanEngine) ? "on" : "off", denoiser.frames, tiles ? 100 * denoiser.tilesBlended / tiles : 0,
+		denoiser.tilesRestarted));
+
+	if(g_scanExport.pBlock) {
+		IwTrace(]-->, ("Scan export: %u records written, %u too large", (uint32)g_scanExport.pHeader->records,
+			(uint32)g_scanExport.pHeader->dropped));
+	}
+
+	IwTrace(]-->, ("Camera governor %s: size %s, %u steps up, %u steps down", g_cameraGovernorEnabled ? "on" : "off",
+		g_cameraSizeNames[g_cameraSize], g_cameraGovernor.switchesUp, g_cameraGovernor.switchesDown));
+
+	const ScanTracker& tracker = g_pScanEngine->decoder.tracker;
+	if(tracker.fullScans) { //Every region scan follows a full scan
+		const uint64 framePixels = tracker.fullPixels / tracker.fullScans;
+		const uint percentScanned = (uint)(100 * (tracker.regionPixels + tracker.fullPixels) /
+			(framePixels * (tracker.regionScans + tracker.fullScans)));
+		IwTrace(]-->, ("Scan tracking: %u region scans, %u hit, %u full scans, %u%% of the pixels scanned", tracker.regionScans,
+			tracker.regionHits, tracker.fullScans, percentScanned));
+	}
+
+	const ScanPyramid& pyramid = g_pScanEngine->decoder.pyramid;
+	if(pyramid.frames == 0)
+		return;
+	IwTrace(]-->, ("Scan pyramid: %u frames, build %u us/frame", pyramid.frames, (uint)(pyramid.buildNs / pyramid.frames / 1000)));
+	const char* attemptNames[SCAN_ATTEMPT_COUNT] = { "full", "half", "quarter", "crop" };
+	for(uint i = 0; i < SCAN_ATTEMPT_COUNT; ++i) {
+		const ScanAttemptStats& stats = pyramid.stats[i];
+		IwTrace(]-->, ("Scan pyramid %s: %u attempts, %u decoded, %u us/attempt", attemptNames[i], stats.attempts, stats.decoded,
+			stats.attempts ? (uint)(stats.totalNs / stats.attempts / 1000) : 0));
+	}
+}
+
+//Trace how long startup took to reach each phase, time to first preview and time to scanner ready in particular.
+void TraceStartupTimes() {
+	char text[256];
+	StartupTimesFormat(&g_startupTimes, text, sizeof(text));
+	IwTrace(]-->, ("%s", text));
+}
+
+//Draw the camera preview texture into the screen rectangle at xy with size wh.
+//With g_rotatePreviewOnGpu the texture holds the crop as the camera delivered it, so the texture corner drawn at each
+//rectangle corner is turned by the frame rotation: the GPU rotates the preview for free while sampling it.
+void DrawCameraPreview(const CIwSVec2& xy, const CIwSVec2& wh) {
+	CIwMaterial* pMaterial = IW_GX_ALLOC_MATERIAL();
+	pMaterial->SetTexture(g_ppPreviewTextures[g_previewTexture]);
+	pMaterial->SetColAmbient(0xffffffff);
+	IwGxSetMaterial(pMaterial);
+
+	//Rectangle corners in quad order (top left, bottom left, bottom right, top right) and the texture corners in the same order.
+	//ROT90 (90 degrees CCW) shows texture corner k at rectangle corner k+1, and so on for the other rotations.
+	static const int16 textureCorners[4][2] = { { 0, 0 }, { 0, IW_GEOM_ONE }, { IW_GEOM_ONE, IW_GEOM_ONE }, { IW_GEOM_ONE, 0 } };
+	const uint rotation = g_rotatePreviewOnGpu ? g_frameRotation & 3 : 0;
+	CIwSVec2* pVerts = IW_GX_ALLOC(CIwSVec2, 4);
+	CIwSVec2* pUVs = IW_GX_ALLOC(CIwSVec2, 4);
+	pVerts[0] = CIwSVec2(xy.x, xy.y);
+	pVerts[1] = CIwSVec2(xy.x, xy.y + wh.y);
+	pVerts[2] = CIwSVec2(xy.x + wh.x, xy.y + wh.y);
+	pVerts[3] = CIwSVec2(xy.x + wh.x, xy.y);
+	for(uint i = 0; i < 4; ++i) {
+		const int16* pCorner = textureCorners[(i + 4 - rotation) & 3];
+		pUVs[i] = CIwSVec2(pCorner[0], pCorner[1]);
+	}
+
+	IwGxSetUVStream(pUVs);
+	IwGxSetColStream(NULL);
+	IwGxSetVertStreamScreenSpace(pVerts, 4);
+	IwGxDrawPrims(IW_GX_QUAD_LIST, NULL, 4);
 }
 
 //,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
@@ -187,12 +596,15 @@ void StopCamera() {
 
 //Callback called every time a camera preview frame is ready.
 //Information about the frame is extracted and buffers to copy the image data are (re)allocated if needed.
-//The camera preview frame rotated if needed during the copy and is finally uploaded to VRAM for rendering
+//The camera preview frame is cropped and converted to a full resolution grayscale frame for ZBar. If the last frame
+//changed visibly since the last upload it is also scaled down to the preview size in the same pass (and rotated on the
+//CPU only if g_rotatePreviewOnGpu is off) and uploaded to VRAM for rendering. Nothing is done while a QR code is shown.
 int32 CameraUpdateCallback(void* eventData, void* userData) {
 	if(g_CameraState == CAMERA_LOADING) { //First frame has now been received. Update CameraState.
 		g_CameraState = CAMERA_STREAMING;
+		StartupTimesMark(&g_startupTimes, STARTUP_FIRST_FRAME, ScanClockNs());
 		g_myNUIElements->pTextStatus->SetAttribute("caption", "Scanning for QR Code...");
-		s3eTimerSetTimer(g_qrScanTimeout, ScanQrCodeCallback, 0);
+		g_scanStartTime = ScanClockNs();
 	}
 	else if(g_CameraState != CAMERA_STREAMING)	//CameraState is either CAMERA_IDLE or CAMERA_UNAVAIALBE. Do not process CameraFrameData.
 		return 0;
@@ -201,18 +613,18 @@ int32 CameraUpdateCallback(void* eventData, void* userData) {
 	s3eCameraFrameData* CameraFrameData = (s3eCameraFrameData*)eventData;
 	uint frameWidth = CameraFrameData->m_Width;
 	uint frameHeight = CameraFrameData->m_Height;
-	uint frameResolution = frameWidth * frameHeight;
-	uint framePitch = CameraFrameData->m_Pitch;
+	uint framePitch = CameraFrameData->m_Pitch; //Row length in bytes
 	uint frameRotation = CameraFrameData->m_Rotation;
 	uint16* frameData = (uint16*)CameraFrameData->m_Data;
 
-	//Check if the camera pixel buffer has not been allocated or if the CameraFrameData has changed.
+	//Check if the camera pixel buffer has not been allocated or if the CameraFrameData size has changed. A rotation
+	//change alone keeps the crop size, so it needs no new buffers or textures.
 	if(g_pCameraTexelsRGB565 == NULL ||
-		frameResolution != g_frameResolution||
-		frameRotation != g_frameRotation) {
+		frameWidth != g_frameWidth ||
+		frameHeight != g_frameHeight) {
 		//Check the pixel format of the CameraFrameData.
-		if(CameraFrameData->m_PixelType != S3E_CAMERA_PIXEL_TYPE_RGB565_CONVERTED) {
-			IwTrace(]-->, ("CameraFrameData is not in RGB565 format."));
+		if(CameraFrameData->m_PixelType != g_cameraPixelType) {
+			IwTrace(]-->, ("CameraFrameData is not in the requested pixel format (%u).", g_cameraPixelType));
 			s3eDebugErrorShow(S3E_MESSAGE_CONTINUE, "Camera pixel format error.");
 			StopCamera();
 			g_CameraState = CAMERA_UNAVAILABLE;
@@ -226,116 +638,99 @@ int32 CameraUpdateCallback(void* eventData, void* userData) {
 		IwTrace(]-->, ("Camera raw preview rotation = %u", frameRotation));
 
 		//Calculate the the cropping dimensions depending on raw camera aspect ratio < or > 1.
-		if(frameWidth > frameHeight) {
-			g_cameraSquareDimension = frameHeight;
-			g_cameraCropXStart = (frameWidth - frameHeight) / 2;
-			g_cameraCropYStart = 0;
-		}
-		else {
-			g_cameraSquareDimension = frameWidth;
-			g_cameraCropXStart = 0;
-			g_cameraCropYStart = (frameHeight - frameWidth) / 2;
-		}
-
-		//Calculate buffer sizes and (re)allocate the buffers.
-		uint cameraGrayscaleBufferSize = g_cameraSquareDimension * g_cameraSquareDimension; //Size in bytes
-		uint cameraRGB565BufferSize = cameraGrayscaleBufferSize * 2;	//Size in bytes
-		g_pCameraTexelsRGB565 = (uint16*) s3eRealloc(g_pCameraTexelsRGB565, cameraRGB565BufferSize);
-		g_pCameraPixelsGrayscale = (uint8*) s3eRealloc(g_pCameraPixelsGrayscale, cameraGrayscaleBufferSize);
-		if(g_pCameraTexelsRGB565 == NULL || g_pCameraPixelsGrayscale == NULL) {
+		ComputeFrameCrop(frameWidth, frameHeight, &g_cameraCrop);
+
+		//Get the buffers for this size from the pool, which only allocates sizes it hasn't seen yet.
+		//The grayscale buffers are owned by g_pScanEngine.
+		g_previewDim = g_previewMaxDim && g_previewMaxDim < g_cameraCrop.dim ? g_previewMaxDim : g_cameraCrop.dim;
+		IwTrace(]-->, ("Camera preview size = %u (crop %u)", g_previewDim, g_cameraCrop.dim));
+		BufferPoolPut(&g_previewBufferPool, g_pCameraTexelsRGB565);
+		g_pCameraTexelsRGB565 = (uint16*)BufferPoolAcquire(&g_previewBufferPool, g_previewDim, g_previewDim, BUFFER_FORMAT_RGB565);
+		if(g_pCameraTexelsRGB565 == NULL) {
 			IwTrace(]-->, ("Not enough memory for camera preview buffers"));
 			s3eDebugErrorShow(S3E_MESSAGE_CONTINUE, "Not enough memory for camera.");
 			StopCamera();
 			return 0;
 		}
 
-		//Create a RGB565 texture using the RGB565 buffer for efficient rendering.
-		if (g_pCameraTextureRGB565 != NULL)
-			delete g_pCameraTextureRGB565;
-		g_pCameraTextureRGB565 = new CIwTexture;
-		g_pCameraTextureRGB565->SetModifiable(true);
-		g_pCameraTextureRGB565->SetMipMapping(false);
-		g_pCameraTextureRGB565->CopyFromBuffer(g_cameraSquareDimension, g_cameraSquareDimension,
-			CIwImage::RGB_565, g_cameraSquareDimension<<1, (uint8*)g_pCameraTexelsRGB565, NULL);
-		
-		// Initialize ZBar Image object:
-		if (g_pZBarScanner) {
-			if (g_pZBarImage)
-				zbar_image_destroy(g_pZBarImage);
-			g_pZBarImage = zbar_image_create();
-			if (g_pZBarImage) {
-				zbar_image_set_format(g_pZBarImage, *(unsigned long*)"Y800");
-				zbar_image_set_size(g_pZBarImage, g_cameraSquareDimension, g_cameraSquareDimension);
-				zbar_image_set_data(g_pZBarImage, g_pCameraPixelsGrayscale, cameraGrayscaleBufferSize, NULL);
-			}
-		}
+		//Use a ring of RGB565 textures of this size, filled from the RGB565 buffer, for efficient rendering.
+		g_ppPreviewTextures = SelectPreviewTextures(g_previewDim);
+		g_previewTexture = PREVIEW_TEXTURE_COUNT - 1; //The first upload goes to texture 0
+		g_havePreviewSignature = false; //Always upload the first frame
+		g_haveFrameSignature = false;
 	}
 	
 	//Copy current values to global variables (needed for above if statement)
-	g_frameResolution = frameResolution;
+	g_frameWidth = frameWidth;
+	g_frameHeight = frameHeight;
 	g_frameRotation = frameRotation;
+	if(g_pScanEngine)
+		++g_pScanEngine->stats.framesReceived;
+
+	CameraFrame frame;
+	frame.pData = frameData;
+	frame.width = frameWidth;
+	frame.height = frameHeight;
+	frame.pitch = framePitch;
+	frame.rotation = (FrameRotation)frameRotation;
+	frame.pixelType = g_cameraPixelType == S3E_CAMERA_PIXEL_TYPE_NV21 ? FRAME_PIXEL_NV21 :
+		(g_cameraPixelType == S3E_CAMERA_PIXEL_TYPE_NV12 ? FRAME_PIXEL_NV12 : FRAME_PIXEL_RGB565);
+
+	if(g_frameRecorder.pFile && !FrameRecorderWrite(&g_frameRecorder, &frame, ScanClockNs())) {
+		IwTrace(]-->, ("Camera recording write failed, recording stopped"));
+		FrameRecorderClose(&g_frameRecorder);
+	}
 
-	//Rotate and crop raw frameData buffer to g_pCameraTexelsRGB565 buffer. 
-	//The dest pointer (g_pCameraTexelsRGB565) is always copied to in the way a book is read (line by line).
-	//The src pointer (frameData) is copied from in a manner that accomplishes rotation (not necessarily like a book).
-	if(g_pCameraTextureRGB565) {
-		if(!g_qrCodeFound) { //Don't update the preview if a QR code was found.
-			uint16* src = &frameData[g_cameraCropXStart + (g_cameraCropYStart * frameWidth)]; //Source pointer adjusted for cropping
-			uint16* dest = g_pCameraTexelsRGB565; //Target destination pointer
-		
-			switch(frameRotation) {
-				case S3E_CAMERA_FRAME_ROTNORMAL: { //Perform no rotation. Just copy cropped area.
-					//Constant to adjust src 1 pixel to the down, g_cameraSquareDimension pixels left
-					const uint srcDelta = frameWidth - g_cameraSquareDimension; 
-
-					for(uint i = g_cameraSquareDimension; i; --i, src += srcDelta)
-						for(uint j = g_cameraSquareDimension; j; --j)
-							*dest++ = *src++;
-					break;
-				}
-				case S3E_CAMERA_FRAME_ROT90: { //Rotate 90 degrees CCW to correct orientation.
-					//Constant to adjust src 1 pixel to the left, g_cameraSquareDimension pixels up (by subtraction)
-					const uint srcDelta = 1 + g_cameraSquareDimension * frameWidth; 
-
-					//Start src at top right corner. Copy path is all the way down, then one to the left, all the way down, one to the left, etc.
-					src += g_cameraSquareDimension - 1; 
-
-					for(uint i = g_cameraSquareDimension; i; --i, src -= srcDelta) 
-						for(uint j = g_cameraSquareDimension; j; --j, src += frameWidth)
-							*dest++ = *src;
-					break;
-				}
-				case S3E_CAMERA_FRAME_ROT180: { //Rotate 180 degrees to correct orientation.
-					//Constant to adjust src 1 pixel to the up, g_cameraSquareDimension pixels to the right (by subtraction)
-					const uint srcDelta = frameWidth - g_cameraSquareDimension;
-
-					//Start src at bottom right corner. Copy path is all the way to the left, then one up, all the way left, one up, etc.
-					src += g_cameraSquareDimension * frameWidth - srcDelta;
-				
-					for(uint i = g_cameraSquareDimension; i; --i, src -= srcDelta) 
-						for(uint j = g_cameraSquareDimension; j; --j)
-							*dest++ = *src--;
-					break;
-				}
-				case S3E_CAMERA_FRAME_ROT270: { //Rotate 90 degrees CW to correct orientation.
-					//Constant to adjust src 1 pixel to the right, g_cameraSquareDimension pixels down
-					const uint srcDelta = 1 + g_cameraSquareDimension * frameWidth;
-
-					//Start src at bottom left corner. Copy path is all the way up, then one to the right, all the way up, one to the right, etc.
-					src += (g_cameraSquareDimension - 1) * frameWidth;
-
-					for(uint i = g_cameraSquareDimension; i; --i, src += srcDelta) 
-						for(uint j = g_cameraSquareDimension; j; --j, src -= frameWidth)
-							*dest++ = *src;
-					break;
-				}
-			}
-		}
-		
-		//Update the hardware texture buffer:
-		g_pCameraTextureRGB565->ChangeTexels((uint8*)g_pCameraTexelsRGB565, CIwImage::RGB_565); //Not sure why this is required. Same buffer every time...
-		g_pCameraTextureRGB565->Upload();
+	//DrawCameraPreview rotates the preview with its texture coordinates. ZBar finds codes in any orientation, so the
+	//grayscale scan frame doesn't need rotating either and the crop becomes a straight copy.
+	if(g_rotatePreviewOnGpu)
+		frame.rotation = FRAME_ROTNORMAL;
+
+	if(g_qrCodeFound || g_pScanEngine == NULL) //Don't update the preview if a QR code was found.
+		return 0;
+
+	//Grayscale pixels are written straight into the scan engine's frame ring and picked up by the scan worker.
+	FrameSlot* pScanFrame = ScanEngineBeginFrame(g_pScanEngine, g_cameraCrop.dim, g_cameraCrop.dim);
+	if(pScanFrame == NULL) {
+		IwTrace(]-->, ("Not enough memory for camera grayscale buffers"));
+		s3eDebugErrorShow(S3E_MESSAGE_CONTINUE, "Not enough memory for camera.");
+		StopCamera();
+		return 0;
+	}
+
+	//Crop the raw frameData buffer into the full resolution grayscale scan frame. The preview is made too, at the preview
+	//size into the g_pCameraTexelsRGB565 buffer, if the last frame's signature moved away from the last uploaded one: the
+	//camera frame is then read once for both (see PrepareCameraFrame). A change reaches the preview one frame late.
+	const uint64 prepareStart = ScanClockNs();
+	const bool previewChanged = !g_havePreviewSignature || !g_haveFrameSignature ||
+		FrameSignatureDifference(g_frameSignature, g_previewSignature) >= PREVIEW_CHANGE_THRESHOLD * SCAN_SIGNATURE_SIZE;
+	//The fused RGB565 pass rotates the scan frame and the scan only pass doesn't. Scan frames must keep one orientation for
+	//the signatures to compare, so a frame rotated on the CPU always gets the fused pass and only its upload is skipped.
+	const bool alwaysFused = frame.pixelType == FRAME_PIXEL_RGB565 && frame.rotation != FRAME_ROTNORMAL &&
+		g_previewDim == g_cameraCrop.dim;
+	PrepareCameraFrame(&frame, &g_cameraCrop, g_previewDim, previewChanged || alwaysFused ? g_pCameraTexelsRGB565 : NULL,
+		pScanFrame->pPixels);
+	ComputeFrameSignature(pScanFrame->pPixels, g_cameraCrop.dim, g_cameraCrop.dim, g_frameSignature);
+	g_haveFrameSignature = true;
+	ComputeFrameQuality(pScanFrame->pPixels, g_cameraCrop.dim, g_cameraCrop.dim, &pScanFrame->quality);
+	ScanStatsAddStage(&g_pScanEngine->stats, SCAN_STAGE_PREPARE, ScanClockNs() - prepareStart);
+	ScanEnginePublishFrame(g_pScanEngine, ScanClockNs()); //Wakes the scan worker up
+
+	if(!previewChanged) {
+		++g_pScanEngine->stats.previewsSkipped;
+		return 0;
 	}
+	memcpy(g_previewSignature, g_frameSignature, SCAN_SIGNATURE_SIZE);
+	g_havePreviewSignature = true;
+
+	//Update the hardware texture buffer. The texture written is the one drawn longest ago, which the GPU is done with.
+	const uint64 uploadStart = ScanClockNs();
+	const uint nextTexture = (g_previewTexture + 1) % PREVIEW_TEXTURE_COUNT;
+	g_ppPreviewTextures[nextTexture]->ChangeTexels((uint8*)g_pCameraTexelsRGB565, CIwImage::RGB_565); //Not sure why this is required. Same buffer every time...
+	g_ppPreviewTextures[nextTexture]->Upload();
+	g_previewTexture = nextTexture;
+	++g_pScanEngine->stats.previewsUploaded;
+	ScanStatsAddStage(&g_pScanEngine->stats, SCAN_STAGE_UPLOAD, ScanClockNs() - uploadStart);
 	return 0;
 }
 
@@ -345,52 +740,6 @@ int32 CameraStoppedCallback(void* eventData, void* userData) {
 	return 0;
 }
 
-//This callback is periodically called to scan the camera preview frame for QR codes.
-//It is necessary to convert the RGB565 camera preview pixels to YUV800 (grayscale) in order for ZBar to process the data
-int32 ScanQrCodeCallback(void* systemData, void* userData) {
-	if(!g_qrCodeFound && g_CameraState == CAMERA_STREAMING && g_pZBarImage) {
-		//Convert the RGB565 camera preview pixels to YUV800 (grayscale)
-		uint numPixels = g_cameraSquareDimension * g_cameraSquareDimension;
-		uint16* src = g_pCameraTexelsRGB565;
-		uint8* dest = g_pCameraPixelsGrayscale;
-
-		for(uint i = 0; i < numPixels; ++i, ++src) {
-			const uint8
-				r = ((*src)&0xf800)>>8,
-				g = ((*src)&0x07e0)>>3,
-				b = ((*src)&0x001f)<<3;
-			const int yuv800 = (77*r + 150*g + 29*b) >> 8;
-			*dest++ = (yuv800>255) ? 255 : ((yuv800<0) ? 0 : (uint8)yuv800);
-		}
-		
-		//Scan the grayscale converted image for QR codes
-		if(zbar_scan_image(g_pZBarScanner, g_pZBarImage)) {
-			const zbar_symbol_t *symbol = zbar_image_first_symbol(g_pZBarImage);
-
-			//Iterate through all symbols within the ZBar Image object
-			for(; symbol; symbol = zbar_symbol_next(symbol)) {
-				if (zbar_symbol_get_type(symbol) == ZBAR_QRCODE) { //Extract and print the QR code text
-					g_qrCodeFound = true;
-					IwTrace(]-->, ("QR code found!"));
-					const char* pQrData = zbar_symbol_get_data(symbol);
-					const unsigned int qrDataLength = zbar_symbol_get_data_length(symbol);
-					char qrString[512];
-					strcpy(qrString, "QR Code found: ");
-					strcat(qrString, pQrData);
-					g_myNUIElements->pTextStatus->SetAttribute("caption", qrString);
-					g_myNUIElements->pBtnScan->SetAttribute("enabled", "1");
-					
-					IwTrace(]-->, ("pQrData = %s", pQrData));
-					IwTrace(]-->, ("qrDataLength = %u", qrDataLength));
-				}
-			}
-		}
-
-	}
-	s3eTimerSetTimer(g_qrScanTimeout, ScanQrCodeCallback, 0); //Set the timer again as it only runs once
-	return 0;
-}
-
 
 
 //,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
@@ -399,6 +748,13 @@ int32 ScanQrCodeCallback(void* systemData, void* userData) {
 
 int main() {
 	IwTrace(]-->, ("ZBar Marmalade Demo App Started!"));
+	StartupTimesInit(&g_startupTimes, ScanClockNs());
+
+	//Create the ZBar scanner in the background while the UI is built
+	LoadScanProfile();
+	LoadCameraSettings();
+	OpenScanExport();
+	BeginScanEngineSetup();
 	
 	//Initialize Iw2D
 	Iw2DInit();
@@ -511,45 +867,90 @@ int main() {
     pApp->ShowWindow(pWindow);
     //pApp->Run(); //Begin NUI loop: pApp->Update() in main loop is used instead
 	
+	StartupTimesMark(&g_startupTimes, STARTUP_UI_BUILT, ScanClockNs());
+	
 	//Define red square dimensions
 	const CIwSVec2 cameraPreviewWH = CIwSVec2((const int)(screenW * 0.94), (const int)(screenW * 0.94));
 	const CIwSVec2 cameraPreviewXY = CIwSVec2((const int)(screenW * 0.03), (const int)(screenH * 0.22));
+	g_previewMaxDim = cameraPreviewWH.x;
+	BufferPoolInit(&g_previewBufferPool);
+
+	//Start the camera now rather than after the first pApp->Update(), which lays out the UI and loads its fonts: the
+	//camera opens while that happens. The preview rectangle doesn't depend on the UI layout.
+	StartCamera();
 
 	//Set colors
     IwGxSetColClear(0xff, 0xff, 0xff, 0xff); //Set IwGx to white
 	Iw2DSetColour(0xFF000088); // Set Iw2D to red
 
-	bool cameraInitialized = false;
-
 	while(!s3eDeviceCheckQuitRequest()) {
 		s3eKeyboardUpdate();
 
 		// Clear the surface
 		IwGxClear(IW_GX_COLOUR_BUFFER_F | IW_GX_DEPTH_BUFFER_F);
 
+		//Show any QR code found by the scan worker
+		ProcessScanResults();
+
 		//Render the camera preview
-		if(g_CameraState == CAMERA_STREAMING) { //Draw the camera preview
-			CIwMaterial* pMaterial = IW_GX_ALLOC_MATERIAL();
-			pMaterial->SetTexture(g_pCameraTextureRGB565);
-			pMaterial->SetColAmbient(0xffffffff);
-			IwGxSetMaterial(pMaterial);
-			IwGxDrawRectScreenSpace(&cameraPreviewXY, &cameraPreviewWH);
-		}
+		const bool previewDrawn = g_CameraState == CAMERA_STREAMING;
+		if(previewDrawn) //Draw the camera preview
+			DrawCameraPreview(cameraPreviewXY, cameraPreviewWH);
 		else //Draw a red rectangle
 			Iw2DFillRect(cameraPreviewXY, cameraPreviewWH);
 
+		//Scan statistics: overlay and a periodic trace dump
+		if(s3eKeyboardGetState(s3eKeyMenu) & S3E_KEY_STATE_PRESSED)
+			g_showScanStats = !g_showScanStats;
+		if(g_pScanEngine) {
+			//Cycle the frame enhancement (off, stretch, threshold) to compare their hit rates in the current lighting
+			if(s3eKeyboardGetState(s3eKeyE) & S3E_KEY_STATE_PRESSED) {
+				const ScanEnhanceMode enhance = (ScanEnhanceMode)((ScanEngineGetEnhance(g_pScanEngine) + 1) % SCAN_ENHANCE_COUNT);
+				ScanEngineSetEnhance(g_pScanEngine, enhance);
+				IwTrace(]-->, ("Scan enhancement: %s", ScanEnhanceModeName(enhance)));
+			}
+			//Toggle the quality gate, to check it saves decode time without delaying the first decode
+			if(s3eKeyboardGetState(s3eKeyG) & S3E_KEY_STATE_PRESSED) {
+				ScanEngineSetQualityGate(g_pScanEngine, !ScanEngineGetQualityGate(g_pScanEngine));
+				IwTrace(]-->, ("Scan quality gate: %s", ScanEngineGetQualityGate(g_pScanEngine) ? "on" : "off"));
+			}
+			//Toggle temporal denoising, to compare how soon a code decodes in a dim place with and without it
+			if(s3eKeyboardGetState(s3eKeyD) & S3E_KEY_STATE_PRESSED) {
+				ScanEngineSetDenoise(g_pScanEngine, !ScanEngineGetDenoise(g_pScanEngine));
+				IwTrace(]-->, ("Scan denoise: %s", ScanEngineGetDenoise(g_pScanEngine) ? "on" : "off"));
+			}
+			if(g_showScanStats) {
+				char statsText[1024];
+				ScanStatsFormat(&g_pScanEngine->stats, statsText, sizeof(statsText));
+				int lineY = cameraPreviewXY.y + 4;
+				for(char* pLine = strtok(statsText, "\n"); pLine; pLine = strtok(NULL, "\n"), lineY += 12)
+					IwGxPrintString(cameraPreviewXY.x + 4, lineY, pLine);
+				snprintf(statsText, sizeof(statsText), "allocs %u, enhance %s, gate %s, denoise %s", ScanAllocationCount(),
+					ScanEnhanceModeName(ScanEngineGetEnhance(g_pScanEngine)), ScanEngineGetQualityGate(g_pScanEngine) ? "on" : "off",
+					ScanEngineGetDenoise(g_pScanEngine) ? "on" : "off");
+				IwGxPrintString(cameraPreviewXY.x + 4, lineY, statsText);
+			}
+			UpdateCameraGovernor();
+			const uint64 now = ScanClockNs();
+			if(now - g_lastStatsTraceTime >= (uint64)g_statsTracePeriod * 1000000) {
+				g_lastStatsTraceTime = now;
+				TraceScanStats();
+			}
+		}
+
 		//Update the Native UI
 		pApp->Update(); //Calls IwGxFlush() & IwGxSwapBuffers() within
-		
-		//Allow NUI to render once before starting camera
-		if(!cameraInitialized) {
-			StartCamera();
-			cameraInitialized = true;
-		}
+		StartupTimesMark(&g_startupTimes, STARTUP_FIRST_RENDER, ScanClockNs());
+		if(previewDrawn && StartupTimesMark(&g_startupTimes, STARTUP_FIRST_PREVIEW, ScanClockNs()))
+			TraceStartupTimes();
 		
 		s3eDeviceYield();
 	}
 
+	if(g_CameraState == CAMERA_LOADING || g_CameraState == CAMERA_STREAMING)
+		StopCamera();
+	ReleaseCameraResources();
+
 	delete g_myNUIElements;
 
 	Iw2DTerminate();
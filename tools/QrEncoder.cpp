@@ -0,0 +1,299 @@
+#include "QrEncoder.h"
+
+#include <string.h>
+
+#define QR_MAX_EC_PER_BLOCK 30
+#define QR_MAX_CODEWORDS 346 //Version 10
+
+//Error correction block structure of a version and level: blocks1 blocks of data1 data codewords followed by blocks2
+//blocks of data1 + 1, each with ecPerBlock error correction codewords
+struct QrBlockLayout {
+	uint8 ecPerBlock;
+	uint8 blocks1, data1;
+	uint8 blocks2;
+};
+
+static const QrBlockLayout g_blockLayouts[QR_MAX_VERSION][QR_EC_COUNT] = {
+	//L                 M                 Q                 H
+	{ { 7, 1, 19, 0 },  { 10, 1, 16, 0 }, { 13, 1, 13, 0 }, { 17, 1, 9, 0 } },
+	{ { 10, 1, 34, 0 }, { 16, 1, 28, 0 }, { 22, 1, 22, 0 }, { 28, 1, 16, 0 } },
+	{ { 15, 1, 55, 0 }, { 26, 1, 44, 0 }, { 18, 2, 17, 0 }, { 22, 2, 13, 0 } },
+	{ { 20, 1, 80, 0 }, { 18, 2, 32, 0 }, { 26, 2, 24, 0 }, { 16, 4, 9, 0 } },
+	{ { 26, 1, 108, 0 }, { 24, 2, 43, 0 }, { 18, 2, 15, 2 }, { 22, 2, 11, 2 } },
+	{ { 18, 2, 68, 0 }, { 16, 4, 27, 0 }, { 24, 4, 19, 0 }, { 28, 4, 15, 0 } },
+	{ { 20, 2, 78, 0 }, { 18, 4, 31, 0 }, { 18, 2, 14, 4 }, { 26, 4, 13, 1 } },
+	{ { 24, 2, 97, 0 }, { 22, 2, 38, 2 }, { 22, 4, 18, 2 }, { 26, 4, 14, 2 } },
+	{ { 30, 2, 116, 0 }, { 22, 3, 36, 2 }, { 20, 4, 16, 4 }, { 24, 4, 12, 4 } },
+	{ { 18, 2, 68, 2 }, { 26, 4, 43, 1 }, { 24, 6, 19, 2 }, { 28, 6, 15, 2 } }
+};
+
+//Row and column centres of the alignment patterns, 0 terminated
+static const uint8 g_alignmentPositions[QR_MAX_VERSION][4] = {
+	{ 0 }, { 6, 18, 0 }, { 6, 22, 0 }, { 6, 26, 0 }, { 6, 30, 0 }, { 6, 34, 0 },
+	{ 6, 22, 38, 0 }, { 6, 24, 42, 0 }, { 6, 26, 46, 0 }, { 6, 28, 50, 0 }
+};
+
+static uint8 g_gfExp[510];
+static uint8 g_gfLog[256];
+static bool g_gfReady = false;
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//ERROR CORRECTION
+
+//GF(256) with the QR code polynomial x^8 + x^4 + x^3 + x^2 + 1
+static void InitGaloisField() {
+	uint x = 1;
+	for(uint i = 0; i < 255; ++i) {
+		g_gfExp[i] = g_gfExp[i + 255] = (uint8)x;
+		g_gfLog[x] = (uint8)i;
+		x <<= 1;
+		if(x & 0x100)
+			x ^= 0x11d;
+	}
+	g_gfReady = true;
+}
+
+static inline uint8 GfMultiply(uint8 a, uint8 b) {
+	return a && b ? g_gfExp[g_gfLog[a] + g_gfLog[b]] : 0;
+}
+
+//Reed-Solomon: pEc gets the ecCount codewords of the remainder of pData(x) * x^ecCount divided by the generator
+//(x - 1)(x - 2)...(x - 2^(ecCount - 1)).
+static void ComputeErrorCorrection(const uint8* pData, uint dataCount, uint ecCount, uint8* pEc) {
+	uint8 generator[QR_MAX_EC_PER_BLOCK]; //Coefficients from x^(ecCount - 1) down, without the leading 1
+	memset(generator, 0, ecCount);
+	generator[ecCount - 1] = 1;
+	uint8 root = 1;
+	for(uint i = 0; i < ecCount; ++i) {
+		for(uint j = 0; j < ecCount; ++j) {
+			generator[j] = GfMultiply(generator[j], root);
+			if(j + 1 < ecCount)
+				generator[j] ^= generator[j + 1];
+		}
+		root = GfMultiply(root, 2);
+	}
+
+	memset(pEc, 0, ecCount);
+	for(uint i = 0; i < dataCount; ++i) {
+		const uint8 factor = pData[i] ^ pEc[0];
+		memmove(pEc, pEc + 1, ecCount - 1);
+		pEc[ecCount - 1] = 0;
+		for(uint j = 0; j < ecCount; ++j)
+			pEc[j] ^= GfMultiply(generator[j], factor);
+	}
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//MODULE PLACEMENT
+
+static inline void SetFunctionModule(QrCode* pCode, uint8* pFunction, uint x, uint y, bool dark) {
+	pCode->modules[y * pCode->size + x] = dark ? 1 : 0;
+	pFunction[y * pCode->size + x] = 1;
+}
+
+//A finder pattern centred at cx, cy with its light separator, clipped to the symbol
+static void DrawFinder(QrCode* pCode, uint8* pFunction, int cx, int cy) {
+	for(int dy = -4; dy <= 4; ++dy) {
+		for(int dx = -4; dx <= 4; ++dx) {
+			const int x = cx + dx, y = cy + dy;
+			if(x < 0 || y < 0 || x >= (int)pCode->size || y >= (int)pCode->size)
+				continue;
+			const int ring = (dx < 0 ? -dx : dx) > (dy < 0 ? -dy : dy) ? (dx < 0 ? -dx : dx) : (dy < 0 ? -dy : dy);
+			SetFunctionModule(pCode, pFunction, x, y, ring != 2 && ring != 4);
+		}
+	}
+}
+
+static void DrawAlignment(QrCode* pCode, uint8* pFunction, int cx, int cy) {
+	for(int dy = -2; dy <= 2; ++dy) {
+		for(int dx = -2; dx <= 2; ++dx) {
+			const int ring = (dx < 0 ? -dx : dx) > (dy < 0 ? -dy : dy) ? (dx < 0 ? -dx : dx) : (dy < 0 ? -dy : dy);
+			SetFunctionModule(pCode, pFunction, cx + dx, cy + dy, ring != 1);
+		}
+	}
+}
+
+//Both copies of the 15 bit format information (level and mask, BCH protected and masked), and the dark module
+static void DrawFormat(QrCode* pCode, uint8* pFunction, QrEcLevel ecLevel, uint mask) {
+	static const uint ecBits[QR_EC_COUNT] = { 1, 0, 3, 2 };
+	const uint data = (ecBits[ecLevel] << 3) | mask;
+	uint remainder = data;
+	for(uint i = 0; i < 10; ++i)
+		remainder = (remainder << 1) ^ ((remainder >> 9) * 0x537);
+	const uint bits = ((data << 10) | remainder) ^ 0x5412;
+	const uint size = pCode->size;
+
+	//Around the top left finder
+	for(uint i = 0; i < 6; ++i)
+		SetFunctionModule(pCode, pFunction, 8, i, (bits >> i) & 1);
+	SetFunctionModule(pCode, pFunction, 8, 7, (bits >> 6) & 1);
+	SetFunctionModule(pCode, pFunction, 8, 8, (bits >> 7) & 1);
+	SetFunctionModule(pCode, pFunction, 7, 8, (bits >> 8) & 1);
+	for(uint i = 9; i < 15; ++i)
+		SetFunctionModule(pCode, pFunction, 14 - i, 8, (bits >> i) & 1);
+
+	//Split between the other two finders
+	for(uint i = 0; i < 8; ++i)
+		SetFunctionModule(pCode, pFunction, size - 1 - i, 8, (bits >> i) & 1);
+	for(uint i = 8; i < 15; ++i)
+		SetFunctionModule(pCode, pFunction, 8, size - 15 + i, (bits >> i) & 1);
+	SetFunctionModule(pCode, pFunction, 8, size - 8, true);
+}
+
+//Both copies of the 18 bit version information, versions 7 and up
+static void DrawVersion(QrCode* pCode, uint8* pFunction) {
+	if(pCode->version < 7)
+		return;
+	uint remainder = pCode->version;
+	for(uint i = 0; i < 12; ++i)
+		remainder = (remainder << 1) ^ ((remainder >> 11) * 0x1f25);
+	const uint bits = (pCode->version << 12) | remainder;
+	for(uint i = 0; i < 18; ++i) {
+		const bool dark = (bits >> i) & 1;
+		const uint a = pCode->size - 11 + i % 3, b = i / 3;
+		SetFunctionModule(pCode, pFunction, a, b, dark);
+		SetFunctionModule(pCode, pFunction, b, a, dark);
+	}
+}
+
+static void DrawFunctionPatterns(QrCode* pCode, uint8* pFunction, QrEcLevel ecLevel, uint mask) {
+	const uint size = pCode->size;
+	for(uint i = 0; i < size; ++i) {
+		SetFunctionModule(pCode, pFunction, 6, i, i % 2 == 0);
+		SetFunctionModule(pCode, pFunction, i, 6, i % 2 == 0);
+	}
+	DrawFinder(pCode, pFunction, 3, 3);
+	DrawFinder(pCode, pFunction, size - 4, 3);
+	DrawFinder(pCode, pFunction, 3, size - 4);
+
+	const uint8* pPositions = g_alignmentPositions[pCode->version - 1];
+	uint count = 0;
+	while(count < 4 && pPositions[count])
+		++count;
+	for(uint i = 0; i < count; ++i) {
+		for(uint j = 0; j < count; ++j) {
+			const bool nearFinder = (i == 0 && j == 0) || (i == 0 && j == count - 1) || (i == count - 1 && j == 0);
+			if(!nearFinder)
+				DrawAlignment(pCode, pFunction, pPositions[i], pPositions[j]);
+		}
+	}
+	DrawFormat(pCode, pFunction, ecLevel, mask);
+	DrawVersion(pCode, pFunction);
+}
+
+//Place the codewords in the two module wide columns zigzagging up and down from the bottom right, skipping the
+//vertical timing pattern, then apply the mask to everything but the function patterns.
+static void DrawCodewords(QrCode* pCode, const uint8* pFunction, const uint8* pCodewords, uint count, uint mask) {
+	const int size = (int)pCode->size;
+	uint bit = 0;
+	for(int right = size - 1; right >= 1; right -= 2) {
+		if(right == 6)
+			right = 5;
+		const bool upward = ((right + 1) & 2) == 0;
+		for(int vert = 0; vert < size; ++vert) {
+			const int y = upward ? size - 1 - vert : vert;
+			for(int j = 0; j < 2; ++j) {
+				const int x = right - j;
+				if(pFunction[y * size + x])
+					continue;
+				//Remainder bits past the last codeword stay light
+				const bool dark = bit < count * 8 && ((pCodewords[bit >> 3] >> (7 - (bit & 7))) & 1);
+				++bit;
+				bool invert;
+				switch(mask) {
+					case 0: invert = (x + y) % 2 == 0; break;
+					case 1: invert = y % 2 == 0; break;
+					case 2: invert = x % 3 == 0; break;
+					case 3: invert = (x + y) % 3 == 0; break;
+					case 4: invert = (x / 3 + y / 2) % 2 == 0; break;
+					case 5: invert = x * y % 2 + x * y % 3 == 0; break;
+					case 6: invert = (x * y % 2 + x * y % 3) % 2 == 0; break;
+					default: invert = ((x + y) % 2 + x * y % 3) % 2 == 0; break;
+				}
+				pCode->modules[y * size + x] = (dark != invert) ? 1 : 0;
+			}
+		}
+	}
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//ENCODING
+
+static void AppendBits(uint8* pBuffer, uint* pBitCount, uint value, uint length) {
+	for(int i = (int)length - 1; i >= 0; --i, ++*pBitCount) {
+		if((value >> i) & 1)
+			pBuffer[*pBitCount >> 3] |= (uint8)(0x80 >> (*pBitCount & 7));
+	}
+}
+
+const char* QrEcLevelName(QrEcLevel ecLevel) {
+	static const char* names[QR_EC_COUNT] = { "L", "M", "Q", "H" };
+	return ecLevel < QR_EC_COUNT ? names[ecLevel] : "?";
+}
+
+static uint DataCodewords(const QrBlockLayout* pLayout) {
+	return pLayout->blocks1 * pLayout->data1 + pLayout->blocks2 * (pLayout->data1 + 1);
+}
+
+uint QrByteCapacity(uint version, QrEcLevel ecLevel) {
+	if(version < 1 || version > QR_MAX_VERSION || ecLevel >= QR_EC_COUNT)
+		return 0;
+	const uint headerBits = 4 + (version < 10 ? 8 : 16); //Mode indicator and character count
+	return (DataCodewords(&g_blockLayouts[version - 1][ecLevel]) * 8 - headerBits) / 8;
+}
+
+bool QrEncode(QrCode* pCode, const uint8* pData, uint dataLength, uint version, QrEcLevel ecLevel, uint mask) {
+	if(mask >= QR_MASK_COUNT || dataLength > QrByteCapacity(version, ecLevel))
+		return false;
+	if(!g_gfReady)
+		InitGaloisField();
+	const QrBlockLayout* pLayout = &g_blockLayouts[version - 1][ecLevel];
+	const uint dataCount = DataCodewords(pLayout);
+
+	//Byte mode segment, terminator and padding
+	uint8 data[QR_MAX_CODEWORDS];
+	memset(data, 0, sizeof(data));
+	uint bitCount = 0;
+	AppendBits(data, &bitCount, 4, 4);
+	AppendBits(data, &bitCount, dataLength, version < 10 ? 8 : 16);
+	for(uint i = 0; i < dataLength; ++i)
+		AppendBits(data, &bitCount, pData[i], 8);
+	const uint capacityBits = dataCount * 8;
+	AppendBits(data, &bitCount, 0, capacityBits - bitCount < 4 ? capacityBits - bitCount : 4);
+	bitCount = (bitCount + 7) & ~7u;
+	for(uint8 pad = 0xec; bitCount < capacityBits; pad ^= 0xec ^ 0x11)
+		AppendBits(data, &bitCount, pad, 8);
+
+	//Split into blocks, add their error correction and interleave: the i-th data codeword of every block, then the i-th
+	//error correction codeword of every block
+	const uint blocks = pLayout->blocks1 + pLayout->blocks2;
+	uint8 ec[8][QR_MAX_EC_PER_BLOCK];
+	uint8 codewords[QR_MAX_CODEWORDS];
+	uint blockStart[8];
+	for(uint b = 0, start = 0; b < blocks; ++b) {
+		const uint length = pLayout->data1 + (b < pLayout->blocks1 ? 0 : 1);
+		blockStart[b] = start;
+		ComputeErrorCorrection(data + start, length, pLayout->ecPerBlock, ec[b]);
+		start += length;
+	}
+	uint count = 0;
+	for(uint i = 0; i <= pLayout->data1; ++i) {
+		for(uint b = 0; b < blocks; ++b) {
+			if(i < pLayout->data1 || b >= pLayout->blocks1)
+				codewords[count++] = data[blockStart[b] + i];
+		}
+	}
+	for(uint i = 0; i < pLayout->ecPerBlock; ++i) {
+		for(uint b = 0; b < blocks; ++b)
+			codewords[count++] = ec[b][i];
+	}
+
+	uint8 function[QR_MAX_SIZE * QR_MAX_SIZE];
+	pCode->version = version;
+	pCode->size = 17 + 4 * version;
+	memset(pCode->modules, 0, sizeof(pCode->modules));
+	memset(function, 0, sizeof(function));
+	DrawFunctionPatterns(pCode, function, ecLevel, mask);
+	DrawCodewords(pCode, function, codewords, count, mask);
+	return true;
+}
@@ -0,0 +1,37 @@
+#ifndef QR_ENCODER_H
+#define QR_ENCODER_H
+
+#include "ScanTypes.h"
+
+//Small QR code encoder for generating test codes on the host (see scansuite.cpp): byte mode only, versions 1 to
+//QR_MAX_VERSION, any error correction level. The mask is chosen by the caller instead of by the penalty rules, as any
+//mask decodes and a test corpus should cover all of them.
+
+#define QR_MAX_VERSION 10
+#define QR_MAX_SIZE (17 + 4 * QR_MAX_VERSION)
+#define QR_MASK_COUNT 8
+
+enum QrEcLevel {
+	QR_EC_L, //7% of the codewords can be restored
+	QR_EC_M, //15%
+	QR_EC_Q, //25%
+	QR_EC_H, //30%
+	QR_EC_COUNT
+};
+
+struct QrCode {
+	uint version;
+	uint size; //Modules per side, 17 + 4 * version
+	uint8 modules[QR_MAX_SIZE * QR_MAX_SIZE]; //size x size, row by row, 1 for dark. The quiet zone is not included.
+};
+
+const char* QrEcLevelName(QrEcLevel ecLevel);
+
+//Bytes of data that fit in a version at ecLevel, 0 if the version is not supported.
+uint QrByteCapacity(uint version, QrEcLevel ecLevel);
+
+//Encode dataLength bytes as a version, ecLevel, mask (0-7) code. Returns false if the version or mask is out of range or
+//the data doesn't fit.
+bool QrEncode(QrCode* pCode, const uint8* pData, uint dataLength, uint version, QrEcLevel ecLevel, uint mask);
+
+#endif
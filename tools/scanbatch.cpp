@@ -0,0 +1,538 @@
+//Decodes archives of still images (photographed labels) with the same grayscale conversion and ZBar setup as the app.
+//Every worker thread owns a ScanDecoder (ZBar scanner and image) and a share of the file list, and takes files from the
+//other workers' shares when its own runs out, so a few slow images don't leave the other cores idle at the end.
+//Results are streamed to stdout as JSON lines, one object per image, and a throughput summary goes to stderr.
+//
+//Usage: scanbatch [options] image...
+//  --list FILE      Also read image paths from FILE, one per line, - for stdin
+//  --threads N      Worker threads (default one per core)
+//  --mode M         full or pyramid (default pyramid)
+//  --symbols LIST   Symbologies to enable, as Symbologies in data/app.config.txt (default qrcode)
+//  --density N      Scan every N-th row and column (default 1)
+//  --raw WxH        Size of headerless 8 bit grayscale files. Files that don't start with a PGM or PPM header are
+//                   read as such.
+//  --scaling        Instead of printing results, decode the list with 1, 2, 4, ... up to --threads threads and print
+//                   images/s and scaling efficiency for each. The first pass also warms the file cache.
+//
+//Images are binary PGM (P5) or PPM (P6) with 8 bit samples, or raw Y800, at most 16384 pixels wide and high. PPM is
+//converted with the app's luma weights.
+
+#include "ScanPipeline.h"
+#include "ScanThread.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BATCH_MAX_THREADS 64
+#define BATCH_MAX_DIMENSION 16384 //Largest image width or height, as FRAME_FILE_MAX_DIMENSION for recorded frames
+
+struct BatchOptions {
+	uint threads;
+	ScanMode mode;
+	ScanProfile profile;
+	uint rawWidth, rawHeight; //0 if --raw wasn't given
+	bool scaling;
+};
+
+struct FileList {
+	char** ppPaths;
+	uint count, capacity;
+};
+
+//A worker's share of the file list: indices [next, end). The owner takes from the front, thieves take the back half.
+struct WorkQueue {
+	volatile int32 lock;
+	int32 next;
+	int32 end;
+	uint8 padding[64 - 3 * sizeof(int32)]; //One cache line per queue, so workers don't slow each other down
+};
+
+struct BatchContext {
+	const BatchOptions* pOptions;
+	const FileList* pFiles;
+	WorkQueue queues[BATCH_MAX_THREADS];
+	uint numWorkers;
+	bool printResults;
+};
+
+struct BatchWorker {
+	BatchContext* pContext;
+	uint index;
+	ScanThread* pThread;
+	ScanDecoder decoder;
+	uint8* pFileData; //Whole file as read
+	uint fileCapacity;
+	uint8* pGray; //Y800 image handed to ZBar
+	uint grayCapacity;
+	char* pLine; //JSON line being built
+	uint lineCapacity, lineLength;
+
+	uint images, decodedImages, failedImages, symbols;
+};
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//FUNCTIONS
+
+static void PrintUsage() {
+	printf("Usage: scanbatch [--list FILE] [--threads N] [--mode full|pyramid] [--symbols LIST] [--density N] [--raw WxH]\n"
+		"                 [--scaling] image...\n");
+}
+
+static bool AddPath(FileList* pFiles, const char* pPath) {
+	if(pFiles->count == pFiles->capacity) {
+		const uint capacity = pFiles->capacity ? pFiles->capacity * 2 : 1024;
+		char** ppPaths = (char**)realloc(pFiles->ppPaths, capacity * sizeof(char*));
+		if(ppPaths == NULL)
+			return false;
+		pFiles->ppPaths = ppPaths;
+		pFiles->capacity = capacity;
+	}
+	pFiles->ppPaths[pFiles->count] = strdup(pPath);
+	return pFiles->ppPaths[pFiles->count++] != NULL;
+}
+
+//Add every non-empty line of a list file. Returns false if it can't be read.
+static bool ReadList(FileList* pFiles, const char* pListPath) {
+	FILE* pFile = strcmp(pListPath, "-") == 0 ? stdin : fopen(pListPath, "r");
+	if(pFile == NULL)
+		return false;
+	char line[4096];
+	bool ok = true;
+	while(ok && fgets(line, sizeof(line), pFile)) {
+		size_t length = strlen(line);
+		while(length && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+			line[--length] = '\0';
+		if(length)
+			ok = AddPath(pFiles, line);
+	}
+	if(pFile != stdin)
+		fclose(pFile);
+	return ok;
+}
+
+//Returns false if an option is unknown or has a bad value.
+static bool ParseOptions(int argc, char** argv, BatchOptions* pOptions, FileList* pFiles) {
+	const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	pOptions->threads = cores > 0 ? (uint)cores : 1;
+	pOptions->mode = SCAN_MODE_PYRAMID;
+	ScanProfileSetDefault(&pOptions->profile, "batch");
+	pOptions->rawWidth = pOptions->rawHeight = 0;
+	pOptions->scaling = false;
+
+	for(int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		if(arg[0] != '-') {
+			if(!AddPath(pFiles, arg))
+				return false;
+			continue;
+		}
+		if(strcmp(arg, "--scaling") == 0) {
+			pOptions->scaling = true;
+			continue;
+		}
+		if(i + 1 >= argc)
+			return false;
+		const char* value = argv[++i];
+		if(strcmp(arg, "--list") == 0) {
+			if(!ReadList(pFiles, value)) {
+				fprintf(stderr, "Failed to read %s\n", value);
+				return false;
+			}
+		}
+		else if(strcmp(arg, "--threads") == 0)
+			pOptions->threads = (uint)atoi(value);
+		else if(strcmp(arg, "--mode") == 0) {
+			//Tracking carries a region from one frame to the next, which means nothing between unrelated images
+			if(!ScanModeFromName(value, &pOptions->mode) || pOptions->mode == SCAN_MODE_TRACKING)
+				return false;
+		}
+		else if(strcmp(arg, "--symbols") == 0) {
+			if(!ScanProfileSet(&pOptions->profile, "Symbologies", value))
+				return false;
+		}
+		else if(strcmp(arg, "--density") == 0) {
+			if(!ScanProfileSet(&pOptions->profile, "XDensity", value) || !ScanProfileSet(&pOptions->profile, "YDensity", value))
+				return false;
+		}
+		else if(strcmp(arg, "--raw") == 0) {
+			if(sscanf(value, "%ux%u", &pOptions->rawWidth, &pOptions->rawHeight) != 2 || pOptions->rawWidth == 0 ||
+				pOptions->rawHeight == 0 || pOptions->rawWidth > BATCH_MAX_DIMENSION || pOptions->rawHeight > BATCH_MAX_DIMENSION)
+				return false;
+		}
+		else
+			return false;
+	}
+	return pFiles->count > 0 && pOptions->threads > 0 && pOptions->threads <= BATCH_MAX_THREADS;
+}
+
+static void LockQueue(WorkQueue* pQueue) {
+	while(AtomicExchange(&pQueue->lock, 1) != 0)
+		sched_yield(); //The holder only does a few stores, but may have been preempted
+}
+
+static void UnlockQueue(WorkQueue* pQueue) {
+	AtomicStore(&pQueue->lock, 0);
+}
+
+//Get the next file index for worker index: the front of its own queue, or else the back half of the first other queue
+//that has files left, which becomes its own queue. Returns -1 when every queue is empty.
+static int32 TakeFile(BatchContext* pContext, uint index) {
+	WorkQueue* pOwn = &pContext->queues[index];
+	LockQueue(pOwn);
+	if(pOwn->next < pOwn->end) {
+		const int32 file = pOwn->next++;
+		UnlockQueue(pOwn);
+		return file;
+	}
+	UnlockQueue(pOwn);
+
+	for(uint i = 1; i < pContext->numWorkers; ++i) {
+		WorkQueue* pVictim = &pContext->queues[(index + i) % pContext->numWorkers];
+		LockQueue(pVictim);
+		const int32 remaining = pVictim->end - pVictim->next;
+		if(remaining <= 0) {
+			UnlockQueue(pVictim);
+			continue;
+		}
+		const int32 stolenEnd = pVictim->end, stolenStart = stolenEnd - (remaining + 1) / 2;
+		pVictim->end = stolenStart;
+		UnlockQueue(pVictim);
+
+		//Keep the first stolen file and put the rest in the own queue, where others may steal them again
+		LockQueue(pOwn);
+		pOwn->next = stolenStart + 1;
+		pOwn->end = stolenEnd;
+		UnlockQueue(pOwn);
+		return stolenStart;
+	}
+	return -1;
+}
+
+//Read a whole file into pWorker->pFileData. Returns its size, or -1 on failure.
+static long ReadFile(BatchWorker* pWorker, const char* pPath) {
+	FILE* pFile = fopen(pPath, "rb");
+	if(pFile == NULL)
+		return -1;
+	long size = -1;
+	if(fseek(pFile, 0, SEEK_END) == 0 && (size = ftell(pFile)) >= 0 && fseek(pFile, 0, SEEK_SET) == 0) {
+		if((uint)size > pWorker->fileCapacity) {
+			free(pWorker->pFileData);
+			pWorker->pFileData = (uint8*)malloc(size);
+			pWorker->fileCapacity = pWorker->pFileData ? (uint)size : 0;
+		}
+		if(pWorker->pFileData == NULL || fread(pWorker->pFileData, 1, size, pFile) != (size_t)size)
+			size = -1;
+	}
+	fclose(pFile);
+	return size;
+}
+
+//Read a number from a PNM header, skipping whitespace and # comments before it. Returns false at the end of the data.
+static bool ReadPnmNumber(const uint8* pData, long size, long* pOffset, uint* pValue) {
+	long offset = *pOffset;
+	for(;;) {
+		while(offset < size && (pData[offset] == ' ' || pData[offset] == '\t' || pData[offset] == '\r' || pData[offset] == '\n'))
+			++offset;
+		if(offset >= size || pData[offset] != '#')
+			break;
+		while(offset < size && pData[offset] != '\n')
+			++offset;
+	}
+	if(offset >= size || pData[offset] < '0' || pData[offset] > '9')
+		return false;
+	uint value = 0;
+	while(offset < size && pData[offset] >= '0' && pData[offset] <= '9' && value < 100000)
+		value = value * 10 + (pData[offset++] - '0');
+	*pOffset = offset;
+	*pValue = value;
+	return true;
+}
+
+//Load a PGM, PPM or raw Y800 image into pWorker->pGray. Returns NULL on success, otherwise what went wrong.
+static const char* LoadImage(BatchWorker* pWorker, const char* pPath, uint* pWidth, uint* pHeight) {
+	const BatchOptions* pOptions = pWorker->pContext->pOptions;
+	const long size = ReadFile(pWorker, pPath);
+	if(size < 0)
+		return "cannot read file";
+	const uint8* pData = pWorker->pFileData;
+
+	uint channels = 1, maxValue = 255;
+	long offset = 0;
+	if(size >= 2 && pData[0] == 'P' && (pData[1] == '5' || pData[1] == '6')) {
+		channels = pData[1] == '6' ? 3 : 1;
+		offset = 2;
+		if(!ReadPnmNumber(pData, size, &offset, pWidth) || !ReadPnmNumber(pData, size, &offset, pHeight) ||
+			!ReadPnmNumber(pData, size, &offset, &maxValue) || offset >= size)
+			return "bad PNM header";
+		++offset; //Single whitespace before the samples
+		if(maxValue == 0 || maxValue > 255)
+			return "only 8 bit PNM samples are supported";
+	}
+	else if(pOptions->rawWidth) {
+		*pWidth = pOptions->rawWidth;
+		*pHeight = pOptions->rawHeight;
+	}
+	else {
+		return "not a binary PGM or PPM file (use --raw WxH for raw Y800)";
+	}
+	if(*pWidth > BATCH_MAX_DIMENSION || *pHeight > BATCH_MAX_DIMENSION)
+		return "image too large";
+	const uint64 pixels = (uint64)*pWidth * *pHeight; //At most 2^28 once the sizes are checked
+	if(pixels == 0 || (uint64)(size - offset) < pixels * channels)
+		return "file too short for its size";
+
+	if(pixels > pWorker->grayCapacity) {
+		free(pWorker->pGray);
+		pWorker->pGray = (uint8*)malloc((size_t)pixels);
+		pWorker->grayCapacity = pWorker->pGray ? (uint)pixels : 0;
+		if(pWorker->pGray == NULL)
+			return "out of memory";
+	}
+	if(channels == 3)
+		ConvertRGB888ToY800(pData + offset, pWorker->pGray, (uint)pixels);
+	else
+		memcpy(pWorker->pGray, pData + offset, (size_t)pixels);
+	return NULL;
+}
+
+//Length of the well formed UTF-8 sequence at pText, which starts with a byte from 0x80 up, or 0 if it isn't one.
+static uint Utf8SequenceLength(const uint8* pText, uint length) {
+	const uint8 c = pText[0];
+	uint count = 0;
+	uint8 low = 0x80, high = 0xbf; //Range of the second byte, which rules out overlong forms, surrogates and > U+10FFFF
+	if(c >= 0xc2 && c <= 0xdf)
+		count = 2;
+	else if(c >= 0xe0 && c <= 0xef) {
+		count = 3;
+		if(c == 0xe0)
+			low = 0xa0;
+		else if(c == 0xed)
+			high = 0x9f;
+	}
+	else if(c >= 0xf0 && c <= 0xf4) {
+		count = 4;
+		if(c == 0xf0)
+			low = 0x90;
+		else if(c == 0xf4)
+			high = 0x8f;
+	}
+	if(count == 0 || count > length || pText[1] < low || pText[1] > high)
+		return 0;
+	for(uint i = 2; i < count; ++i) {
+		if(pText[i] < 0x80 || pText[i] > 0xbf)
+			return 0;
+	}
+	return count;
+}
+
+//Append length bytes to the worker's JSON line, escaped as the contents of a JSON string if escape is set. ZBar returns
+//UTF-8 text for most codes, which is copied as it is. Other bytes from 0x80 up (binary payloads, or text in another
+//encoding) are escaped as the Latin-1 characters they would be, so the line is always valid JSON.
+static void AppendJson(BatchWorker* pWorker, const char* pText, uint length, bool escape) {
+	if(pWorker->lineLength + length * 6 + 1 > pWorker->lineCapacity) {
+		const uint capacity = (pWorker->lineLength + length * 6 + 1) * 2;
+		char* pLine = (char*)realloc(pWorker->pLine, capacity);
+		if(pLine == NULL)
+			return;
+		pWorker->pLine = pLine;
+		pWorker->lineCapacity = capacity;
+	}
+	char* pOut = pWorker->pLine + pWorker->lineLength;
+	for(uint i = 0; i < length; ++i) {
+		const uint8 c = (uint8)pText[i];
+		if(!escape || (c >= 0x20 && c < 0x80 && c != '"' && c != '\\'))
+			*pOut++ = (char)c;
+		else if(c >= 0x80) {
+			const uint sequenceLength = Utf8SequenceLength((const uint8*)pText + i, length - i);
+			if(sequenceLength == 0)
+				pOut += sprintf(pOut, "\\u%04x", c);
+			else {
+				memcpy(pOut, pText + i, sequenceLength);
+				pOut += sequenceLength;
+				i += sequenceLength - 1;
+			}
+		}
+		else if(c == '"' || c == '\\') {
+			*pOut++ = '\\';
+			*pOut++ = (char)c;
+		}
+		else
+			pOut += sprintf(pOut, "\\u%04x", c);
+	}
+	*pOut = '\0';
+	pWorker->lineLength = (uint)(pOut - pWorker->pLine);
+}
+
+static void AppendText(BatchWorker* pWorker, const char* pText) {
+	AppendJson(pWorker, pText, (uint)strlen(pText), false);
+}
+
+//Decode one file and, when printing results, write its JSON line.
+static void ProcessFile(BatchWorker* pWorker, const char* pPath) {
+	const bool print = pWorker->pContext->printResults;
+	pWorker->lineLength = 0;
+	if(print) {
+		AppendText(pWorker, "{\"file\":\"");
+		AppendJson(pWorker, pPath, (uint)strlen(pPath), true);
+		AppendText(pWorker, "\",");
+	}
+	++pWorker->images;
+
+	uint width = 0, height = 0;
+	const char* pError = LoadImage(pWorker, pPath, &width, &height);
+	if(pError) {
+		++pWorker->failedImages;
+		if(print) {
+			AppendText(pWorker, "\"error\":\"");
+			AppendText(pWorker, pError);
+			AppendText(pWorker, "\"}\n");
+		}
+	}
+	else {
+		const uint64 startNs = ScanClockNs();
+		const int numSymbols = ScanDecoderScan(&pWorker->decoder, pWorker->pGray, width, height);
+		const uint64 decodeNs = ScanClockNs() - startNs;
+		if(numSymbols > 0)
+			++pWorker->decodedImages;
+		if(print) {
+			char text[96];
+			snprintf(text, sizeof(text), "\"width\":%u,\"height\":%u,\"decode_ms\":%.3f,\"symbols\":[", width, height, decodeNs / 1e6);
+			AppendText(pWorker, text);
+		}
+		const zbar_symbol_t* pSymbol = numSymbols > 0 ? ScanDecoderFirstSymbol(&pWorker->decoder) : NULL;
+		for(uint i = 0; pSymbol; pSymbol = zbar_symbol_next(pSymbol), ++i) {
+			++pWorker->symbols;
+			if(!print)
+				continue;
+			AppendText(pWorker, i ? ",{\"type\":\"" : "{\"type\":\"");
+			AppendText(pWorker, zbar_get_symbol_name(zbar_symbol_get_type(pSymbol)));
+			AppendText(pWorker, "\",\"data\":\"");
+			AppendJson(pWorker, zbar_symbol_get_data(pSymbol), zbar_symbol_get_data_length(pSymbol), true);
+			AppendText(pWorker, "\"}");
+		}
+		if(print)
+			AppendText(pWorker, "]}\n");
+	}
+
+	//One fwrite per line: stdio locks the stream for the call, so lines from different workers never interleave
+	if(print)
+		fwrite(pWorker->pLine, 1, pWorker->lineLength, stdout);
+}
+
+static void* BatchWorkerThread(void* pArg) {
+	BatchWorker* pWorker = (BatchWorker*)pArg;
+	BatchContext* pContext = pWorker->pContext;
+	int32 file;
+	while((file = TakeFile(pContext, pWorker->index)) >= 0)
+		ProcessFile(pWorker, pContext->pFiles->ppPaths[file]);
+	return NULL;
+}
+
+//Decode every file with numWorkers threads. Returns the wall clock time in ns, or 0 if the workers couldn't start.
+static uint64 RunBatch(BatchContext* pContext, BatchWorker* pWorkers, uint numWorkers) {
+	const int32 count = (int32)pContext->pFiles->count;
+	pContext->numWorkers = numWorkers;
+	for(uint i = 0; i < numWorkers; ++i) {
+		WorkQueue* pQueue = &pContext->queues[i];
+		pQueue->lock = 0;
+		pQueue->next = (int32)((int64)count * i / numWorkers);
+		pQueue->end = (int32)((int64)count * (i + 1) / numWorkers);
+		BatchWorker* pWorker = &pWorkers[i];
+		pWorker->images = pWorker->decodedImages = pWorker->failedImages = pWorker->symbols = 0;
+	}
+
+	const uint64 startNs = ScanClockNs();
+	bool started = true;
+	for(uint i = 0; i < numWorkers; ++i) {
+		pWorkers[i].pThread = ScanThreadCreate(BatchWorkerThread, &pWorkers[i]);
+		started = started && pWorkers[i].pThread != NULL;
+	}
+	for(uint i = 0; i < numWorkers; ++i) {
+		if(pWorkers[i].pThread)
+			ScanThreadJoin(pWorkers[i].pThread);
+	}
+	return started ? ScanClockNs() - startNs : 0;
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//MAIN FUNCTION
+
+int main(int argc, char** argv) {
+	static BatchContext context;
+	static BatchWorker workers[BATCH_MAX_THREADS];
+	BatchOptions options;
+	FileList files = { NULL, 0, 0 };
+	if(!ParseOptions(argc, argv, &options, &files)) {
+		PrintUsage();
+		return 1;
+	}
+
+	context.pOptions = &options;
+	context.pFiles = &files;
+	for(uint i = 0; i < options.threads; ++i) {
+		workers[i].pContext = &context;
+		workers[i].index = i;
+		if(!ScanDecoderInit(&workers[i].decoder, options.mode, &options.profile)) {
+			fprintf(stderr, "Failed to create the ZBar scanner\n");
+			return 1;
+		}
+	}
+	char settings[256];
+	ScanProfileFormat(&options.profile, settings, sizeof(settings));
+	fprintf(stderr, "%u images, %u threads, mode %s, %s\n", files.count, options.threads, ScanModeName(options.mode), settings);
+
+	int result = 0;
+	if(options.scaling) {
+		//1, 2, 4, ... threads and finally options.threads. Efficiency is the speedup over one thread divided by the threads.
+		context.printResults = false;
+		printf("%8s %12s %9s %11s\n", "threads", "images/s", "speedup", "efficiency");
+		double singleRate = 0.0;
+		for(uint threads = 1;; threads = threads * 2 < options.threads ? threads * 2 : options.threads) {
+			const uint64 ns = RunBatch(&context, workers, threads);
+			if(ns == 0) {
+				fprintf(stderr, "Failed to start %u threads\n", threads);
+				result = 1;
+				break;
+			}
+			const double rate = files.count * 1e9 / ns;
+			singleRate = threads == 1 ? rate : singleRate;
+			printf("%8u %12.1f %8.2fx %10.1f%%\n", threads, rate, rate / singleRate, 100.0 * rate / singleRate / threads);
+			fflush(stdout);
+			if(threads == options.threads)
+				break;
+		}
+	}
+	else {
+		context.printResults = true;
+		const uint64 ns = RunBatch(&context, workers, options.threads);
+		fflush(stdout);
+		uint decoded = 0, failed = 0, symbols = 0;
+		for(uint i = 0; i < options.threads; ++i) {
+			decoded += workers[i].decodedImages;
+			failed += workers[i].failedImages;
+			symbols += workers[i].symbols;
+		}
+		if(ns == 0) {
+			fprintf(stderr, "Failed to start the worker threads\n");
+			result = 1;
+		}
+		else {
+			fprintf(stderr, "%u images in %.2f s: %.1f images/s, %u decoded (%u symbols), %u unreadable\n", files.count, ns / 1e9,
+				files.count * 1e9 / ns, decoded, symbols, failed);
+		}
+	}
+
+	for(uint i = 0; i < options.threads; ++i) {
+		ScanDecoderRelease(&workers[i].decoder);
+		free(workers[i].pFileData);
+		free(workers[i].pGray);
+		free(workers[i].pLine);
+	}
+	for(uint i = 0; i < files.count; ++i)
+		free(files.ppPaths[i]);
+	free(files.ppPaths);
+	return result;
+}
@@ -0,0 +1,372 @@
+//Host benchmark for the camera frame to decode path (ScanPipeline). Builds synthetic camera frames of any size, pitch,
+//rotation and pixel type, optionally with a PGM image (e.g. a photographed QR code) in the middle, runs them through
+//PrepareCameraFrame and ScanDecoderScan and reports the time per stage and how many frames decoded. For NV21/NV12 frames
+//"luma copy" is the part of prepare that copies the luma crop out of the camera frame for the scan worker.
+//
+//Usage: scanbench [options] [image.pgm]
+//  --width N        Camera frame width (default 640)
+//  --height N       Camera frame height (default 480)
+//  --pitch N        Row length in bytes, 0 for no padding (default 0)
+//  --rotation N     0, 90, 180 or 270 (default 90)
+//  --format F       rgb565, nv21 or nv12 (default nv21)
+//  --mode M         full, pyramid or tracking (default pyramid)
+//  --enhance M      off, stretch or threshold: frame enhancement before the scan (default off)
+//  --contrast F     Scale every gray level's distance from mid gray by F to simulate low light (default 1)
+//  --glare N        Add a left to right illumination ramp from -N to +N gray levels (default 0)
+//  --fill F         Fraction of the crop square the image covers (default 0.6)
+//  --preview N      Preview size in pixels, at most the crop size, 0 for the crop size (default 0)
+//  --frames N       Number of different frames cycled through (default 4)
+//  --warmup N       Untimed iterations before measuring (default 10)
+//  --repeat N       Timed iterations (default 100)
+
+#include "BufferPool.h"
+#include "ScanEnhance.h"
+#include "ScanPipeline.h"
+#include "ScanThread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct BenchOptions {
+	uint width, height, pitch;
+	FrameRotation rotation;
+	FramePixelType pixelType;
+	ScanMode mode;
+	ScanEnhanceMode enhance;
+	float contrast;
+	int glare;
+	float fill;
+	uint previewDim;
+	uint frames, warmup, repeat;
+	const char* pImagePath;
+};
+
+struct GrayImage {
+	uint8* pPixels;
+	uint width, height;
+};
+
+struct StageTime {
+	uint64 totalNs;
+	uint64 minNs;
+};
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//FUNCTIONS
+
+static void PrintUsage() {
+	printf("Usage: scanbench [--width N] [--height N] [--pitch N] [--rotation 0|90|180|270] [--format rgb565|nv21|nv12]\n"
+		"                 [--mode full|pyramid|tracking] [--enhance off|stretch|threshold] [--contrast F] [--glare N]\n"
+		"                 [--fill F] [--preview N] [--frames N] [--warmup N] [--repeat N] [image.pgm]\n");
+}
+
+//Returns false if an option is unknown or has a bad value.
+static bool ParseOptions(int argc, char** argv, BenchOptions* pOptions) {
+	pOptions->width = 640;
+	pOptions->height = 480;
+	pOptions->pitch = 0;
+	pOptions->rotation = FRAME_ROT90;
+	pOptions->pixelType = FRAME_PIXEL_NV21;
+	pOptions->mode = SCAN_MODE_PYRAMID;
+	pOptions->enhance = SCAN_ENHANCE_OFF;
+	pOptions->contrast = 1.0f;
+	pOptions->glare = 0;
+	pOptions->fill = 0.6f;
+	pOptions->previewDim = 0;
+	pOptions->frames = 4;
+	pOptions->warmup = 10;
+	pOptions->repeat = 100;
+	pOptions->pImagePath = NULL;
+
+	for(int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		if(arg[0] != '-') {
+			pOptions->pImagePath = arg;
+			continue;
+		}
+		if(i + 1 >= argc)
+			return false;
+		const char* value = argv[++i];
+		if(strcmp(arg, "--width") == 0)
+			pOptions->width = (uint)atoi(value);
+		else if(strcmp(arg, "--height") == 0)
+			pOptions->height = (uint)atoi(value);
+		else if(strcmp(arg, "--pitch") == 0)
+			pOptions->pitch = (uint)atoi(value);
+		else if(strcmp(arg, "--rotation") == 0) {
+			const int degrees = atoi(value);
+			if(degrees % 90 != 0 || degrees < 0 || degrees > 270)
+				return false;
+			pOptions->rotation = (FrameRotation)(degrees / 90);
+		}
+		else if(strcmp(arg, "--format") == 0) {
+			if(strcmp(value, "rgb565") == 0)
+				pOptions->pixelType = FRAME_PIXEL_RGB565;
+			else if(strcmp(value, "nv21") == 0)
+				pOptions->pixelType = FRAME_PIXEL_NV21;
+			else if(strcmp(value, "nv12") == 0)
+				pOptions->pixelType = FRAME_PIXEL_NV12;
+			else
+				return false;
+		}
+		else if(strcmp(arg, "--mode") == 0) {
+			if(!ScanModeFromName(value, &pOptions->mode))
+				return false;
+		}
+		else if(strcmp(arg, "--enhance") == 0) {
+			if(!ScanEnhanceModeFromName(value, &pOptions->enhance))
+				return false;
+		}
+		else if(strcmp(arg, "--contrast") == 0)
+			pOptions->contrast = (float)atof(value);
+		else if(strcmp(arg, "--glare") == 0)
+			pOptions->glare = atoi(value);
+		else if(strcmp(arg, "--fill") == 0)
+			pOptions->fill = (float)atof(value);
+		else if(strcmp(arg, "--preview") == 0)
+			pOptions->previewDim = (uint)atoi(value);
+		else if(strcmp(arg, "--frames") == 0)
+			pOptions->frames = (uint)atoi(value);
+		else if(strcmp(arg, "--warmup") == 0)
+			pOptions->warmup = (uint)atoi(value);
+		else if(strcmp(arg, "--repeat") == 0)
+			pOptions->repeat = (uint)atoi(value);
+		else
+			return false;
+	}
+	const uint bytesPerPixel = pOptions->pixelType == FRAME_PIXEL_RGB565 ? 2 : 1;
+	if(pOptions->pitch == 0)
+		pOptions->pitch = pOptions->width * bytesPerPixel;
+	return pOptions->width >= 2 && pOptions->height >= 2 && pOptions->pitch >= pOptions->width * bytesPerPixel &&
+		pOptions->fill > 0.0f && pOptions->fill <= 1.0f && pOptions->contrast > 0.0f && pOptions->glare >= 0 &&
+		pOptions->frames > 0 && pOptions->repeat > 0;
+}
+
+//Skip whitespace and # comments in a PGM header.
+static void SkipPgmSpace(FILE* pFile) {
+	int c;
+	while((c = fgetc(pFile)) != EOF) {
+		if(c == '#') {
+			while((c = fgetc(pFile)) != EOF && c != '\n') {}
+		}
+		else if(c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+			ungetc(c, pFile);
+			return;
+		}
+	}
+}
+
+//Load a binary (P5) 8 bit PGM file. Returns false on failure.
+static bool LoadPgm(const char* pPath, GrayImage* pImage) {
+	FILE* pFile = fopen(pPath, "rb");
+	if(pFile == NULL)
+		return false;
+	uint maxValue = 0;
+	bool ok = fgetc(pFile) == 'P' && fgetc(pFile) == '5';
+	SkipPgmSpace(pFile);
+	ok = ok && fscanf(pFile, "%u", &pImage->width) == 1;
+	SkipPgmSpace(pFile);
+	ok = ok && fscanf(pFile, "%u", &pImage->height) == 1;
+	SkipPgmSpace(pFile);
+	ok = ok && fscanf(pFile, "%u", &maxValue) == 1 && maxValue > 0 && maxValue < 256 && fgetc(pFile) != EOF;
+	if(ok) {
+		const size_t size = (size_t)pImage->width * pImage->height;
+		pImage->pPixels = (uint8*)malloc(size);
+		ok = pImage->pPixels && fread(pImage->pPixels, 1, size, pFile) == size;
+	}
+	fclose(pFile);
+	return ok;
+}
+
+//Build frame number index: a noisy mid gray background with the image scaled (nearest neighbour) to fill the centre,
+//then the --contrast and --glare lighting. Each frame shifts the image by one pixel so consecutive frames differ.
+static uint8* CreateFrame(const BenchOptions* pOptions, const FrameCrop* pCrop, const GrayImage* pImage, uint index) {
+	const bool yuvFrame = pOptions->pixelType != FRAME_PIXEL_RGB565;
+	const uint lumaSize = pOptions->pitch * pOptions->height;
+	uint8* pFrame = (uint8*)malloc(yuvFrame ? lumaSize + lumaSize / 2 : lumaSize);
+	if(pFrame == NULL)
+		return NULL;
+
+	//Placement of the image
+	uint imageW = 0, imageH = 0, imageX = 0, imageY = 0;
+	if(pImage->pPixels) {
+		const float scale = pOptions->fill * pCrop->dim / (float)(pImage->width > pImage->height ? pImage->width : pImage->height);
+		imageW = (uint)(pImage->width * scale);
+		imageH = (uint)(pImage->height * scale);
+		imageX = (pOptions->width - imageW) / 2 + index;
+		imageY = (pOptions->height - imageH) / 2;
+	}
+
+	uint32 noise = 12345 + index;
+	for(uint y = 0; y < pOptions->height; ++y) {
+		uint8* pLumaRow = pFrame + y * pOptions->pitch;
+		for(uint x = 0; x < pOptions->width; ++x) {
+			noise = noise * 1664525 + 1013904223;
+			uint8 gray = (uint8)(120 + (noise >> 28));
+			if(x >= imageX && x < imageX + imageW && y >= imageY && y < imageY + imageH)
+				gray = pImage->pPixels[(y - imageY) * pImage->height / imageH * pImage->width + (x - imageX) * pImage->width / imageW];
+			const int lit = 128 + (int)((gray - 128) * pOptions->contrast) +
+				pOptions->glare * (int)(2 * x) / (int)pOptions->width - pOptions->glare;
+			gray = (uint8)(lit < 0 ? 0 : (lit > 255 ? 255 : lit));
+			if(yuvFrame)
+				pLumaRow[x] = gray;
+			else
+				((uint16*)pLumaRow)[x] = (uint16)(((gray & 0xf8) << 8) | ((gray & 0xfc) << 3) | (gray >> 3));
+		}
+	}
+	if(yuvFrame)
+		memset(pFrame + lumaSize, 128, lumaSize / 2); //No colour
+	return pFrame;
+}
+
+static void AddStageTime(StageTime* pTime, uint64 ns) {
+	pTime->totalNs += ns;
+	if(pTime->minNs == 0 || ns < pTime->minNs)
+		pTime->minNs = ns;
+}
+
+static void PrintStageTime(const char* pName, const StageTime* pTime, uint repeat) {
+	printf("%-10s %12llu %12llu\n", pName, (unsigned long long)(pTime->totalNs / repeat), (unsigned long long)pTime->minNs);
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//MAIN FUNCTION
+
+int main(int argc, char** argv) {
+	BenchOptions options;
+	if(!ParseOptions(argc, argv, &options)) {
+		PrintUsage();
+		return 1;
+	}
+
+	GrayImage image = { NULL, 0, 0 };
+	if(options.pImagePath && !LoadPgm(options.pImagePath, &image)) {
+		fprintf(stderr, "Failed to load %s (only binary 8 bit PGM is supported)\n", options.pImagePath);
+		return 1;
+	}
+
+	FrameCrop crop;
+	ComputeFrameCrop(options.width, options.height, &crop);
+	uint8** ppFrames = (uint8**)calloc(options.frames, sizeof(uint8*));
+	for(uint i = 0; i < options.frames; ++i) {
+		ppFrames[i] = CreateFrame(&options, &crop, &image, i);
+		if(ppFrames[i] == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			return 1;
+		}
+	}
+	if(options.previewDim == 0 || options.previewDim > crop.dim)
+		options.previewDim = crop.dim;
+	uint16* pPreview = (uint16*)malloc(options.previewDim * options.previewDim * sizeof(uint16));
+	uint8* pGray = (uint8*)malloc(crop.dim * crop.dim);
+
+	ScanDecoder decoder;
+	ScanEnhancer enhancer;
+	ScanEnhancerInit(&enhancer);
+	if(pPreview == NULL || pGray == NULL || !ScanDecoderInit(&decoder, options.mode, NULL)) {
+		fprintf(stderr, "Failed to set up the decoder\n");
+		return 1;
+	}
+
+	const char* pixelTypeNames[] = { "rgb565", "nv21", "nv12" };
+	printf("%ux%u pitch %u %s rotation %u, crop %ux%u, preview %ux%u, mode %s, enhance %s, kernels %s, %u warmup + %u timed iterations\n",
+		options.width, options.height, options.pitch, pixelTypeNames[options.pixelType], options.rotation * 90, crop.dim, crop.dim,
+		options.previewDim, options.previewDim, ScanModeName(options.mode), ScanEnhanceModeName(options.enhance),
+		FrameKernelsVariant(), options.warmup, options.repeat);
+	if(options.contrast != 1.0f || options.glare)
+		printf("lighting: contrast %.2f, glare +-%d\n", options.contrast, options.glare);
+
+	const bool yuvFrame = options.pixelType != FRAME_PIXEL_RGB565;
+	StageTime prepareTime = { 0, 0 }, copyTime = { 0, 0 }, enhanceTime = { 0, 0 }, decodeTime = { 0, 0 }, totalTime = { 0, 0 };
+	uint decodedFrames = 0;
+	uint32 warmupAllocations = 0; //ScanAllocationCount() when the timed iterations start
+	char firstData[256] = ""; //Payload of the first symbol found, truncated
+
+	for(uint i = 0; i < options.warmup + options.repeat; ++i) {
+		if(i == options.warmup)
+			warmupAllocations = ScanAllocationCount();
+		CameraFrame frame;
+		frame.pData = ppFrames[i % options.frames];
+		frame.width = options.width;
+		frame.height = options.height;
+		frame.pitch = options.pitch;
+		frame.rotation = options.rotation;
+		frame.pixelType = options.pixelType;
+
+		const uint64 startNs = ScanClockNs();
+		uint64 copiedNs = startNs;
+		if(yuvFrame) {
+			//The luma crop is copied in its own pass anyway: time it alone, as it is what scanning in place would save
+			PrepareCameraFrame(&frame, &crop, options.previewDim, NULL, pGray);
+			copiedNs = ScanClockNs();
+			PrepareCameraFrame(&frame, &crop, options.previewDim, pPreview, NULL);
+		}
+		else
+			PrepareCameraFrame(&frame, &crop, options.previewDim, pPreview, pGray);
+		const uint64 preparedNs = ScanClockNs();
+		if(!ScanEnhance(&enhancer, options.enhance, pGray, crop.dim, crop.dim)) {
+			fprintf(stderr, "Out of memory\n");
+			return 1;
+		}
+		const uint64 enhancedNs = ScanClockNs();
+		const int numSymbols = ScanDecoderScan(&decoder, pGray, crop.dim, crop.dim);
+		const zbar_symbol_t* pSymbol = numSymbols > 0 ? ScanDecoderFirstSymbol(&decoder) : NULL;
+		if(pSymbol && firstData[0] == '\0')
+			snprintf(firstData, sizeof(firstData), "%s", zbar_symbol_get_data(pSymbol));
+		const uint64 endNs = ScanClockNs();
+
+		if(i < options.warmup)
+			continue;
+		AddStageTime(&prepareTime, preparedNs - startNs);
+		AddStageTime(&copyTime, copiedNs - startNs);
+		AddStageTime(&enhanceTime, enhancedNs - preparedNs);
+		AddStageTime(&decodeTime, endNs - enhancedNs);
+		AddStageTime(&totalTime, endNs - startNs);
+		if(numSymbols > 0)
+			++decodedFrames;
+	}
+
+	printf("%-10s %12s %12s\n", "stage", "mean ns", "min ns");
+	PrintStageTime("prepare", &prepareTime, options.repeat);
+	if(yuvFrame)
+		PrintStageTime("luma copy", &copyTime, options.repeat);
+	if(options.enhance != SCAN_ENHANCE_OFF)
+		PrintStageTime("enhance", &enhanceTime, options.repeat);
+	PrintStageTime("decode", &decodeTime, options.repeat);
+	PrintStageTime("total", &totalTime, options.repeat);
+	printf("%.1f frames/s\n", 1e9 * options.repeat / (double)totalTime.totalNs);
+	printf("heap allocations: %u during warmup, %u during the timed iterations\n", warmupAllocations,
+		ScanAllocationCount() - warmupAllocations);
+	printf("decoded %u/%u frames (%.1f%%)", decodedFrames, options.repeat, 100.0 * decodedFrames / options.repeat);
+	if(firstData[0])
+		printf(": \"%s\"", firstData);
+	printf("\n");
+
+	if(options.mode == SCAN_MODE_TRACKING) {
+		const ScanTracker& tracker = decoder.tracker;
+		printf("tracking: %u region scans, %u hit, %u full scans, %.1f%% of the pixels scanned\n", tracker.regionScans,
+			tracker.regionHits, tracker.fullScans,
+			100.0 * (tracker.regionPixels + tracker.fullPixels) / ((double)crop.dim * crop.dim * (options.warmup + options.repeat)));
+	}
+	if(decoder.pyramid.frames) {
+		const ScanPyramid& pyramid = decoder.pyramid;
+		const char* attemptNames[SCAN_ATTEMPT_COUNT] = { "full", "half", "quarter", "crop" };
+		printf("pyramid build %llu ns/frame\n", (unsigned long long)(pyramid.buildNs / pyramid.frames));
+		for(uint i = 0; i < SCAN_ATTEMPT_COUNT; ++i) {
+			const ScanAttemptStats& stats = pyramid.stats[i];
+			printf("pyramid %-8s %6u attempts %6u decoded %12llu ns/attempt\n", attemptNames[i], stats.attempts, stats.decoded,
+				(unsigned long long)(stats.attempts ? stats.totalNs / stats.attempts : 0));
+		}
+	}
+
+	ScanDecoderRelease(&decoder);
+	ScanEnhancerRelease(&enhancer);
+	for(uint i = 0; i < options.frames; ++i)
+		free(ppFrames[i]);
+	free(ppFrames);
+	free(pPreview);
+	free(pGray);
+	free(image.pPixels);
+	return 0;
+}
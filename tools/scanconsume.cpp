@@ -0,0 +1,289 @@
+//Reads the results a scan engine writes to a ScanExport ring (see ScanExport.h) from another process, the way a host
+//integration would: maps the export file, polls it and prints every record with its location, the latency from the
+//frame's capture to its decode, and the delivery latency from the end of the decode to this reader seeing it. The
+//summary gives the records read and missed and the delivery latency percentiles.
+//
+//Usage: scanconsume [options] export.file
+//  --wait S         Give up after S seconds without a new record, or without the file at the start (default 10)
+//  --count N        Stop after N records (default: no limit)
+//  --poll US        Microseconds to sleep when there is no new record, 0 to spin (default 50)
+//  --quiet          Only print the summary
+//  --self-test      Instead of reading a file, check in this process that readers account for every record written
+//                   (see SelfTest) and exit with 1 if they don't. Run by make check.
+//
+//E.g. scanconsume /dev/shm/scan.export & scanreplay --export /dev/shm/scan.export recording.frames
+
+#include "ScanExport.h"
+#include "ScanStats.h"
+#include "zbar.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef SCAN_HOST_BUILD
+using namespace zbar; //The desktop zbar.h declares the C API inside namespace zbar when compiled as C++
+#endif
+
+#define SELF_TEST_RING_BYTES 1024 //Smallest ring that fits the largest test record twice, so it is overrun often
+#define SELF_TEST_MAX_DATA 48 //Test payloads are 0 to SELF_TEST_MAX_DATA - 1 bytes
+#define SELF_TEST_THREAD_RECORDS 100000
+
+struct ConsumeOptions {
+	uint waitSeconds;
+	uint count;
+	uint pollUs;
+	bool quiet;
+	bool selfTest;
+	const char* pPath;
+};
+
+//Writer thread of the self test
+struct TestWriter {
+	ScanExport* pExport;
+	uint32 records;
+	volatile int32 done;
+};
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//FUNCTIONS
+
+//Returns false if an option is unknown or has a bad value.
+static bool ParseOptions(int argc, char** argv, ConsumeOptions* pOptions) {
+	pOptions->waitSeconds = 10;
+	pOptions->count = 0;
+	pOptions->pollUs = 50;
+	pOptions->quiet = false;
+	pOptions->selfTest = false;
+	pOptions->pPath = NULL;
+
+	for(int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		if(arg[0] != '-') {
+			pOptions->pPath = arg;
+			continue;
+		}
+		if(strcmp(arg, "--quiet") == 0) {
+			pOptions->quiet = true;
+			continue;
+		}
+		if(strcmp(arg, "--self-test") == 0) {
+			pOptions->selfTest = true;
+			continue;
+		}
+		if(i + 1 >= argc)
+			return false;
+		const char* value = argv[++i];
+		if(strcmp(arg, "--wait") == 0)
+			pOptions->waitSeconds = (uint)atoi(value);
+		else if(strcmp(arg, "--count") == 0)
+			pOptions->count = (uint)atoi(value);
+		else if(strcmp(arg, "--poll") == 0)
+			pOptions->pollUs = (uint)atoi(value);
+		else
+			return false;
+	}
+	return pOptions->pPath != NULL || pOptions->selfTest;
+}
+
+static void SleepUs(uint us) {
+	timespec delay;
+	delay.tv_sec = (time_t)(us / 1000000);
+	delay.tv_nsec = (long)(us % 1000000) * 1000;
+	nanosleep(&delay, NULL);
+}
+
+//Print a record read from the ring. Returns false if it was overwritten while it was copied, the line is then torn.
+//Only the lengths in the view are used, and what is read from the ring is copied into local buffers they can't overrun.
+static bool PrintRecord(ScanExportReader* pReader, const ScanExportView* pView, uint64 deliveryNs) {
+	const ScanExportRecord& record = pView->record;
+	char polygon[SCAN_EXPORT_MAX_POINTS * 16] = "";
+	uint length = 0;
+	const uint numPoints = record.numPoints < SCAN_EXPORT_MAX_POINTS ? record.numPoints : SCAN_EXPORT_MAX_POINTS;
+	for(uint i = 0; i < numPoints && length < sizeof(polygon); ++i)
+		length += snprintf(polygon + length, sizeof(polygon) - length, "%s%d,%d", i ? " " : "", pView->pPoints[2 * i],
+			pView->pPoints[2 * i + 1]);
+	char data[256];
+	const uint dataLength = record.dataLength < sizeof(data) - 1 ? record.dataLength : sizeof(data) - 1;
+	memcpy(data, pView->pData, dataLength);
+	data[dataLength] = '\0';
+	char line[512];
+	snprintf(line, sizeof(line), "#%-6u frame %-6u %-8s latency %6u us, delivered %5.1f us, %ux%u at [%s] \"%s\"",
+		record.sequence, record.frameSequence, zbar_get_symbol_name((zbar_symbol_type_t)record.type), record.latencyUs,
+		deliveryNs / 1e3, record.frameWidth, record.frameHeight, polygon, data);
+	if(!ScanExportReaderValid(pReader))
+		return false;
+	printf("%s\n", line);
+	return true;
+}
+
+//Write test record number i, with a payload that follows from i so a reader can check it.
+static void WriteTestRecord(ScanExport* pExport, uint32 i) {
+	char data[SELF_TEST_MAX_DATA];
+	const uint length = i % SELF_TEST_MAX_DATA;
+	for(uint k = 0; k < length; ++k)
+		data[k] = (char)('a' + (i + k) % 26);
+	const int points[8] = { 0, 0, 10, 0, 10, 10, 0, 10 };
+	ScanExportWrite(pExport, ZBAR_QRCODE, data, length, points, 4, 100, 100, i, i, 0);
+}
+
+static void* TestWriterThread(void* pArg) {
+	TestWriter* pWriter = (TestWriter*)pArg;
+	for(uint32 i = 0; i < pWriter->records; ++i) {
+		WriteTestRecord(pWriter->pExport, i);
+		if(i % 8 == 0)
+			sched_yield(); //Let the reader in before the ring is overrun, also on a single core
+	}
+	AtomicStore(&pWriter->done, 1);
+	return NULL;
+}
+
+//Read every record there is. Returns false if a record read intact doesn't hold what WriteTestRecord wrote.
+static bool DrainTestRecords(ScanExportReader* pReader) {
+	bool ok = true;
+	ScanExportView view;
+	while(ScanExportReaderNext(pReader, &view)) {
+		const uint32 sequence = view.record.frameSequence; //The writer's record number
+		bool same = view.record.dataLength == sequence % SELF_TEST_MAX_DATA && view.record.numPoints == 4;
+		for(uint k = 0; same && k < view.record.dataLength; ++k)
+			same = view.pData[k] == (char)('a' + (sequence + k) % 26);
+		if(ScanExportReaderValid(pReader) && !same)
+			ok = false;
+	}
+	return ok;
+}
+
+//Print the outcome of a self test case. Returns true if it passed: every one of the records written since the reader
+//started was read or missed, and at least one was read.
+static bool ReportTestCase(const char* pName, const ScanExportReader* pReader, uint32 written, bool intact) {
+	const bool passed = intact && pReader->read > 0 && pReader->read + pReader->missed == written;
+	printf("%s %-34s %7u read %7u missed %7u written%s\n", passed ? "PASS" : "FAIL", pName, pReader->read, pReader->missed,
+		written, intact ? "" : ", wrong record contents");
+	return passed;
+}
+
+//Check the export ring in this process with a small ring: a reader overrun before its first read, a reader overrun
+//with no record after the gap, a reader started on a ring that already holds records and a reader racing a writer
+//thread. Returns the number of cases that failed.
+static uint SelfTest() {
+	uint failed = 0;
+	ScanExport exportRing;
+	ScanExportReader reader;
+	if(!ScanExportOpen(&exportRing, NULL, SELF_TEST_RING_BYTES)) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	ScanExportReaderAttach(&reader, &exportRing);
+	for(uint32 i = 0; i < 300; ++i)
+		WriteTestRecord(&exportRing, i);
+	bool intact = DrainTestRecords(&reader); //Skips to the newest record, nothing to read yet
+	for(uint32 i = 0; i < 10; ++i)
+		WriteTestRecord(&exportRing, i);
+	intact = DrainTestRecords(&reader) && intact;
+	failed += ReportTestCase("overrun before the first read", &reader, 310, intact) ? 0 : 1;
+
+	ScanExportReaderAttach(&reader, &exportRing);
+	for(uint32 i = 0; i < 5; ++i)
+		WriteTestRecord(&exportRing, i);
+	intact = DrainTestRecords(&reader);
+	for(uint32 i = 0; i < 300; ++i)
+		WriteTestRecord(&exportRing, i);
+	intact = DrainTestRecords(&reader) && intact;
+	failed += ReportTestCase("overrun with no record after it", &reader, 305, intact) ? 0 : 1;
+
+	ScanExportReaderAttach(&reader, &exportRing);
+	for(uint32 i = 0; i < 10; ++i)
+		WriteTestRecord(&exportRing, i);
+	intact = DrainTestRecords(&reader);
+	failed += ReportTestCase("started on a ring with records", &reader, 10, intact && reader.missed == 0) ? 0 : 1;
+
+	if(ScanThreadsAvailable()) {
+		ScanExportReaderAttach(&reader, &exportRing);
+		TestWriter writer;
+		writer.pExport = &exportRing;
+		writer.records = SELF_TEST_THREAD_RECORDS;
+		writer.done = 0;
+		ScanThread* pThread = ScanThreadCreate(TestWriterThread, &writer);
+		intact = pThread != NULL;
+		while(pThread && !AtomicLoad(&writer.done)) {
+			intact = DrainTestRecords(&reader) && intact;
+			sched_yield();
+		}
+		if(pThread)
+			ScanThreadJoin(pThread);
+		intact = DrainTestRecords(&reader) && intact;
+		failed += ReportTestCase("racing a writer thread", &reader, SELF_TEST_THREAD_RECORDS, intact) ? 0 : 1;
+	}
+
+	ScanExportReaderClose(&reader);
+	ScanExportClose(&exportRing);
+	return failed;
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//MAIN FUNCTION
+
+int main(int argc, char** argv) {
+	ConsumeOptions options;
+	if(!ParseOptions(argc, argv, &options)) {
+		printf("Usage: scanconsume [--wait S] [--count N] [--poll US] [--quiet] [--self-test] export.file\n");
+		return 1;
+	}
+	if(options.selfTest)
+		return SelfTest() ? 1 : 0;
+
+	//The writer may not have created the file yet
+	const uint64 waitNs = (uint64)options.waitSeconds * 1000000000ull;
+	ScanExportReader reader;
+	uint64 lastNs = ScanClockNs();
+	while(!ScanExportReaderOpen(&reader, options.pPath)) {
+		ScanExportReaderClose(&reader);
+		if(ScanClockNs() - lastNs > waitNs) {
+			fprintf(stderr, "No export at %s\n", options.pPath);
+			return 1;
+		}
+		SleepUs(10000);
+	}
+	printf("%s: %u byte ring, reading from record %d\n", options.pPath, reader.pHeader->ringBytes, reader.pHeader->records);
+
+	LatencyHistogram delivery; //End of the decode to this reader seeing the record
+	LatencyHistogram endToEnd; //Capture to this reader seeing the record
+	memset(&delivery, 0, sizeof(delivery));
+	memset(&endToEnd, 0, sizeof(endToEnd));
+	uint torn = 0;
+	lastNs = ScanClockNs();
+	while(options.count == 0 || reader.read < options.count) {
+		ScanExportView view;
+		if(!ScanExportReaderNext(&reader, &view)) {
+			if(ScanClockNs() - lastNs > waitNs)
+				break;
+			if(options.pollUs)
+				SleepUs(options.pollUs);
+			continue;
+		}
+		lastNs = ScanClockNs();
+		const uint64 decodedNs = view.record.timestampNs + view.record.latencyUs * 1000ull;
+		const uint64 deliveryNs = lastNs > decodedNs ? lastNs - decodedNs : 0;
+		const bool valid = options.quiet ? ScanExportReaderValid(&reader) : PrintRecord(&reader, &view, deliveryNs);
+		if(!valid) {
+			++torn;
+			continue;
+		}
+		LatencyHistogramAdd(&delivery, deliveryNs);
+		LatencyHistogramAdd(&endToEnd, lastNs - view.record.timestampNs);
+	}
+
+	printf("%u records read, %u missed (%u overwritten while read), %d written in all, %d too large to write\n", reader.read,
+		reader.missed, torn, reader.pHeader->records, reader.pHeader->dropped);
+	if(delivery.count) {
+		printf("delivery after decode: mean %.1f us, p95 %.1f us, max %.1f us\n", delivery.totalNs / 1e3 / delivery.count,
+			LatencyHistogramPercentileNs(&delivery, 95) / 1e3, delivery.maxNs / 1e3);
+		printf("capture to reader: mean %.1f ms, p95 %.1f ms, max %.1f ms\n", endToEnd.totalNs / 1e6 / endToEnd.count,
+			LatencyHistogramPercentileNs(&endToEnd, 95) / 1e6, endToEnd.maxNs / 1e6);
+	}
+	ScanExportReaderClose(&reader);
+	return 0;
+}
@@ -0,0 +1,388 @@
+//Replays a camera recording (see FrameFile.h) through the same path as the app: every frame is cropped and converted into
+//a ScanEngine frame slot and published, and the scan worker decodes in the background within its CPU budget.
+//Recordings are made on the device by setting g_recordFramesPath in main.cpp.
+//
+//Usage: scanreplay [options] recording.frames
+//  --speed S        recorded: keep the recorded frame timing (default), max: feed frames as fast as possible
+//  --mode M         full, pyramid or tracking (default pyramid)
+//  --budget F       CPU budget of the scan worker (default 0.5)
+//  --dedup MS       report a symbol again only MS milliseconds after it was last seen (default 0: every sighting)
+//  --enhance M      off, stretch or threshold: frame enhancement before each scan (default: the profile's, off without one)
+//  --gate G         on or off: skip blurred and badly exposed frames (default: the profile's, on without one)
+//  --denoise D      on or off: average consecutive frames before they are scanned (default: the profile's, off without one)
+//  --loop N         Play the recording N times (default 1)
+//  --export FILE    Also write every result to a ScanExport ring mapped from FILE (e.g. /dev/shm/scan.export), which
+//                   tools/scanconsume reads from another process
+//  --profiles FILE  app.icf to read scanner profiles from (see data/app.config.txt). Without --profile every frame is
+//                   scanned once with each profile in [Scan] Profiles and their cost, hit rate and frames to the first
+//                   decode are compared. Add profiles that differ only in Enhance or Denoise to compare them.
+//  --profile NAME   replay with this profile from the --profiles file (default QR codes only)
+
+#include "FrameFile.h"
+#include "ScanEngine.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REPLAY_DRAIN_MS 500 //Time given to the worker to finish the last frames before the summary
+
+struct ReplayOptions {
+	bool recordedSpeed;
+	ScanMode mode;
+	float cpuBudget;
+	uint dedupTtlMs;
+	bool setEnhance; //--enhance given: overrides the profile's mode
+	ScanEnhanceMode enhance;
+	int qualityGate; //--gate: 1 on, 0 off, -1 the profile's setting
+	int denoise; //--denoise: 1 on, 0 off, -1 the profile's setting
+	uint loops;
+	const char* pExportPath;
+	const char* pProfilesPath;
+	const char* pProfileName;
+	const char* pPath;
+};
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//FUNCTIONS
+
+//Returns false if an option is unknown or has a bad value.
+static bool ParseOptions(int argc, char** argv, ReplayOptions* pOptions) {
+	pOptions->recordedSpeed = true;
+	pOptions->mode = SCAN_MODE_PYRAMID;
+	pOptions->cpuBudget = 0.5f;
+	pOptions->dedupTtlMs = 0;
+	pOptions->setEnhance = false;
+	pOptions->enhance = SCAN_ENHANCE_OFF;
+	pOptions->qualityGate = -1;
+	pOptions->denoise = -1;
+	pOptions->loops = 1;
+	pOptions->pExportPath = NULL;
+	pOptions->pProfilesPath = NULL;
+	pOptions->pProfileName = NULL;
+	pOptions->pPath = NULL;
+
+	for(int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		if(arg[0] != '-') {
+			pOptions->pPath = arg;
+			continue;
+		}
+		if(i + 1 >= argc)
+			return false;
+		const char* value = argv[++i];
+		if(strcmp(arg, "--speed") == 0) {
+			if(strcmp(value, "recorded") == 0)
+				pOptions->recordedSpeed = true;
+			else if(strcmp(value, "max") == 0)
+				pOptions->recordedSpeed = false;
+			else
+				return false;
+		}
+		else if(strcmp(arg, "--mode") == 0) {
+			if(!ScanModeFromName(value, &pOptions->mode))
+				return false;
+		}
+		else if(strcmp(arg, "--budget") == 0)
+			pOptions->cpuBudget = (float)atof(value);
+		else if(strcmp(arg, "--dedup") == 0)
+			pOptions->dedupTtlMs = (uint)atoi(value);
+		else if(strcmp(arg, "--enhance") == 0) {
+			if(!ScanEnhanceModeFromName(value, &pOptions->enhance))
+				return false;
+			pOptions->setEnhance = true;
+		}
+		else if(strcmp(arg, "--gate") == 0) {
+			if(strcmp(value, "on") != 0 && strcmp(value, "off") != 0)
+				return false;
+			pOptions->qualityGate = strcmp(value, "on") == 0 ? 1 : 0;
+		}
+		else if(strcmp(arg, "--denoise") == 0) {
+			if(strcmp(value, "on") != 0 && strcmp(value, "off") != 0)
+				return false;
+			pOptions->denoise = strcmp(value, "on") == 0 ? 1 : 0;
+		}
+		else if(strcmp(arg, "--loop") == 0)
+			pOptions->loops = (uint)atoi(value);
+		else if(strcmp(arg, "--export") == 0)
+			pOptions->pExportPath = value;
+		else if(strcmp(arg, "--profiles") == 0)
+			pOptions->pProfilesPath = value;
+		else if(strcmp(arg, "--profile") == 0)
+			pOptions->pProfileName = value;
+		else
+			return false;
+	}
+	if(pOptions->pProfileName && pOptions->pProfilesPath == NULL)
+		return false;
+	return pOptions->pPath != NULL && pOptions->cpuBudget > 0.0f && pOptions->cpuBudget <= 1.0f && pOptions->loops > 0;
+}
+
+static void SleepUntil(uint64 timeNs) {
+	const uint64 nowNs = ScanClockNs();
+	if(timeNs <= nowNs)
+		return;
+	timespec delay;
+	delay.tv_sec = (time_t)((timeNs - nowNs) / 1000000000ull);
+	delay.tv_nsec = (long)((timeNs - nowNs) % 1000000000ull);
+	nanosleep(&delay, NULL);
+}
+
+//ScanConfigGetter for an .icf file: pContext is its path. Comments after # and spaces around the value are dropped.
+static bool GetIcfValue(void* pContext, const char* pGroup, const char* pKey, char* pValue) {
+	FILE* pFile = fopen((const char*)pContext, "r");
+	if(pFile == NULL)
+		return false;
+	char line[512];
+	bool inGroup = false, found = false;
+	while(!found && fgets(line, sizeof(line), pFile)) {
+		char* pComment = strchr(line, '#');
+		if(pComment)
+			*pComment = '\0';
+		char* pEnd = line + strlen(line);
+		while(pEnd > line && (pEnd[-1] == ' ' || pEnd[-1] == '\t' || pEnd[-1] == '\r' || pEnd[-1] == '\n'))
+			*--pEnd = '\0';
+		if(line[0] == '[') {
+			inGroup = pEnd > line && pEnd[-1] == ']' && strlen(pGroup) == (size_t)(pEnd - line - 2) &&
+				strncmp(line + 1, pGroup, pEnd - line - 2) == 0;
+			continue;
+		}
+		char* pEquals = strchr(line, '=');
+		if(!inGroup || pEquals == NULL)
+			continue;
+		char* pKeyEnd = pEquals;
+		while(pKeyEnd > line && (pKeyEnd[-1] == ' ' || pKeyEnd[-1] == '\t'))
+			--pKeyEnd;
+		if(strlen(pKey) != (size_t)(pKeyEnd - line) || strncmp(line, pKey, pKeyEnd - line) != 0)
+			continue;
+		const char* pStart = pEquals + 1;
+		while(*pStart == ' ' || *pStart == '\t')
+			++pStart;
+		snprintf(pValue, SCAN_CONFIG_VALUE_SIZE, "%s", pStart);
+		found = true;
+	}
+	fclose(pFile);
+	return found;
+}
+
+//Scan every frame of the recording once with each profile listed in [Scan] Profiles, on this thread without the
+//scheduler, and print what each costs per frame (denoising and enhancement, and decode), how often it finds a symbol and how many
+//frames it scans up to the first one. Returns false on error.
+static bool CompareProfiles(const ReplayOptions& options, FrameReplay* pReplay) {
+	char names[SCAN_CONFIG_VALUE_SIZE];
+	if(!GetIcfValue((void*)options.pProfilesPath, "Scan", "Profiles", names)) {
+		fprintf(stderr, "No [Scan] Profiles in %s\n", options.pProfilesPath);
+		return false;
+	}
+	printf("%-12s %12s %12s %8s %8s %6s  %s\n", "profile", "enhance ns", "decode ns", "hit", "symbols", "first", "settings");
+
+	uint8* pGray = NULL;
+	uint graySize = 0;
+	for(char* pName = strtok(names, ", "); pName; pName = strtok(NULL, ", ")) {
+		ScanProfile profile;
+		if(!ScanProfileLoad(&profile, pName, GetIcfValue, (void*)options.pProfilesPath)) {
+			fprintf(stderr, "Profile %s is missing or invalid\n", pName);
+			return false;
+		}
+		ScanDecoder decoder;
+		if(!ScanDecoderInit(&decoder, options.mode, &profile)) {
+			fprintf(stderr, "Failed to create the ZBar scanner\n");
+			return false;
+		}
+		ScanEnhancer enhancer;
+		ScanEnhancerInit(&enhancer);
+		ScanDenoiser denoiser;
+		ScanDenoiserInit(&denoiser);
+
+		uint frames = 0, hits = 0, symbols = 0, firstHit = 0; //firstHit: frames scanned up to the first hit, 0 for none
+		uint64 enhanceNs = 0, decodeNs = 0;
+		CameraFrame frame;
+		uint64 timestamp;
+		FrameReplayRewind(pReplay);
+		while(FrameReplayNext(pReplay, &frame, &timestamp)) {
+			FrameCrop crop;
+			ComputeFrameCrop(frame.width, frame.height, &crop);
+			if(crop.dim * crop.dim > graySize) {
+				graySize = crop.dim * crop.dim;
+				pGray = (uint8*)realloc(pGray, graySize);
+				if(pGray == NULL) {
+					fprintf(stderr, "Out of memory\n");
+					return false;
+				}
+			}
+			PrepareCameraFrame(&frame, &crop, crop.dim, NULL, pGray);
+
+			const uint64 startNs = ScanClockNs();
+			if((profile.denoise && !ScanDenoise(&denoiser, pGray, crop.dim, crop.dim)) ||
+				!ScanEnhance(&enhancer, profile.enhance, pGray, crop.dim, crop.dim)) {
+				fprintf(stderr, "Out of memory\n");
+				return false;
+			}
+			const uint64 enhancedNs = ScanClockNs();
+			const int numSymbols = ScanDecoderScan(&decoder, pGray, crop.dim, crop.dim);
+			enhanceNs += enhancedNs - startNs;
+			decodeNs += ScanClockNs() - enhancedNs;
+			++frames;
+			uint verified = 0;
+			const zbar_symbol_t* pSymbol = numSymbols > 0 ? ScanDecoderFirstSymbol(&decoder) : NULL;
+			for(; pSymbol; pSymbol = zbar_symbol_next(pSymbol))
+				verified += ScanDecoderIsVerified(&decoder, pSymbol) ? 1 : 0;
+			hits += verified ? 1 : 0;
+			symbols += verified;
+			if(verified && firstHit == 0)
+				firstHit = frames;
+		}
+		ScanDecoderRelease(&decoder);
+		ScanEnhancerRelease(&enhancer);
+		ScanDenoiserRelease(&denoiser);
+
+		char settings[256], first[16] = "-";
+		ScanProfileFormat(&profile, settings, sizeof(settings));
+		if(firstHit)
+			snprintf(first, sizeof(first), "%u", firstHit);
+		printf("%-12s %12llu %12llu %7.1f%% %8u %6s  %s\n", profile.name, (unsigned long long)(frames ? enhanceNs / frames : 0),
+			(unsigned long long)(frames ? decodeNs / frames : 0), frames ? 100.0 * hits / frames : 0.0, symbols, first, settings);
+	}
+	free(pGray);
+	return true;
+}
+
+//Print the results the worker queued since the last call, a batch at a time. Returns how many there were.
+static uint PrintResults(ScanEngine* pEngine, uint64 startNs) {
+	ScanResult results[16];
+	uint total = 0, numResults;
+	while((numResults = ScanEnginePollResults(pEngine, results, 16)) > 0) {
+		for(uint i = 0; i < numResults; ++i) {
+			printf("%9.1f ms  frame %-6u %s \"%s\"\n", (ScanClockNs() - startNs) / 1e6, results[i].frameSequence,
+				zbar_get_symbol_name(results[i].type), results[i].pData);
+		}
+		ScanEngineResultsDone(pEngine);
+		total += numResults;
+	}
+	return total;
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//MAIN FUNCTION
+
+int main(int argc, char** argv) {
+	ReplayOptions options;
+	if(!ParseOptions(argc, argv, &options)) {
+		printf("Usage: scanreplay [--speed recorded|max] [--mode full|pyramid|tracking] [--budget F] [--dedup MS]\n"
+			"                  [--enhance off|stretch|threshold] [--gate on|off] [--denoise on|off]\n"
+			"                  [--loop N] [--export FILE] [--profiles app.icf [--profile NAME]]\n"
+			"                  recording.frames\n");
+		return 1;
+	}
+
+	FrameReplay replay;
+	if(!FrameReplayOpen(&replay, options.pPath)) {
+		fprintf(stderr, "Failed to open recording %s\n", options.pPath);
+		return 1;
+	}
+	if(options.pProfilesPath && options.pProfileName == NULL) {
+		const bool compared = CompareProfiles(options, &replay);
+		FrameReplayClose(&replay);
+		return compared ? 0 : 1;
+	}
+	ScanProfile profile;
+	if(options.pProfileName && !ScanProfileLoad(&profile, options.pProfileName, GetIcfValue, (void*)options.pProfilesPath)) {
+		fprintf(stderr, "Profile %s is missing or invalid in %s\n", options.pProfileName, options.pProfilesPath);
+		return 1;
+	}
+	ScanEngine* pEngine = ScanEngineCreate(options.cpuBudget, options.mode, options.pProfileName ? &profile : NULL,
+		options.dedupTtlMs);
+	if(pEngine == NULL) {
+		fprintf(stderr, "Failed to create the scan engine\n");
+		return 1;
+	}
+	if(options.setEnhance)
+		ScanEngineSetEnhance(pEngine, options.enhance);
+	if(options.qualityGate >= 0)
+		ScanEngineSetQualityGate(pEngine, options.qualityGate == 1);
+	if(options.denoise >= 0)
+		ScanEngineSetDenoise(pEngine, options.denoise == 1);
+	ScanExport scanExport;
+	memset(&scanExport, 0, sizeof(scanExport));
+	if(options.pExportPath) {
+		if(!ScanExportOpen(&scanExport, options.pExportPath, SCAN_EXPORT_DEFAULT_RING_BYTES)) {
+			fprintf(stderr, "Failed to create the export file %s\n", options.pExportPath);
+			return 1;
+		}
+		ScanEngineSetExport(pEngine, &scanExport);
+	}
+	printf("%s: %u frames, %s speed, mode %s, enhance %s, gate %s, denoise %s, budget %.2f, dedup %u ms, %u loop(s)\n", options.pPath,
+		replay.frames, options.recordedSpeed ? "recorded" : "max", ScanModeName(options.mode),
+		ScanEnhanceModeName(ScanEngineGetEnhance(pEngine)), ScanEngineGetQualityGate(pEngine) ? "on" : "off",
+		ScanEngineGetDenoise(pEngine) ? "on" : "off", options.cpuBudget, options.dedupTtlMs, options.loops);
+
+	uint16* pPreview = NULL;
+	uint previewSize = 0, framesFed = 0, numResults = 0;
+	uint64 prepareNs = 0;
+	uint32 firstLoopAllocations = 0; //ScanAllocationCount() after the first loop
+	const uint64 startNs = ScanClockNs();
+	for(uint loop = 0; loop < options.loops; ++loop) {
+		if(loop == 1)
+			firstLoopAllocations = ScanAllocationCount();
+		const uint64 loopStartNs = ScanClockNs();
+		uint64 firstTimestamp = 0;
+		CameraFrame frame;
+		uint64 timestamp;
+		FrameReplayRewind(&replay);
+		for(uint i = 0; FrameReplayNext(&replay, &frame, &timestamp); ++i) {
+			if(i == 0)
+				firstTimestamp = timestamp;
+			if(options.recordedSpeed)
+				SleepUntil(loopStartNs + (timestamp - firstTimestamp));
+
+			FrameCrop crop;
+			ComputeFrameCrop(frame.width, frame.height, &crop);
+			if(crop.dim * crop.dim > previewSize) {
+				previewSize = crop.dim * crop.dim;
+				pPreview = (uint16*)realloc(pPreview, previewSize * sizeof(uint16));
+			}
+			FrameSlot* pSlot = ScanEngineBeginFrame(pEngine, crop.dim, crop.dim);
+			if(pPreview == NULL || pSlot == NULL) {
+				fprintf(stderr, "Out of memory\n");
+				return 1;
+			}
+
+			const uint64 frameStartNs = ScanClockNs();
+			PrepareCameraFrame(&frame, &crop, crop.dim, pPreview, pSlot->pPixels);
+			ComputeFrameQuality(pSlot->pPixels, crop.dim, crop.dim, &pSlot->quality);
+			prepareNs += ScanClockNs() - frameStartNs;
+			ScanEnginePublishFrame(pEngine, ScanClockNs());
+			++framesFed;
+			numResults += PrintResults(pEngine, startNs);
+		}
+	}
+	const uint64 feedNs = ScanClockNs() - startNs;
+	SleepUntil(ScanClockNs() + REPLAY_DRAIN_MS * 1000000ull);
+	numResults += PrintResults(pEngine, startNs);
+
+	const ScanScheduler& scheduler = pEngine->scheduler;
+	printf("fed %u frames in %.1f ms (%.1f frames/s), prepare %llu ns/frame\n", framesFed, feedNs / 1e6,
+		framesFed * 1e9 / (double)feedNs, (unsigned long long)(framesFed ? prepareNs / framesFed : 0));
+	printf("%u results, scheduler: %u frames offered, %u scanned, %u skipped as unchanged, %u decoded, decode cost %llu us\n",
+		numResults, scheduler.framesOffered, scheduler.framesScanned, scheduler.framesUnchanged, scheduler.scansDecoded,
+		(unsigned long long)(scheduler.decodeCostNs / 1000));
+	printf("%d frames dropped by the ring, %d results dropped\n", pEngine->ring.dropped, pEngine->results.dropped);
+	if(scanExport.pBlock) {
+		printf("export %s: %d records written, %d too large\n", options.pExportPath, scanExport.pHeader->records,
+			scanExport.pHeader->dropped);
+	}
+	if(options.loops > 1) {
+		printf("heap allocations: %u during the first loop, %u during the other loops\n", firstLoopAllocations,
+			ScanAllocationCount() - firstLoopAllocations);
+	}
+	char statsText[1024];
+	ScanStatsFormat(&pEngine->stats, statsText, sizeof(statsText));
+	printf("%s", statsText);
+
+	ScanEngineDestroy(pEngine);
+	ScanExportClose(&scanExport);
+	FrameReplayClose(&replay);
+	free(pPreview);
+	return 0;
+}
@@ -0,0 +1,372 @@
+//Runs several camera streams through a ScanService, the shared worker pool for fixed multi-camera installations, in real
+//time with no camera attached. Every stream plays a camera recording (see FrameFile.h) in a loop, or without recordings
+//shows a conveyor: QR codes with a new payload each time sliding across the frame. A feeder thread publishes the frames
+//of all streams at --fps, staggered so the streams don't all publish at once, and the summary gives per stream:
+//published and scanned frames/s, frames dropped because a newer one replaced them or because they went stale, frames
+//skipped by the quality gate or because they hadn't changed since the last failed scan, and the end to end latency from
+//a frame's capture time to the end of its scan. Every published frame is scanned, dropped, stale, gated or unchanged,
+//apart from the last one of a stream if a worker hadn't taken it yet when the run ended.
+//
+//Usage: scanservice [options] [recording.frames...]
+//  --streams N      Camera streams (default 4). Stream i plays recording i modulo the number of recordings.
+//  --workers N      Worker threads shared by the streams (default one per core)
+//  --fps F          Frames per second of every stream (default 30)
+//  --seconds N      Run time (default 10)
+//  --max-age MS     Drop frames this old when a worker gets to them, 0 to scan every frame kept (default 100)
+//  --mode M         full, pyramid or tracking (default pyramid)
+//  --size N         Side of the synthetic frames in pixels (default 480)
+//  --scaling        Run with 1, 2, 4, ... up to --workers workers and print frames scanned/s and scaling efficiency
+//                   for each. Use enough streams and --fps to keep all the workers busy, otherwise the rate is the
+//                   offered load.
+
+#include "FrameFile.h"
+#include "QrEncoder.h"
+#include "ScanService.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SERVICE_MAX_RECORDINGS 16
+#define SERVICE_DRAIN_MS 200 //Time given to the workers to finish the last frames before the summary
+#define SERVICE_DEDUP_MS 2000 //A code on the conveyor is reported once while it passes
+#define SERVICE_MODULE_PX 4
+#define SERVICE_CODE_VERSION 3
+#define SERVICE_QUIET_ZONE 4 //Modules
+#define SERVICE_CONVEYOR_SPEED 5 //Pixels per frame
+
+struct ServiceOptions {
+	uint streams;
+	uint workers;
+	float fps;
+	uint seconds;
+	uint maxFrameAgeMs;
+	ScanMode mode;
+	uint size;
+	bool scaling;
+	const char* pPaths[SERVICE_MAX_RECORDINGS];
+	uint numPaths;
+};
+
+//Frame source of one stream.
+struct StreamSource {
+	FrameReplay* pReplay; //NULL for the synthetic conveyor
+	FrameCrop crop; //Of the recording's current frame
+
+	//Conveyor
+	QrCode code;
+	uint item; //Number in the payload of the code on the belt
+	int position; //x of the code's left edge, starts left of the frame
+
+	uint64 nextNs; //Capture time of the stream's next frame
+	uint32 results; //Symbols polled from the stream's engine
+};
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//FUNCTIONS
+
+static void PrintUsage() {
+	printf("Usage: scanservice [--streams N] [--workers N] [--fps F] [--seconds N] [--max-age MS] [--mode full|pyramid|tracking]\n"
+		"                   [--size N] [--scaling] [recording.frames...]\n");
+}
+
+//Returns false if an option is unknown or has a bad value.
+static bool ParseOptions(int argc, char** argv, ServiceOptions* pOptions) {
+	const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	pOptions->streams = 4;
+	pOptions->workers = cores > 0 ? (uint)cores : 1;
+	pOptions->fps = 30.0f;
+	pOptions->seconds = 10;
+	pOptions->maxFrameAgeMs = 100;
+	pOptions->mode = SCAN_MODE_PYRAMID;
+	pOptions->size = 480;
+	pOptions->scaling = false;
+	pOptions->numPaths = 0;
+
+	for(int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		if(arg[0] != '-') {
+			if(pOptions->numPaths == SERVICE_MAX_RECORDINGS)
+				return false;
+			pOptions->pPaths[pOptions->numPaths++] = arg;
+			continue;
+		}
+		if(strcmp(arg, "--scaling") == 0) {
+			pOptions->scaling = true;
+			continue;
+		}
+		if(i + 1 >= argc)
+			return false;
+		const char* value = argv[++i];
+		if(strcmp(arg, "--streams") == 0)
+			pOptions->streams = (uint)atoi(value);
+		else if(strcmp(arg, "--workers") == 0)
+			pOptions->workers = (uint)atoi(value);
+		else if(strcmp(arg, "--fps") == 0)
+			pOptions->fps = (float)atof(value);
+		else if(strcmp(arg, "--seconds") == 0)
+			pOptions->seconds = (uint)atoi(value);
+		else if(strcmp(arg, "--max-age") == 0)
+			pOptions->maxFrameAgeMs = (uint)atoi(value);
+		else if(strcmp(arg, "--mode") == 0) {
+			if(!ScanModeFromName(value, &pOptions->mode))
+				return false;
+		}
+		else if(strcmp(arg, "--size") == 0)
+			pOptions->size = (uint)atoi(value);
+		else
+			return false;
+	}
+	return pOptions->streams > 0 && pOptions->streams <= SCAN_SERVICE_MAX_STREAMS && pOptions->workers > 0 &&
+		pOptions->workers <= SCAN_SERVICE_MAX_WORKERS && pOptions->fps > 0.0f && pOptions->seconds > 0 &&
+		pOptions->size >= 64;
+}
+
+static void SleepUntil(uint64 timeNs) {
+	const uint64 nowNs = ScanClockNs();
+	if(timeNs <= nowNs)
+		return;
+	timespec delay;
+	delay.tv_sec = (time_t)((timeNs - nowNs) / 1000000000ull);
+	delay.tv_nsec = (long)((timeNs - nowNs) % 1000000000ull);
+	nanosleep(&delay, NULL);
+}
+
+//Put the next item's code at the left edge of the belt. Returns false if it can't be encoded.
+static bool NextConveyorItem(StreamSource* pSource, uint stream) {
+	char payload[32];
+	const int length = snprintf(payload, sizeof(payload), "stream %u item %u", stream, pSource->item++);
+	pSource->position = -(int)((17 + 4 * SERVICE_CODE_VERSION + 2 * SERVICE_QUIET_ZONE) * SERVICE_MODULE_PX);
+	return QrEncode(&pSource->code, (const uint8*)payload, (uint)length, SERVICE_CODE_VERSION, QR_EC_M, pSource->item % QR_MASK_COUNT);
+}
+
+//Draw the conveyor into a size x size Y800 frame and move the belt on.
+static bool RenderConveyor(StreamSource* pSource, uint stream, uint8* pPixels, uint size) {
+	memset(pPixels, 200, size * size);
+	const QrCode& code = pSource->code;
+	const int left = pSource->position + SERVICE_QUIET_ZONE * SERVICE_MODULE_PX;
+	const int top = ((int)size - (int)(code.size * SERVICE_MODULE_PX)) / 2;
+	for(uint my = 0; my < code.size; ++my) {
+		for(uint mx = 0; mx < code.size; ++mx) {
+			if(!code.modules[my * code.size + mx])
+				continue;
+			const int x0 = left + (int)(mx * SERVICE_MODULE_PX), y0 = top + (int)(my * SERVICE_MODULE_PX);
+			for(int y = y0 > 0 ? y0 : 0; y < y0 + SERVICE_MODULE_PX && y < (int)size; ++y) {
+				for(int x = x0 > 0 ? x0 : 0; x < x0 + SERVICE_MODULE_PX && x < (int)size; ++x)
+					pPixels[y * size + x] = 40;
+			}
+		}
+	}
+	pSource->position += SERVICE_CONVEYOR_SPEED;
+	if(pSource->position >= (int)size)
+		return NextConveyorItem(pSource, stream);
+	return true;
+}
+
+//Count the symbols the stream's workers found. The feeder is the single consumer of every stream's results.
+static void PollResults(ScanService* pService, StreamSource* pSource, uint stream) {
+	ScanEngine* pEngine = ScanServiceEngine(pService, stream);
+	ScanResult results[8];
+	pSource->results += ScanEnginePollResults(pEngine, results, 8);
+	ScanEngineResultsDone(pEngine);
+}
+
+//Write the stream's next frame into its engine's frame ring and publish it with capture time timestamp.
+//Returns false on error.
+static bool PublishNextFrame(ScanService* pService, const ServiceOptions& options, StreamSource* pSource, uint stream,
+	uint64 timestamp) {
+	ScanEngine* pEngine = ScanServiceEngine(pService, stream);
+	const uint64 prepareStart = ScanClockNs();
+	FrameSlot* pSlot;
+	if(pSource->pReplay) {
+		CameraFrame frame;
+		uint64 recordedNs;
+		if(!FrameReplayNext(pSource->pReplay, &frame, &recordedNs)) {
+			FrameReplayRewind(pSource->pReplay);
+			if(!FrameReplayNext(pSource->pReplay, &frame, &recordedNs))
+				return false;
+		}
+		ComputeFrameCrop(frame.width, frame.height, &pSource->crop);
+		pSlot = ScanServiceBeginFrame(pService, stream, pSource->crop.dim, pSource->crop.dim);
+		if(pSlot == NULL)
+			return false;
+		PrepareCameraFrame(&frame, &pSource->crop, pSource->crop.dim, NULL, pSlot->pPixels);
+	}
+	else {
+		pSlot = ScanServiceBeginFrame(pService, stream, options.size, options.size);
+		if(pSlot == NULL || !RenderConveyor(pSource, stream, pSlot->pPixels, options.size))
+			return false;
+	}
+	ComputeFrameQuality(pSlot->pPixels, pSlot->width, pSlot->height, &pSlot->quality);
+	ScanStatsAddStage(&pEngine->stats, SCAN_STAGE_PREPARE, ScanClockNs() - prepareStart);
+	ScanServicePublishFrame(pService, stream, timestamp);
+	PollResults(pService, pSource, stream);
+	return true;
+}
+
+//Feed every stream at options.fps for options.seconds with the service's workers, then wait for the last scans.
+//Returns false on error.
+static bool RunService(ScanService* pService, const ServiceOptions& options, StreamSource* pSources) {
+	const uint64 intervalNs = (uint64)(1e9 / options.fps);
+	const uint64 startNs = ScanClockNs();
+	const uint64 endNs = startNs + options.seconds * 1000000000ull;
+	for(uint i = 0; i < options.streams; ++i)
+		pSources[i].nextNs = startNs + intervalNs * i / options.streams;
+	for(;;) {
+		uint stream = 0;
+		for(uint i = 1; i < options.streams; ++i) {
+			if(pSources[i].nextNs < pSources[stream].nextNs)
+				stream = i;
+		}
+		StreamSource* pSource = &pSources[stream];
+		if(pSource->nextNs >= endNs)
+			break;
+		SleepUntil(pSource->nextNs);
+		//The scheduled time counts as the capture time, so a feeder falling behind shows up as latency
+		if(!PublishNextFrame(pService, options, pSource, stream, pSource->nextNs))
+			return false;
+		pSource->nextNs += intervalNs;
+	}
+	SleepUntil(ScanClockNs() + SERVICE_DRAIN_MS * 1000000ull);
+	for(uint i = 0; i < options.streams; ++i)
+		PollResults(pService, &pSources[i], i);
+	return true;
+}
+
+static double Ms(uint64 ns) {
+	return ns / 1e6;
+}
+
+//The dropped, stale, gated and unchanged columns are percentages of the frames published.
+static void PrintStreams(ScanService* pService, const ServiceOptions& options, const StreamSource* pSources) {
+	printf("%-6s %-24s %9s %9s %8s %8s %8s %9s %9s %9s %9s %8s\n", "stream", "source", "pub fps", "scan fps", "dropped",
+		"stale", "gated", "unchanged", "mean ms", "p50 ms", "p95 ms", "results");
+	uint32 published = 0, scanned = 0, dropped = 0, stale = 0, gated = 0, unchanged = 0;
+	for(uint i = 0; i < options.streams; ++i) {
+		const ScanStats& stats = ScanServiceEngine(pService, i)->stats;
+		const LatencyHistogram& latency = stats.stages[SCAN_STAGE_LATENCY];
+		const char* pSource = options.numPaths ? options.pPaths[i % options.numPaths] : "conveyor";
+		const uint32 framesPublished = stats.framesPublished ? stats.framesPublished : 1;
+		const uint32 framesGated = stats.gateDecisions[SCAN_GATE_BLURRED] + stats.gateDecisions[SCAN_GATE_EXPOSURE];
+		printf("%-6u %-24.24s %9.1f %9.1f %7.1f%% %7.1f%% %7.1f%% %8.1f%% %9.2f %9.2f %9.2f %8u\n", i, pSource,
+			(double)stats.framesPublished / options.seconds, (double)stats.framesScanned / options.seconds,
+			100.0 * stats.framesDropped / framesPublished, 100.0 * stats.framesStale / framesPublished,
+			100.0 * framesGated / framesPublished, 100.0 * stats.framesUnchanged / framesPublished,
+			latency.count ? Ms(latency.totalNs / latency.count) : 0.0, Ms(LatencyHistogramPercentileNs(&latency, 50)),
+			Ms(LatencyHistogramPercentileNs(&latency, 95)), pSources[i].results);
+		published += stats.framesPublished;
+		scanned += stats.framesScanned;
+		dropped += stats.framesDropped;
+		stale += stats.framesStale;
+		gated += framesGated;
+		unchanged += stats.framesUnchanged;
+	}
+	printf("total: %.1f frames/s published, %.1f scanned, %u dropped, %u stale, %u gated, %u unchanged\n",
+		(double)published / options.seconds, (double)scanned / options.seconds, dropped, stale, gated, unchanged);
+}
+
+//Set up every stream's source. Returns false on error.
+static bool InitSources(const ServiceOptions& options, FrameReplay* pReplays, StreamSource* pSources) {
+	for(uint i = 0; i < options.streams; ++i) {
+		StreamSource* pSource = &pSources[i];
+		memset(pSource, 0, sizeof(StreamSource));
+		if(options.numPaths) {
+			//Streams playing the same recording each get their own read position
+			if(!FrameReplayOpen(&pReplays[i], options.pPaths[i % options.numPaths])) {
+				fprintf(stderr, "Failed to read %s\n", options.pPaths[i % options.numPaths]);
+				return false;
+			}
+			pSource->pReplay = &pReplays[i];
+			if(pSource->pReplay->frames == 0) {
+				fprintf(stderr, "%s has no frames\n", options.pPaths[i % options.numPaths]);
+				return false;
+			}
+		}
+		else if(!NextConveyorItem(pSource, i)) {
+			fprintf(stderr, "Failed to encode a conveyor code\n");
+			return false;
+		}
+	}
+	return true;
+}
+
+static void ReleaseSources(const ServiceOptions& options, StreamSource* pSources) {
+	for(uint i = 0; i < options.streams; ++i) {
+		if(pSources[i].pReplay)
+			FrameReplayClose(pSources[i].pReplay);
+		pSources[i].pReplay = NULL; //InitSources may fail before it gets to this stream the next time
+	}
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//MAIN FUNCTION
+
+int main(int argc, char** argv) {
+	static FrameReplay replays[SCAN_SERVICE_MAX_STREAMS];
+	static StreamSource sources[SCAN_SERVICE_MAX_STREAMS];
+	ServiceOptions options;
+	if(!ParseOptions(argc, argv, &options)) {
+		PrintUsage();
+		return 1;
+	}
+
+	printf("%u streams at %.1f fps from %s, %u workers, max age %u ms, mode %s, kernels %s\n", options.streams, options.fps,
+		options.numPaths ? "recordings" : "the conveyor", options.workers, options.maxFrameAgeMs, ScanModeName(options.mode),
+		FrameKernelsVariant());
+
+	int result = 0;
+	if(options.scaling) {
+		//1, 2, 4, ... workers and finally options.workers. Efficiency is the speedup over one worker divided by the workers.
+		printf("%8s %12s %9s %11s %9s\n", "workers", "scans/s", "speedup", "efficiency", "p95 ms");
+		double singleRate = 0.0;
+		for(uint workers = 1;; workers = workers * 2 < options.workers ? workers * 2 : options.workers) {
+			ScanService* pService = ScanServiceCreate(options.streams, workers, options.mode, NULL, SERVICE_DEDUP_MS,
+				options.maxFrameAgeMs);
+			if(pService == NULL || !InitSources(options, replays, sources) || !RunService(pService, options, sources)) {
+				fprintf(stderr, "Failed to run with %u workers\n", workers);
+				result = 1;
+				ScanServiceDestroy(pService);
+				ReleaseSources(options, sources);
+				break;
+			}
+			uint32 scanned = 0;
+			LatencyHistogram latency;
+			memset(&latency, 0, sizeof(latency));
+			for(uint i = 0; i < options.streams; ++i) {
+				const ScanStats& stats = ScanServiceEngine(pService, i)->stats;
+				scanned += stats.framesScanned;
+				for(uint b = 0; b < LATENCY_BUCKETS; ++b)
+					latency.buckets[b] += stats.stages[SCAN_STAGE_LATENCY].buckets[b];
+				latency.count += stats.stages[SCAN_STAGE_LATENCY].count;
+				if(stats.stages[SCAN_STAGE_LATENCY].maxNs > latency.maxNs)
+					latency.maxNs = stats.stages[SCAN_STAGE_LATENCY].maxNs;
+			}
+			const double rate = (double)scanned / options.seconds;
+			singleRate = workers == 1 ? rate : singleRate;
+			printf("%8u %12.1f %8.2fx %10.1f%% %9.2f\n", workers, rate, rate / singleRate, 100.0 * rate / singleRate / workers,
+				Ms(LatencyHistogramPercentileNs(&latency, 95)));
+			fflush(stdout);
+			ScanServiceDestroy(pService);
+			ReleaseSources(options, sources);
+			if(workers == options.workers)
+				break;
+		}
+	}
+	else {
+		ScanService* pService = ScanServiceCreate(options.streams, options.workers, options.mode, NULL, SERVICE_DEDUP_MS,
+			options.maxFrameAgeMs);
+		if(pService == NULL) {
+			fprintf(stderr, "Failed to start the scan service\n");
+			return 1;
+		}
+		if(InitSources(options, replays, sources) && RunService(pService, options, sources))
+			PrintStreams(pService, options, sources);
+		else
+			result = 1;
+		ScanServiceDestroy(pService);
+		ReleaseSources(options, sources);
+	}
+	return result;
+}
@@ -0,0 +1,632 @@
+//Decode rate and latency regression suite on a synthetic QR code corpus. A seeded generator encodes random payloads at
+//random versions, error correction levels, masks and module sizes, renders each code into a camera frame in one of the
+//formats CameraUpdateCallback receives (RGB565 with any pitch, NV21 or NV12, any rotation) and degrades it with
+//perspective, rotation, blur, noise, glare and low contrast scaled by a severity level. Every case is rendered at every
+//level from clean (0) to the worst conditions, so the levels form a decode rate vs per frame latency curve.
+//
+//Every frame goes through PrepareCameraFrame, ScanEnhance and ScanDecoderScan like scanbench. A frame counts as decoded
+//only if the payload matches what was encoded; any other payload counts as wrong. The same seed always gives the same
+//corpus, so results written with --results can be compared with a later run with --baseline, which exits with 2 if a
+//level's decode rate drops, its median latency grows or it decodes more wrong payloads than allowed.
+//
+//Usage: scansuite [options]
+//  --seed N         Corpus seed (default 1)
+//  --cases N        Codes per severity level (default 24)
+//  --levels N       Severity levels, at least 2 (default 6)
+//  --width N        Camera frame width, at most 16384 (default 640)
+//  --height N       Camera frame height, at most 16384 (default 480)
+//  --min-module F   Smallest module size in pixels (default 2)
+//  --max-module F   Largest module size in pixels, limited so the code fits in the crop square (default 6)
+//  --mode M         full, pyramid or tracking (default pyramid). In tracking mode repeats find the code where the
+//                   previous run did, so use full or pyramid for comparable latencies.
+//  --enhance M      off, stretch or threshold (default off)
+//  --repeat N       Timed runs per frame, the fastest counts as its latency (default 3)
+//  --results FILE   Write the results as JSON lines: the corpus settings, then one object per level
+//  --baseline FILE  Compare with the --results of an earlier run of the same corpus, --mode, --enhance and kernels
+//  --rate-drop F    Allowed drop of a level's decode rate, as a fraction of the frames (default 0.02)
+//  --slowdown F     Allowed growth of a level's median latency, as a fraction (default 0.25)
+//  --record FILE    Also write the frames as a camera recording (see FrameFile.h) for scanreplay
+//  --verbose        Print every frame's case parameters and result
+
+#include "FrameFile.h"
+#include "QrEncoder.h"
+#include "ScanEnhance.h"
+#include "ScanThread.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SUITE_MAX_PITCH_PADDING 64 //Bytes
+#define SUITE_QUIET_ZONE 4 //Modules
+#define SUITE_MAX_CODE_FILL 0.68f //Code side as a fraction of the crop square, so a code rotated 45 degrees still fits
+#define SUITE_FRAME_INTERVAL_NS 33333333ull //Timestamps of recorded frames, 30 frames/s
+
+struct SuiteOptions {
+	uint seed, cases, levels;
+	uint width, height;
+	float minModule, maxModule;
+	ScanMode mode;
+	ScanEnhanceMode enhance;
+	uint repeat;
+	const char* pResultsPath;
+	const char* pBaselinePath;
+	float rateDrop, slowdown;
+	const char* pRecordPath;
+	bool verbose;
+};
+
+struct SuiteRandom {
+	uint32 state;
+};
+
+//A test code and how it is shown to the camera. The fractions are drawn once per case and scaled by the severity, so
+//a case gets gradually worse from level to level instead of being a different picture at each.
+struct SuiteCase {
+	QrCode code;
+	char payload[280]; //Printable ASCII, nul terminated. Version 10-L holds 271 bytes.
+	uint payloadLength;
+	QrEcLevel ecLevel;
+	uint mask;
+	float modulePx; //Module size before perspective
+	float centerX, centerY; //In frame pixels
+	float angle; //Degrees at the worst severity
+	uint tiltEdge; //Edge shortened by perspective: 0 top, 1 right, 2 bottom, 3 left
+	float tilt, blur, noise, glare, contrast; //0 to 1, fractions of the worst case
+	float glareX, glareY; //Glare centre relative to the code centre, in code sides
+	FramePixelType pixelType;
+	FrameRotation rotation;
+	uint pitchPadding; //Bytes added to each row
+};
+
+//Decode rate and latency of one severity level
+struct LevelResult {
+	uint level;
+	uint frames, decoded, wrong;
+	uint64 meanNs, p50Ns, p95Ns;
+};
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//CORPUS
+
+static void SeedRandom(SuiteRandom* pRandom, uint seed, uint stream) {
+	pRandom->state = seed * 2654435761u ^ (stream + 1) * 40503u;
+	if(pRandom->state == 0)
+		pRandom->state = 1;
+}
+
+//xorshift32
+static uint32 NextRandom(SuiteRandom* pRandom) {
+	uint32 x = pRandom->state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return pRandom->state = x;
+}
+
+//Uniform in [low, high)
+static float RandomFloat(SuiteRandom* pRandom, float low, float high) {
+	return low + (high - low) * (float)(NextRandom(pRandom) >> 8) / 16777216.0f;
+}
+
+//Uniform in [0, count)
+static uint RandomIndex(SuiteRandom* pRandom, uint count) {
+	return (uint)(((uint64)NextRandom(pRandom) * count) >> 32);
+}
+
+//Draw case number index of the corpus. Depends only on the seed, the index and the frame and module sizes.
+static void CreateCase(const SuiteOptions* pOptions, const FrameCrop* pCrop, uint index, SuiteCase* pCase) {
+	SuiteRandom random;
+	SeedRandom(&random, pOptions->seed, index);
+
+	const uint version = 1 + RandomIndex(&random, QR_MAX_VERSION);
+	pCase->ecLevel = (QrEcLevel)RandomIndex(&random, QR_EC_COUNT);
+	pCase->mask = RandomIndex(&random, QR_MASK_COUNT);
+	const uint capacity = QrByteCapacity(version, pCase->ecLevel);
+	pCase->payloadLength = 1 + RandomIndex(&random, capacity);
+	for(uint i = 0; i < pCase->payloadLength; ++i)
+		pCase->payload[i] = (char)(' ' + RandomIndex(&random, 95));
+	pCase->payload[pCase->payloadLength] = '\0';
+	QrEncode(&pCase->code, (const uint8*)pCase->payload, pCase->payloadLength, version, pCase->ecLevel, pCase->mask);
+
+	const float sideModules = (float)(pCase->code.size + 2 * SUITE_QUIET_ZONE);
+	const float fitPx = SUITE_MAX_CODE_FILL * pCrop->dim / sideModules;
+	pCase->modulePx = RandomFloat(&random, pOptions->minModule, pOptions->maxModule);
+	if(pCase->modulePx > fitPx)
+		pCase->modulePx = fitPx;
+	const float slack = (SUITE_MAX_CODE_FILL * pCrop->dim - sideModules * pCase->modulePx) / 2;
+	pCase->centerX = pCrop->x + pCrop->dim / 2.0f + RandomFloat(&random, -slack, slack);
+	pCase->centerY = pCrop->y + pCrop->dim / 2.0f + RandomFloat(&random, -slack, slack);
+
+	pCase->angle = RandomFloat(&random, -180.0f, 180.0f);
+	pCase->tiltEdge = RandomIndex(&random, 4);
+	pCase->tilt = RandomFloat(&random, 0.5f, 1.0f);
+	pCase->blur = RandomFloat(&random, 0.5f, 1.0f);
+	pCase->noise = RandomFloat(&random, 0.5f, 1.0f);
+	pCase->glare = RandomFloat(&random, 0.5f, 1.0f);
+	pCase->contrast = RandomFloat(&random, 0.5f, 1.0f);
+	pCase->glareX = RandomFloat(&random, -0.4f, 0.4f);
+	pCase->glareY = RandomFloat(&random, -0.4f, 0.4f);
+
+	const FramePixelType pixelTypes[] = { FRAME_PIXEL_RGB565, FRAME_PIXEL_NV21, FRAME_PIXEL_NV12 };
+	pCase->pixelType = pixelTypes[RandomIndex(&random, 3)];
+	pCase->rotation = (FrameRotation)RandomIndex(&random, 4);
+	pCase->pitchPadding = RandomIndex(&random, SUITE_MAX_PITCH_PADDING / 2) * 2; //Even, so RGB565 rows stay aligned
+}
+
+//Homography mapping the unit square (u, v) to a quad: x = (a u + b v + c) / (g u + h v + 1), y likewise with d e f
+struct Homography {
+	float a, b, c, d, e, f, g, h;
+};
+
+//pCorners: x, y of the images of (0, 0), (1, 0), (1, 1) and (0, 1)
+static void SquareToQuad(const float* pCorners, Homography* pH) {
+	const float x0 = pCorners[0], y0 = pCorners[1], x1 = pCorners[2], y1 = pCorners[3];
+	const float x2 = pCorners[4], y2 = pCorners[5], x3 = pCorners[6], y3 = pCorners[7];
+	const float dx1 = x1 - x2, dx2 = x3 - x2, dx3 = x0 - x1 + x2 - x3;
+	const float dy1 = y1 - y2, dy2 = y3 - y2, dy3 = y0 - y1 + y2 - y3;
+	const float den = dx1 * dy2 - dx2 * dy1;
+	pH->g = (dx3 * dy2 - dx2 * dy3) / den;
+	pH->h = (dx1 * dy3 - dx3 * dy1) / den;
+	pH->a = x1 - x0 + pH->g * x1;
+	pH->b = x3 - x0 + pH->h * x3;
+	pH->c = x0;
+	pH->d = y1 - y0 + pH->g * y1;
+	pH->e = y3 - y0 + pH->h * y3;
+	pH->f = y0;
+}
+
+//The inverse mapping, frame pixel to unit square, as the adjugate of the 3x3 matrix
+static void InvertHomography(const Homography* pH, float* pInverse) {
+	pInverse[0] = pH->e - pH->f * pH->h;
+	pInverse[1] = pH->c * pH->h - pH->b;
+	pInverse[2] = pH->b * pH->f - pH->c * pH->e;
+	pInverse[3] = pH->f * pH->g - pH->d;
+	pInverse[4] = pH->a - pH->c * pH->g;
+	pInverse[5] = pH->c * pH->d - pH->a * pH->f;
+	pInverse[6] = pH->d * pH->h - pH->e * pH->g;
+	pInverse[7] = pH->b * pH->g - pH->a * pH->h;
+	pInverse[8] = pH->a * pH->e - pH->b * pH->d;
+}
+
+//Separable box blur of radius radius, in place. pTemp holds max(width, height) floats.
+static void BoxBlur(float* pImage, uint width, uint height, uint radius, float* pTemp) {
+	const float scale = 1.0f / (2 * radius + 1);
+	for(uint pass = 0; pass < 2; ++pass) {
+		const uint lines = pass ? width : height, length = pass ? height : width;
+		const uint step = pass ? width : 1, lineStep = pass ? 1 : width;
+		for(uint line = 0; line < lines; ++line) {
+			float* p = pImage + line * lineStep;
+			for(uint i = 0; i < length; ++i)
+				pTemp[i] = p[i * step];
+			float sum = 0;
+			for(int i = -(int)radius; i <= (int)radius; ++i)
+				sum += pTemp[i < 0 ? 0 : (i >= (int)length ? length - 1 : i)];
+			for(uint i = 0; i < length; ++i) {
+				p[i * step] = sum * scale;
+				const int leaving = (int)i - (int)radius, entering = (int)i + (int)radius + 1;
+				sum += pTemp[entering >= (int)length ? length - 1 : entering] - pTemp[leaving < 0 ? 0 : leaving];
+			}
+		}
+	}
+}
+
+//Render a case at severity in [0, 1] into pFrame (sized for the largest pitch) and fill in pCameraFrame.
+//pScene and pTemp are width * height and max(width, height) floats of scratch space.
+//noiseStream seeds the sensor noise and must differ between frames.
+static void RenderCase(const SuiteOptions* pOptions, const SuiteCase* pCase, float severity, uint noiseStream, uint8* pFrame,
+	float* pScene, float* pTemp, CameraFrame* pCameraFrame) {
+	const uint width = pOptions->width, height = pOptions->height;
+
+	//Corners of the code with its quiet zone: the square, one edge shortened for perspective, then rotated
+	const float half = (pCase->code.size + 2 * SUITE_QUIET_ZONE) * pCase->modulePx / 2;
+	float corners[8] = { -half, -half, half, -half, half, half, -half, half };
+	const uint edgeStart = pCase->tiltEdge, edgeEnd = (pCase->tiltEdge + 1) % 4;
+	const float shrink = 0.4f * pCase->tilt * severity;
+	for(uint i = 0; i < 2; ++i) {
+		const float middle = (corners[edgeStart * 2 + i] + corners[edgeEnd * 2 + i]) / 2;
+		corners[edgeStart * 2 + i] += (middle - corners[edgeStart * 2 + i]) * shrink;
+		corners[edgeEnd * 2 + i] += (middle - corners[edgeEnd * 2 + i]) * shrink;
+	}
+	const float radians = pCase->angle * severity * 3.14159265f / 180.0f;
+	const float cosine = cosf(radians), sine = sinf(radians);
+	for(uint i = 0; i < 4; ++i) {
+		const float x = corners[i * 2], y = corners[i * 2 + 1];
+		corners[i * 2] = pCase->centerX + x * cosine - y * sine;
+		corners[i * 2 + 1] = pCase->centerY + x * sine + y * cosine;
+	}
+	Homography homography;
+	float inverse[9];
+	SquareToQuad(corners, &homography);
+	InvertHomography(&homography, inverse);
+
+	//Lighting: the contrast shrinks the gray levels toward mid gray, the glare is a bright spot over the code
+	const float amplitude = 100.0f * (1.0f - 0.8f * pCase->contrast * severity);
+	const float dark = 128.0f - amplitude, light = 128.0f + amplitude, background = 128.0f - amplitude / 3;
+	const float glareAmplitude = 160.0f * pCase->glare * severity;
+	const float glareX = pCase->centerX + pCase->glareX * 2 * half, glareY = pCase->centerY + pCase->glareY * 2 * half;
+	const float glareRadius2 = half * half;
+
+	//Sample the code 2x2 times per pixel
+	const uint size = pCase->code.size;
+	const float modulesPerUnit = (float)(size + 2 * SUITE_QUIET_ZONE);
+	for(uint y = 0; y < height; ++y) {
+		for(uint x = 0; x < width; ++x) {
+			float sum = 0;
+			for(uint sample = 0; sample < 4; ++sample) {
+				const float sx = x + 0.25f + 0.5f * (sample & 1), sy = y + 0.25f + 0.5f * (sample >> 1);
+				const float w = inverse[6] * sx + inverse[7] * sy + inverse[8];
+				const float u = (inverse[0] * sx + inverse[1] * sy + inverse[2]) / w;
+				const float v = (inverse[3] * sx + inverse[4] * sy + inverse[5]) / w;
+				if(u < 0 || v < 0 || u >= 1 || v >= 1) {
+					sum += background;
+					continue;
+				}
+				const int mx = (int)(u * modulesPerUnit) - SUITE_QUIET_ZONE, my = (int)(v * modulesPerUnit) - SUITE_QUIET_ZONE;
+				const bool isDark = mx >= 0 && my >= 0 && mx < (int)size && my < (int)size && pCase->code.modules[my * size + mx];
+				sum += isDark ? dark : light;
+			}
+			pScene[y * width + x] = sum / 4;
+		}
+	}
+
+	const uint blurRadius = (uint)(0.5f * pCase->modulePx * pCase->blur * severity + 0.5f);
+	if(blurRadius) {
+		BoxBlur(pScene, width, height, blurRadius, pTemp);
+		BoxBlur(pScene, width, height, blurRadius, pTemp); //Twice, closer to a lens blur than a single box
+	}
+
+	//Glare and sensor noise (a sum of three uniforms, close enough to Gaussian), then the camera's pixel format
+	SuiteRandom random;
+	SeedRandom(&random, pOptions->seed, noiseStream);
+	const float noiseAmplitude = 24.0f * pCase->noise * severity;
+	const bool yuvFrame = pCase->pixelType != FRAME_PIXEL_RGB565;
+	const uint pitch = width * (yuvFrame ? 1 : 2) + pCase->pitchPadding;
+	for(uint y = 0; y < height; ++y) {
+		uint8* pRow = pFrame + y * pitch;
+		for(uint x = 0; x < width; ++x) {
+			float gray = pScene[y * width + x];
+			if(glareAmplitude > 0) {
+				const float dx = x - glareX, dy = y - glareY;
+				const float falloff = 1.0f - (dx * dx + dy * dy) / glareRadius2;
+				if(falloff > 0)
+					gray += glareAmplitude * falloff * falloff;
+			}
+			if(noiseAmplitude > 0)
+				gray += noiseAmplitude * (RandomFloat(&random, -1, 1) + RandomFloat(&random, -1, 1) + RandomFloat(&random, -1, 1)) / 1.73f;
+			const uint8 value = (uint8)(gray < 0 ? 0 : (gray > 255 ? 255 : gray + 0.5f));
+			if(yuvFrame)
+				pRow[x] = value;
+			else
+				((uint16*)pRow)[x] = (uint16)(((value & 0xf8) << 8) | ((value & 0xfc) << 3) | (value >> 3));
+		}
+		memset(pRow + width * (yuvFrame ? 1 : 2), 0, pCase->pitchPadding);
+	}
+	if(yuvFrame)
+		memset(pFrame + pitch * height, 128, pitch * ((height + 1) / 2)); //No colour
+
+	pCameraFrame->pData = pFrame;
+	pCameraFrame->width = width;
+	pCameraFrame->height = height;
+	pCameraFrame->pitch = pitch;
+	pCameraFrame->rotation = pCase->rotation;
+	pCameraFrame->pixelType = pCase->pixelType;
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//RESULTS
+
+static int CompareTimes(const void* pA, const void* pB) {
+	const uint64 a = *(const uint64*)pA, b = *(const uint64*)pB;
+	return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+//Fill in the latencies of pResult from the frame latencies of its level, which get sorted.
+static void SummarizeLatency(uint64* pLatencies, uint count, LevelResult* pResult) {
+	qsort(pLatencies, count, sizeof(uint64), CompareTimes);
+	uint64 total = 0;
+	for(uint i = 0; i < count; ++i)
+		total += pLatencies[i];
+	pResult->meanNs = total / count;
+	pResult->p50Ns = pLatencies[count / 2];
+	pResult->p95Ns = pLatencies[(count * 95) / 100 < count ? (count * 95) / 100 : count - 1];
+}
+
+static void WriteResults(FILE* pFile, const SuiteOptions* pOptions, const LevelResult* pResults) {
+	fprintf(pFile, "{\"seed\":%u,\"cases\":%u,\"levels\":%u,\"width\":%u,\"height\":%u,\"min_module\":%.2f,\"max_module\":%.2f,"
+		"\"mode\":\"%s\",\"enhance\":\"%s\",\"kernels\":\"%s\"}\n", pOptions->seed, pOptions->cases, pOptions->levels,
+		pOptions->width, pOptions->height, pOptions->minModule, pOptions->maxModule, ScanModeName(pOptions->mode),
+		ScanEnhanceModeName(pOptions->enhance), FrameKernelsVariant());
+	for(uint i = 0; i < pOptions->levels; ++i) {
+		const LevelResult& result = pResults[i];
+		fprintf(pFile, "{\"level\":%u,\"frames\":%u,\"decoded\":%u,\"wrong\":%u,\"rate\":%.4f,\"mean_ns\":%llu,\"p50_ns\":%llu,"
+			"\"p95_ns\":%llu}\n", result.level, result.frames, result.decoded, result.wrong,
+			(double)result.decoded / result.frames, (unsigned long long)result.meanNs, (unsigned long long)result.p50Ns,
+			(unsigned long long)result.p95Ns);
+	}
+}
+
+//Compare with a results file written by WriteResults. Returns the number of regressions, or -1 if the file can't be
+//read, describes a different corpus or was measured with a different --mode, --enhance or kernel variant.
+static int CompareWithBaseline(const SuiteOptions* pOptions, const LevelResult* pResults) {
+	FILE* pFile = fopen(pOptions->pBaselinePath, "r");
+	if(pFile == NULL) {
+		fprintf(stderr, "Failed to open baseline %s\n", pOptions->pBaselinePath);
+		return -1;
+	}
+	int regressions = 0;
+	bool sameCorpus = false;
+	uint levelsCompared = 0;
+	char line[512];
+	while(fgets(line, sizeof(line), pFile)) {
+		uint seed, cases, levels, width, height;
+		float minModule, maxModule;
+		char mode[16], enhance[16], kernels[16];
+		if(sscanf(line, "{\"seed\":%u,\"cases\":%u,\"levels\":%u,\"width\":%u,\"height\":%u,\"min_module\":%f,\"max_module\":%f,"
+			"\"mode\":\"%15[^\"]\",\"enhance\":\"%15[^\"]\",\"kernels\":\"%15[^\"]\"", &seed, &cases, &levels, &width, &height,
+			&minModule, &maxModule, mode, enhance, kernels) == 10) {
+			sameCorpus = seed == pOptions->seed && cases == pOptions->cases && levels == pOptions->levels &&
+				width == pOptions->width && height == pOptions->height && fabsf(minModule - pOptions->minModule) < 0.005f &&
+				fabsf(maxModule - pOptions->maxModule) < 0.005f && strcmp(mode, ScanModeName(pOptions->mode)) == 0 &&
+				strcmp(enhance, ScanEnhanceModeName(pOptions->enhance)) == 0 && strcmp(kernels, FrameKernelsVariant()) == 0;
+			continue;
+		}
+		LevelResult base;
+		unsigned long long meanNs, p50Ns, p95Ns;
+		double rate;
+		if(sscanf(line, "{\"level\":%u,\"frames\":%u,\"decoded\":%u,\"wrong\":%u,\"rate\":%lf,\"mean_ns\":%llu,\"p50_ns\":%llu,"
+			"\"p95_ns\":%llu}", &base.level, &base.frames, &base.decoded, &base.wrong, &rate, &meanNs, &p50Ns, &p95Ns) != 8 ||
+			!sameCorpus || base.level >= pOptions->levels || base.frames == 0)
+			continue;
+		base.p50Ns = p50Ns;
+		const LevelResult& result = pResults[base.level];
+		const double baseRate = (double)base.decoded / base.frames, newRate = (double)result.decoded / result.frames;
+		if(newRate < baseRate - pOptions->rateDrop) {
+			printf("REGRESSION level %u: decode rate %.1f%%, baseline %.1f%%\n", base.level, 100 * newRate, 100 * baseRate);
+			++regressions;
+		}
+		if(result.p50Ns > base.p50Ns * (1.0 + pOptions->slowdown)) {
+			printf("REGRESSION level %u: median latency %llu ns, baseline %llu ns\n", base.level,
+				(unsigned long long)result.p50Ns, (unsigned long long)base.p50Ns);
+			++regressions;
+		}
+		if(result.wrong > base.wrong) {
+			printf("REGRESSION level %u: %u wrong payloads, baseline %u\n", base.level, result.wrong, base.wrong);
+			++regressions;
+		}
+		++levelsCompared;
+	}
+	fclose(pFile);
+	if(!sameCorpus || levelsCompared != pOptions->levels) {
+		fprintf(stderr, "%s is not a results file of this corpus and settings (same --seed, --cases, --levels, frame and module "
+			"sizes, --mode, --enhance and kernels)\n", pOptions->pBaselinePath);
+		return -1;
+	}
+	return regressions;
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//FUNCTIONS
+
+static void PrintUsage() {
+	printf("Usage: scansuite [--seed N] [--cases N] [--levels N] [--width N] [--height N] [--min-module F] [--max-module F]\n"
+		"                 [--mode full|pyramid|tracking] [--enhance off|stretch|threshold] [--repeat N] [--results FILE]\n"
+		"                 [--baseline FILE] [--rate-drop F] [--slowdown F] [--record FILE] [--verbose]\n");
+}
+
+//Returns false if an option is unknown or has a bad value.
+static bool ParseOptions(int argc, char** argv, SuiteOptions* pOptions) {
+	pOptions->seed = 1;
+	pOptions->cases = 24;
+	pOptions->levels = 6;
+	pOptions->width = 640;
+	pOptions->height = 480;
+	pOptions->minModule = 2.0f;
+	pOptions->maxModule = 6.0f;
+	pOptions->mode = SCAN_MODE_PYRAMID;
+	pOptions->enhance = SCAN_ENHANCE_OFF;
+	pOptions->repeat = 3;
+	pOptions->pResultsPath = NULL;
+	pOptions->pBaselinePath = NULL;
+	pOptions->rateDrop = 0.02f;
+	pOptions->slowdown = 0.25f;
+	pOptions->pRecordPath = NULL;
+	pOptions->verbose = false;
+
+	for(int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		if(strcmp(arg, "--verbose") == 0) {
+			pOptions->verbose = true;
+			continue;
+		}
+		if(i + 1 >= argc)
+			return false;
+		const char* value = argv[++i];
+		if(strcmp(arg, "--seed") == 0)
+			pOptions->seed = (uint)atoi(value);
+		else if(strcmp(arg, "--cases") == 0)
+			pOptions->cases = (uint)atoi(value);
+		else if(strcmp(arg, "--levels") == 0)
+			pOptions->levels = (uint)atoi(value);
+		else if(strcmp(arg, "--width") == 0)
+			pOptions->width = (uint)atoi(value);
+		else if(strcmp(arg, "--height") == 0)
+			pOptions->height = (uint)atoi(value);
+		else if(strcmp(arg, "--min-module") == 0)
+			pOptions->minModule = (float)atof(value);
+		else if(strcmp(arg, "--max-module") == 0)
+			pOptions->maxModule = (float)atof(value);
+		else if(strcmp(arg, "--mode") == 0) {
+			if(!ScanModeFromName(value, &pOptions->mode))
+				return false;
+		}
+		else if(strcmp(arg, "--enhance") == 0) {
+			if(!ScanEnhanceModeFromName(value, &pOptions->enhance))
+				return false;
+		}
+		else if(strcmp(arg, "--repeat") == 0)
+			pOptions->repeat = (uint)atoi(value);
+		else if(strcmp(arg, "--results") == 0)
+			pOptions->pResultsPath = value;
+		else if(strcmp(arg, "--baseline") == 0)
+			pOptions->pBaselinePath = value;
+		else if(strcmp(arg, "--rate-drop") == 0)
+			pOptions->rateDrop = (float)atof(value);
+		else if(strcmp(arg, "--slowdown") == 0)
+			pOptions->slowdown = (float)atof(value);
+		else if(strcmp(arg, "--record") == 0)
+			pOptions->pRecordPath = value;
+		else
+			return false;
+	}
+	return pOptions->cases > 0 && pOptions->levels >= 2 && pOptions->width >= 64 && pOptions->height >= 64 &&
+		pOptions->width <= FRAME_FILE_MAX_DIMENSION && pOptions->height <= FRAME_FILE_MAX_DIMENSION &&
+		pOptions->minModule >= 1.0f && pOptions->maxModule >= pOptions->minModule && pOptions->repeat > 0 &&
+		pOptions->rateDrop >= 0.0f && pOptions->slowdown >= 0.0f;
+}
+
+//,``,,``,,``,,``,,``,,``,,``,,``,,``,,``,
+//MAIN FUNCTION
+
+int main(int argc, char** argv) {
+	SuiteOptions options;
+	if(!ParseOptions(argc, argv, &options)) {
+		PrintUsage();
+		return 1;
+	}
+
+	FrameCrop crop;
+	ComputeFrameCrop(options.width, options.height, &crop);
+	const uint maxPitch = options.width * 2 + SUITE_MAX_PITCH_PADDING;
+	uint8* pFrame = (uint8*)malloc((size_t)maxPitch * options.height + (size_t)maxPitch * ((options.height + 1) / 2));
+	float* pScene = (float*)malloc((size_t)options.width * options.height * sizeof(float));
+	float* pTemp = (float*)malloc((options.width > options.height ? options.width : options.height) * sizeof(float));
+	uint16* pPreview = (uint16*)malloc((size_t)crop.dim * crop.dim * sizeof(uint16));
+	uint8* pGray = (uint8*)malloc((size_t)crop.dim * crop.dim);
+	uint64* pLatencies = (uint64*)malloc(options.cases * sizeof(uint64));
+	LevelResult* pResults = (LevelResult*)calloc(options.levels, sizeof(LevelResult));
+	SuiteCase* pCase = (SuiteCase*)malloc(sizeof(SuiteCase));
+
+	ScanDecoder decoder;
+	ScanEnhancer enhancer;
+	ScanEnhancerInit(&enhancer);
+	if(!pFrame || !pScene || !pTemp || !pPreview || !pGray || !pLatencies || !pResults || !pCase ||
+		!ScanDecoderInit(&decoder, options.mode, NULL)) {
+		fprintf(stderr, "Failed to set up the decoder\n");
+		return 1;
+	}
+	FrameRecorder recorder;
+	if(options.pRecordPath && !FrameRecorderOpen(&recorder, options.pRecordPath)) {
+		fprintf(stderr, "Failed to create %s\n", options.pRecordPath);
+		return 1;
+	}
+
+	printf("seed %u, %u cases x %u levels, %ux%u frames, crop %ux%u, modules %.1f-%.1f px, mode %s, enhance %s, kernels %s\n",
+		options.seed, options.cases, options.levels, options.width, options.height, crop.dim, crop.dim, options.minModule,
+		options.maxModule, ScanModeName(options.mode), ScanEnhanceModeName(options.enhance), FrameKernelsVariant());
+
+	const char* pixelTypeNames[] = { "rgb565", "nv21", "nv12" };
+	uint frameNumber = 0;
+	for(uint level = 0; level < options.levels; ++level) {
+		const float severity = (float)level / (options.levels - 1);
+		LevelResult& result = pResults[level];
+		result.level = level;
+		for(uint i = 0; i < options.cases; ++i) {
+			CreateCase(&options, &crop, i, pCase);
+			CameraFrame frame;
+			RenderCase(&options, pCase, severity, (level + 1) * options.cases + i, pFrame, pScene, pTemp, &frame);
+			if(options.pRecordPath && !FrameRecorderWrite(&recorder, &frame, frameNumber * SUITE_FRAME_INTERVAL_NS)) {
+				fprintf(stderr, "Failed to write %s\n", options.pRecordPath);
+				return 1;
+			}
+			++frameNumber;
+
+			//Decode result of the first run, latency of the fastest
+			uint64 latencyNs = 0;
+			bool decoded = false, wrong = false;
+			for(uint run = 0; run < options.repeat; ++run) {
+				const uint64 startNs = ScanClockNs();
+				PrepareCameraFrame(&frame, &crop, crop.dim, pPreview, pGray);
+				if(!ScanEnhance(&enhancer, options.enhance, pGray, crop.dim, crop.dim)) {
+					fprintf(stderr, "Out of memory\n");
+					return 1;
+				}
+				const int numSymbols = ScanDecoderScan(&decoder, pGray, crop.dim, crop.dim);
+				const uint64 runNs = ScanClockNs() - startNs;
+				if(run == 0 || runNs < latencyNs)
+					latencyNs = runNs;
+				if(run > 0 || numSymbols <= 0)
+					continue;
+				for(const zbar_symbol_t* pSymbol = ScanDecoderFirstSymbol(&decoder); pSymbol; pSymbol = zbar_symbol_next(pSymbol)) {
+					if(zbar_symbol_get_type(pSymbol) != ZBAR_QRCODE || !ScanDecoderIsVerified(&decoder, pSymbol))
+						continue;
+					if(zbar_symbol_get_data_length(pSymbol) == pCase->payloadLength &&
+						memcmp(zbar_symbol_get_data(pSymbol), pCase->payload, pCase->payloadLength) == 0)
+						decoded = true;
+					else
+						wrong = true;
+				}
+			}
+			pLatencies[i] = latencyNs;
+			++result.frames;
+			if(decoded)
+				++result.decoded;
+			else if(wrong)
+				++result.wrong;
+
+			if(options.verbose)
+				printf("level %u case %3u: version %2u-%s mask %u, %4u bytes, %.1f px modules, %s pitch %u rotation %3u: %s %llu ns\n",
+					level, i, pCase->code.version, QrEcLevelName(pCase->ecLevel), pCase->mask, pCase->payloadLength,
+					pCase->modulePx, pixelTypeNames[frame.pixelType], frame.pitch, frame.rotation * 90,
+					decoded ? "decoded" : (wrong ? "WRONG" : "missed"), (unsigned long long)latencyNs);
+		}
+		SummarizeLatency(pLatencies, options.cases, &result);
+	}
+
+	printf("%-6s %8s %8s %8s %12s %12s %12s\n", "level", "decoded", "wrong", "rate", "mean ns", "median ns", "p95 ns");
+	for(uint i = 0; i < options.levels; ++i) {
+		const LevelResult& result = pResults[i];
+		printf("%-6u %8u %8u %7.1f%% %12llu %12llu %12llu\n", result.level, result.decoded, result.wrong,
+			100.0 * result.decoded / result.frames, (unsigned long long)result.meanNs, (unsigned long long)result.p50Ns,
+			(unsigned long long)result.p95Ns);
+	}
+
+	int status = 0;
+	if(options.pResultsPath) {
+		FILE* pFile = fopen(options.pResultsPath, "w");
+		if(pFile == NULL) {
+			fprintf(stderr, "Failed to create %s\n", options.pResultsPath);
+			status = 1;
+		}
+		else {
+			WriteResults(pFile, &options, pResults);
+			fclose(pFile);
+		}
+	}
+	if(options.pBaselinePath) {
+		const int regressions = CompareWithBaseline(&options, pResults);
+		if(regressions < 0)
+			status = 1;
+		else if(regressions > 0) {
+			printf("%d regression(s) against %s\n", regressions, options.pBaselinePath);
+			status = 2;
+		}
+		else
+			printf("no regressions against %s\n", options.pBaselinePath);
+	}
+
+	if(options.pRecordPath)
+		FrameRecorderClose(&recorder);
+	ScanDecoderRelease(&decoder);
+	ScanEnhancerRelease(&enhancer);
+	free(pFrame);
+	free(pScene);
+	free(pTemp);
+	free(pPreview);
+	free(pGray);
+	free(pLatencies);
+	free(pResults);
+	free(pCase);
+	return status;
+}